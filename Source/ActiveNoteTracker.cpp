@@ -0,0 +1,70 @@
+#include "ActiveNoteTracker.h"
+
+void ActiveNoteTracker::handleMessage (const juce::uint8* data, int size) noexcept
+{
+    if (size < 3)
+        return;
+
+    const int status = data[0] & 0xf0;
+    const int channelIndex = data[0] & 0x0f;
+    const int noteNumber = data[1] & 0x7f;
+
+    if (status == 0x90 && data[2] != 0)
+        noteOn (channelIndex, noteNumber);
+    else if (status == 0x80 || status == 0x90)
+        noteOff (channelIndex, noteNumber);
+}
+
+void ActiveNoteTracker::noteOn (int channelIndex, int noteNumber) noexcept
+{
+    const int slot = getSlot (channelIndex, noteNumber);
+    if (active[static_cast<size_t> (slot)])
+        return;
+
+    active.set (static_cast<size_t> (slot));
+    listPosition[static_cast<size_t> (slot)] = static_cast<juce::uint16> (numActive);
+    activeList[static_cast<size_t> (numActive++)] = static_cast<juce::uint16> (slot);
+}
+
+void ActiveNoteTracker::noteOff (int channelIndex, int noteNumber) noexcept
+{
+    const int slot = getSlot (channelIndex, noteNumber);
+    if (! active[static_cast<size_t> (slot)])
+        return;
+
+    active.reset (static_cast<size_t> (slot));
+
+    // Move the last entry into the freed place
+    const auto position = listPosition[static_cast<size_t> (slot)];
+    const auto lastSlot = activeList[static_cast<size_t> (--numActive)];
+    activeList[position] = lastSlot;
+    listPosition[lastSlot] = position;
+}
+
+bool ActiveNoteTracker::isNoteActive (int channelIndex, int noteNumber) const noexcept
+{
+    return active[static_cast<size_t> (getSlot (channelIndex, noteNumber))];
+}
+
+void ActiveNoteTracker::releaseAll (juce::MidiBuffer& output, int samplePosition)
+{
+    for (int i = 0; i < numActive; ++i)
+    {
+        const auto slot = activeList[static_cast<size_t> (i)];
+        const juce::uint8 noteOffMessage[3] = { static_cast<juce::uint8> (0x80 | (slot >> 7)),
+                                                static_cast<juce::uint8> (slot & 0x7f),
+                                                0 };
+        output.addEvent (noteOffMessage, 3, samplePosition);
+        active.reset (slot);
+    }
+
+    numActive = 0;
+}
+
+void ActiveNoteTracker::reset() noexcept
+{
+    for (int i = 0; i < numActive; ++i)
+        active.reset (activeList[static_cast<size_t> (i)]);
+
+    numActive = 0;
+}
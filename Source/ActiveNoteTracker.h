@@ -0,0 +1,45 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <bitset>
+
+// Remembers which notes are sounding on each of the 16 MIDI channels, so the
+// player can end them all when playback stops, jumps or changes song.
+//
+// Membership is a 16 x 128 bitmap. The active notes are also kept in a dense
+// list, with each note's place in it recorded, so adding or removing a note is
+// O(1) and releasing everything costs O(active notes) rather than a scan of all
+// 2048 slots.
+class ActiveNoteTracker final
+{
+public:
+    ActiveNoteTracker() = default;
+
+    // Updates the state from an outgoing short message. Anything other than a
+    // note-on or note-off is ignored; a note-on with velocity 0 counts as an off.
+    void handleMessage (const juce::uint8* data, int size) noexcept;
+
+    void noteOn (int channelIndex, int noteNumber) noexcept;
+    void noteOff (int channelIndex, int noteNumber) noexcept;
+
+    bool isNoteActive (int channelIndex, int noteNumber) const noexcept;
+    int getNumActiveNotes() const noexcept { return numActive; }
+
+    // Adds a note-off for every active note at the given sample and forgets them.
+    void releaseAll (juce::MidiBuffer& output, int samplePosition);
+
+    // Forgets every note without sending anything.
+    void reset() noexcept;
+
+private:
+    static constexpr int numSlots = 16 * 128;
+
+    static int getSlot (int channelIndex, int noteNumber) noexcept { return (channelIndex << 7) | noteNumber; }
+
+    std::bitset<numSlots> active;
+    std::array<juce::uint16, numSlots> activeList {};    // slots of the active notes, in no order
+    std::array<juce::uint16, numSlots> listPosition {};  // where each active slot is in activeList
+    int numActive = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ActiveNoteTracker)
+};
@@ -0,0 +1,122 @@
+#include "BatchRenderer.h"
+#include "MidiFileLoader.h"
+#include <set>
+
+BatchRenderer::BatchRenderer (const Options& optionsToUse, SampleKit::Ptr kitToUse)
+    : options (optionsToUse), kit (std::move (kitToUse))
+{
+}
+
+juce::Array<juce::File> BatchRenderer::findMidiFiles (const juce::File& folder)
+{
+    juce::Array<juce::File> files;
+
+    // Wildcards are case-sensitive on some systems; hasFileExtension is not
+    for (const auto& entry : juce::RangedDirectoryIterator (folder, true, "*", juce::File::findFiles))
+        if (entry.getFile().hasFileExtension ("mid;midi"))
+            files.add (entry.getFile());
+
+    files.sort();
+    return files;
+}
+
+BatchRenderer::Summary BatchRenderer::run (const juce::File& sourceFolder, const juce::File& destinationFolder,
+                                           ProgressCallback onProgress)
+{
+    cancelled = false;
+    results.clear();
+
+    const auto sources = findMidiFiles (sourceFolder);
+    const auto extension = options.format == Format::audio ? ".wav" : ".mid";
+    std::set<juce::String> claimedPaths;
+
+    // Work out every destination here, in sorted order, so two inputs that would
+    // share one (groove.mid and groove.midi) are told apart the same way every run
+    results.resize (static_cast<size_t> (sources.size()));
+
+    for (int i = 0; i < sources.size(); ++i)
+    {
+        auto& result = results[static_cast<size_t> (i)];
+        result.source = sources.getReference (i);
+
+        const auto relativePath = result.source.getRelativePathFrom (sourceFolder);
+        result.destination = destinationFolder.getChildFile (relativePath).withFileExtension (extension);
+
+        if (! claimedPaths.insert (result.destination.getFullPathName()).second)
+        {
+            result.destination = destinationFolder.getChildFile (relativePath + extension);
+            claimedPaths.insert (result.destination.getFullPathName());
+        }
+
+        result.destination.getParentDirectory().createDirectory();
+    }
+
+    Summary summary;
+    summary.numFiles = static_cast<int> (results.size());
+
+    if (results.empty())
+        return summary;
+
+    const int numThreads = options.numThreads > 0 ? options.numThreads : juce::SystemStats::getNumCpus();
+    const double startTime = juce::Time::getMillisecondCounterHiRes();
+
+    std::atomic<int> numDone { 0 };
+    juce::WaitableEvent allDone;
+
+    {
+        juce::ThreadPool pool (juce::jmin (numThreads, summary.numFiles));
+
+        for (auto& result : results)
+        {
+            pool.addJob ([this, &result, &numDone, &allDone, &onProgress, total = summary.numFiles]
+            {
+                renderFile (result);
+
+                const int done = ++numDone;
+
+                if (onProgress != nullptr)
+                    onProgress (done, total);
+
+                if (done == total)
+                    allDone.signal();
+            });
+        }
+
+        allDone.wait();
+    }
+
+    summary.wallSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) * 0.001;
+
+    for (const auto& result : results)
+    {
+        if (result.report.result.failed())
+            ++summary.numFailed;
+
+        summary.busySeconds += result.loadSeconds + result.report.renderSeconds;
+        summary.songSeconds += result.report.songSeconds;
+    }
+
+    return summary;
+}
+
+void BatchRenderer::renderFile (FileResult& result) const
+{
+    if (cancelled)
+    {
+        result.report.result = juce::Result::fail ("Cancelled");
+        return;
+    }
+
+    const double startTime = juce::Time::getMillisecondCounterHiRes();
+    auto song = MidiFileLoader::loadFile (result.source);
+    result.loadSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) * 0.001;
+
+    if (song == nullptr)
+        result.report.result = juce::Result::fail ("Could not read " + result.source.getFullPathName());
+    else if (options.format == Format::midi)
+        result.report = OfflineRenderer::renderToMidi (*song, result.destination, options.render);
+    else if (kit != nullptr)
+        result.report = OfflineRenderer::renderToAudio (*song, *kit, result.destination, options.render);
+    else
+        result.report.result = juce::Result::fail ("No kit to render with");
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "OfflineRenderer.h"
+
+// Renders every MIDI file under a folder with OfflineRenderer, one file per job
+// on a thread pool.
+//
+// The files are found and sorted before any work starts, and each job only reads
+// its own input and writes its own output, so what ends up on disk does not
+// depend on the number of threads or the order the jobs finish in. Idle threads
+// take the next file from the pool's queue, so a few long songs never hold up
+// the rest. Results are kept in the sorted order, with the time each file took.
+class BatchRenderer final
+{
+public:
+    enum class Format
+    {
+        midi,
+        audio
+    };
+
+    struct Options
+    {
+        OfflineRenderer::Options render;
+        Format format = Format::midi;
+        int numThreads = 0;              // 0 uses every core
+    };
+
+    struct FileResult
+    {
+        juce::File source;
+        juce::File destination;
+        OfflineRenderer::Report report;
+        double loadSeconds = 0.0;        // reading and compiling the file
+    };
+
+    struct Summary
+    {
+        int numFiles = 0;
+        int numFailed = 0;
+        double wallSeconds = 0.0;        // from the first file starting to the last one finishing
+        double busySeconds = 0.0;        // load and render time summed over all files
+        double songSeconds = 0.0;        // length of everything rendered
+    };
+
+    // Called from the worker threads after each file.
+    using ProgressCallback = std::function<void (int numDone, int numTotal)>;
+
+    // The kit is shared by every job and is only needed for audio.
+    BatchRenderer (const Options& options, SampleKit::Ptr kit);
+
+    // Renders every .mid and .midi file under sourceFolder to the same relative
+    // path under destinationFolder, with the extension of the output format.
+    // Blocks until every file is done or the batch is cancelled.
+    Summary run (const juce::File& sourceFolder, const juce::File& destinationFolder,
+                 ProgressCallback onProgress = nullptr);
+
+    // Any thread: files not started yet are skipped; those being rendered finish.
+    void cancel() noexcept { cancelled = true; }
+
+    // The result of every file found by the last run, in sorted order.
+    const std::vector<FileResult>& getResults() const noexcept { return results; }
+
+    // Every MIDI file under the folder, sorted by path.
+    static juce::Array<juce::File> findMidiFiles (const juce::File& folder);
+
+private:
+    void renderFile (FileResult& result) const;
+
+    Options options;
+    SampleKit::Ptr kit;
+    std::vector<FileResult> results;
+    std::atomic<bool> cancelled { false };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BatchRenderer)
+};
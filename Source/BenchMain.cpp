@@ -0,0 +1,45 @@
+#include "Benchmarks.h"
+
+// Benchmarks and regression checks that run without a host or a display:
+//
+//     midifart-bench [fingerprints] [--sizes=1000,10000,100000,1000000] [--queries=N] [--results=N]
+//     midifart-bench engine [song.mid] [--events=N] [--blocks=32,64] [--rate=Hz] [--passes=N]
+//     midifart-bench voices [--voices=N] [--block=samples] [--seconds=N] [--kit=folder]
+//     midifart-bench block-sizes [song.mid] [--rate=Hz] [--tempo=BPM] [--loops=N] [--max-block=samples]
+//     midifart-bench commands [--commands=N] [--block-us=microseconds]
+//
+// The mode is the first argument and defaults to fingerprints. Checks exit with
+// a non-zero code when they fail; block-sizes and commands are registered with CTest.
+
+int main (int argc, char* argv[])
+{
+    juce::ArgumentList args (argc, argv);
+
+    juce::String mode ("fingerprints");
+
+    if (args.size() > 0 && ! args[0].isOption())
+    {
+        mode = args[0].text;
+        args.arguments.remove (0);
+    }
+
+    return juce::ConsoleApplication::invokeCatchingFailures ([&args, &mode]
+    {
+        if (mode == "fingerprints")
+            return Benchmarks::runFingerprints (args);
+
+        if (mode == "engine")
+            return Benchmarks::runEngine (args);
+
+        if (mode == "voices")
+            return Benchmarks::runVoices (args);
+
+        if (mode == "block-sizes")
+            return Benchmarks::checkBlockSizes (args);
+
+        if (mode == "commands")
+            return Benchmarks::checkCommandQueue (args);
+
+        juce::ConsoleApplication::fail ("Unknown mode: " + mode);
+    });
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+// The modes of midifart-bench. Each takes the arguments after the mode name and
+// returns the exit code; see BenchMain.cpp for their options.
+namespace Benchmarks
+{
+    // Times similar-groove queries against libraries of different sizes.
+    int runFingerprints (const juce::ArgumentList& args);
+
+    // Times MIDI playback per block at small block sizes.
+    int runEngine (const juce::ArgumentList& args);
+
+    // Times the sample voice engine with every voice busy, per instruction set.
+    int runVoices (const juce::ArgumentList& args);
+
+    // Pushes commands onto a TransportCommandQueue while another thread drains
+    // it, and fails if any is lost or reordered.
+    int checkCommandQueue (const juce::ArgumentList& args);
+
+    // Renders a song at every block size and fails if any event moves.
+    int checkBlockSizes (const juce::ArgumentList& args);
+}
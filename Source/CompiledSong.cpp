@@ -0,0 +1,223 @@
+#include "CompiledSong.h"
+
+CompiledSong::Ptr CompiledSong::compile (const juce::MidiFile& file)
+{
+    const int numTracks = file.getNumTracks();
+    if (numTracks <= 0)
+        return nullptr;
+
+    Ptr song (new CompiledSong());
+    auto& songInfo = song->info;
+    songInfo.numTracks = numTracks;
+
+    short timeFormat = file.getTimeFormat();
+    songInfo.ticksPerQuarterNote = timeFormat > 0 ? static_cast<double> (timeFormat) : 480.0;
+
+    // Gather every event, then merge the tracks with a stable sort so events on
+    // the same tick keep their track order.
+    struct EventRef
+    {
+        int64_t tick;
+        const juce::MidiMessage* message;
+    };
+
+    std::vector<EventRef> events;
+    size_t totalEvents = 0;
+    for (int t = 0; t < numTracks; ++t)
+        totalEvents += static_cast<size_t> (file.getTrack (t)->getNumEvents());
+
+    events.reserve (totalEvents);
+
+    for (int t = 0; t < numTracks; ++t)
+    {
+        const auto* track = file.getTrack (t);
+        for (int i = 0; i < track->getNumEvents(); ++i)
+        {
+            const auto& msg = track->getEventPointer (i)->message;
+            events.push_back ({ static_cast<int64_t> (msg.getTimeStamp()), &msg });
+        }
+    }
+
+    std::stable_sort (events.begin(), events.end(),
+                      [] (const EventRef& a, const EventRef& b) { return a.tick < b.tick; });
+
+    song->ticks.reserve (events.size());
+    song->messages.reserve (events.size());
+
+    std::vector<std::pair<int64_t, double>> tempoChanges;
+    bool foundTimeSignature = false;
+
+    for (const auto& event : events)
+    {
+        const auto& msg = *event.message;
+        const auto* data = msg.getRawData();
+        const int size = msg.getRawDataSize();
+
+        if (size <= 0)
+            continue;
+
+        if (msg.isTempoMetaEvent())
+        {
+            auto secondsPerQuarterNote = msg.getTempoSecondsPerQuarterNote();
+
+            if (tempoChanges.empty())
+                songInfo.initialTempo = secondsPerQuarterNote > 0.0 ? 60.0 / secondsPerQuarterNote : 120.0;
+
+            tempoChanges.emplace_back (event.tick, secondsPerQuarterNote);
+        }
+        else if (! foundTimeSignature && msg.isTimeSignatureMetaEvent())
+        {
+            msg.getTimeSignatureInfo (songInfo.timeSigNumerator, songInfo.timeSigDenominator);
+            foundTimeSignature = true;
+        }
+        else if (msg.isNoteOn())
+        {
+            ++songInfo.numNoteOns;
+        }
+
+        uint32_t packed = 0;
+
+        if (size <= 3 && ! msg.isSysEx() && ! msg.isMetaEvent())
+        {
+            for (int b = 0; b < size; ++b)
+                packed |= static_cast<uint32_t> (data[b]) << (8 * b);
+
+            packed |= static_cast<uint32_t> (size) << lengthShift;
+        }
+        else
+        {
+            LongMessage longMessage;
+            longMessage.offset = static_cast<uint32_t> (song->longMessageData.size());
+            longMessage.size = static_cast<uint32_t> (size);
+
+            packed = static_cast<uint32_t> (song->longMessages.size()) & payloadMask;
+            song->longMessages.push_back (longMessage);
+            song->longMessageData.insert (song->longMessageData.end(), data, data + size);
+        }
+
+        song->ticks.push_back (event.tick);
+        song->messages.push_back (packed);
+    }
+
+    song->tempoMap.build (tempoChanges, songInfo.ticksPerQuarterNote);
+    song->measurePeakLoads();
+
+    songInfo.maxTempo = 0.0;
+    for (int i = 0; i < song->tempoMap.getNumSegments(); ++i)
+    {
+        const auto secondsPerTick = song->tempoMap.getSegment (i).secondsPerTick;
+        if (secondsPerTick > 0.0)
+            songInfo.maxTempo = juce::jmax (songInfo.maxTempo, 60.0 / (secondsPerTick * songInfo.ticksPerQuarterNote));
+    }
+
+    if (songInfo.maxTempo <= 0.0)
+        songInfo.maxTempo = songInfo.initialTempo;
+
+    songInfo.numEvents = song->getNumEvents();
+    songInfo.numTempoChanges = static_cast<int> (tempoChanges.size());
+    songInfo.lengthInTicks = song->ticks.empty() ? 0 : song->ticks.back();
+    songInfo.lengthInQuarterNotes = static_cast<double> (songInfo.lengthInTicks) / songInfo.ticksPerQuarterNote;
+    songInfo.lengthInSeconds = song->tempoMap.tickToSeconds (static_cast<double> (songInfo.lengthInTicks));
+
+    if (songInfo.timeSigNumerator > 0 && songInfo.timeSigDenominator > 0)
+        songInfo.lengthInBars = songInfo.lengthInQuarterNotes * songInfo.timeSigDenominator / (4.0 * songInfo.timeSigNumerator);
+
+    return song;
+}
+
+size_t CompiledSong::getMemoryUsage() const noexcept
+{
+    return sizeof (*this)
+         + ticks.capacity() * sizeof (int64_t)
+         + messages.capacity() * sizeof (uint32_t)
+         + longMessages.capacity() * sizeof (LongMessage)
+         + longMessageData.capacity();
+}
+
+int CompiledSong::findFirstEventAtOrAfter (int64_t tick) const noexcept
+{
+    auto it = std::lower_bound (ticks.begin(), ticks.end(), tick);
+    return static_cast<int> (std::distance (ticks.begin(), it));
+}
+
+void CompiledSong::addEventToBuffer (int index, juce::MidiBuffer& output, int samplePosition) const
+{
+    juce::uint8 bytes[3];
+    const int length = getShortMessage (index, bytes);
+
+    if (length > 0)
+    {
+        output.addEvent (bytes, length, samplePosition);
+        return;
+    }
+
+    const auto& longMessage = longMessages[messages[static_cast<size_t> (index)] & payloadMask];
+    output.addEvent (longMessageData.data() + longMessage.offset,
+                     static_cast<int> (longMessage.size), samplePosition);
+}
+
+int CompiledSong::getShortMessage (int index, juce::uint8 (&bytes)[3]) const noexcept
+{
+    const uint32_t packed = messages[static_cast<size_t> (index)];
+
+    bytes[0] = static_cast<juce::uint8> (packed & 0xff);
+    bytes[1] = static_cast<juce::uint8> ((packed >> 8) & 0xff);
+    bytes[2] = static_cast<juce::uint8> ((packed >> 16) & 0xff);
+
+    return static_cast<int> (packed >> lengthShift);
+}
+
+int CompiledSong::getMessageLength (int index) const noexcept
+{
+    const uint32_t packed = messages[static_cast<size_t> (index)];
+    const auto length = packed >> lengthShift;
+
+    return length > 0 ? static_cast<int> (length)
+                      : static_cast<int> (longMessages[packed & payloadMask].size);
+}
+
+CompiledSong::Load CompiledSong::getPeakLoad (double lengthInTicks) const noexcept
+{
+    // A stretch that is not a whole number of ticks long can still touch one more tick
+    const auto numTicks = static_cast<int64_t> (std::floor (juce::jmax (0.0, lengthInTicks))) + 1;
+
+    int index = 0;
+    while (index < numPeakLoads - 1 && (int64_t (1) << index) < numTicks)
+        ++index;
+
+    return peakLoads[static_cast<size_t> (index)];
+}
+
+void CompiledSong::measurePeakLoads()
+{
+    const size_t numEvents = ticks.size();
+
+    // A sliding window over the sorted ticks for each length
+    for (int i = 0; i < numPeakLoads - 1; ++i)
+    {
+        const int64_t windowLength = int64_t (1) << i;
+        Load peak;
+        size_t first = 0;
+        int bytesInWindow = 0;
+
+        for (size_t last = 0; last < numEvents; ++last)
+        {
+            bytesInWindow += getMessageLength (static_cast<int> (last));
+
+            while (ticks[last] - ticks[first] >= windowLength)
+                bytesInWindow -= getMessageLength (static_cast<int> (first++));
+
+            peak.numEvents = juce::jmax (peak.numEvents, static_cast<int> (last - first + 1));
+            peak.numBytes = juce::jmax (peak.numBytes, bytesInWindow);
+        }
+
+        peakLoads[static_cast<size_t> (i)] = peak;
+    }
+
+    auto& wholeSong = peakLoads.back();
+    wholeSong.numEvents = static_cast<int> (numEvents);
+    wholeSong.numBytes = 0;
+
+    for (size_t i = 0; i < numEvents; ++i)
+        wholeSong.numBytes += getMessageLength (static_cast<int> (i));
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "TempoMap.h"
+
+// A MIDI file flattened into a single time-ordered timeline that the audio
+// thread can stream through without chasing pointers or merging tracks.
+//
+// The events of all tracks are merged at load time and stored as parallel
+// arrays: a 64-bit tick per event and a packed 32-bit word holding either a
+// complete short message (up to 3 bytes plus its length) or, for sysex and meta
+// events, an index into an out-of-line byte pool.
+//
+// Songs are immutable once compiled and reference counted, so the message
+// thread can hand them to the audio thread and reclaim them later.
+class CompiledSong final : public juce::ReferenceCountedObject
+{
+public:
+    using Ptr = juce::ReferenceCountedObjectPtr<CompiledSong>;
+
+    // Summary of the song, computed once at compile time so nothing has to
+    // scan the events to answer length or position queries.
+    struct Info
+    {
+        int64_t lengthInTicks = 0;          // tick of the last event
+        double ticksPerQuarterNote = 480.0;
+        double lengthInQuarterNotes = 0.0;
+        double lengthInSeconds = 0.0;       // at the file's own tempo map
+        double lengthInBars = 0.0;          // using the first time signature
+        int timeSigNumerator = 4;
+        int timeSigDenominator = 4;
+        double initialTempo = 120.0;        // BPM of the first tempo event, or 120
+        double maxTempo = 120.0;            // fastest tempo anywhere in the tempo map
+        int numTempoChanges = 0;
+        int numTracks = 0;
+        int numEvents = 0;
+        int numNoteOns = 0;
+    };
+
+    // A number of events and the bytes of their messages.
+    struct Load
+    {
+        int numEvents = 0;
+        int numBytes = 0;
+    };
+
+    // Returns nullptr if the file contains no tracks.
+    static Ptr compile (const juce::MidiFile& file);
+
+    const Info& getInfo() const noexcept { return info; }
+
+    int getNumEvents() const noexcept { return static_cast<int> (ticks.size()); }
+    int getNumTracks() const noexcept { return info.numTracks; }
+
+    const std::vector<int64_t>& getTicks() const noexcept { return ticks; }
+    int64_t getLengthInTicks() const noexcept { return info.lengthInTicks; }
+
+    double getTicksPerQuarterNote() const noexcept { return info.ticksPerQuarterNote; }
+
+    // BPM of the first tempo event in the file, or 120 if there is none.
+    double getInitialTempo() const noexcept { return info.initialTempo; }
+
+    // Every tempo change in the file, for playing at the file's own tempo.
+    const TempoMap& getTempoMap() const noexcept { return tempoMap; }
+
+    // Approximate heap footprint, used to budget the song cache.
+    size_t getMemoryUsage() const noexcept;
+
+    // The most events, and separately the most bytes, found in any stretch of the
+    // song of the given length. Measured at compile time for lengths of 1, 2, 4...
+    // ticks, so this rounds the length up and returns an upper bound without
+    // scanning the events. Used to size output buffers before playback.
+    Load getPeakLoad (double lengthInTicks) const noexcept;
+
+    // Index of the first event whose tick is >= the given tick.
+    int findFirstEventAtOrAfter (int64_t tick) const noexcept;
+
+    // Appends the event at the given index to the buffer without allocating a MidiMessage.
+    void addEventToBuffer (int index, juce::MidiBuffer& output, int samplePosition) const;
+
+    // Copies the bytes of a short message into the array and returns how many
+    // there are, or returns 0 for a sysex or meta event.
+    int getShortMessage (int index, juce::uint8 (&bytes)[3]) const noexcept;
+
+    // Number of bytes in the message at the given index, short or long.
+    int getMessageLength (int index) const noexcept;
+
+private:
+    CompiledSong() = default;
+
+    struct LongMessage
+    {
+        uint32_t offset = 0;
+        uint32_t size = 0;
+    };
+
+    // Low 24 bits hold the status and data bytes, the top byte the message length.
+    // A length of 0 marks a long message whose low 24 bits index longMessages.
+    static constexpr uint32_t lengthShift = 24;
+    static constexpr uint32_t payloadMask = 0x00ffffff;
+
+    // Stretches of 2^0 to 2^22 ticks; the last entry is the whole song.
+    static constexpr int numPeakLoads = 24;
+
+    void measurePeakLoads();
+
+    std::vector<int64_t> ticks;
+    std::vector<uint32_t> messages;
+    std::vector<LongMessage> longMessages;
+    std::vector<juce::uint8> longMessageData;
+    TempoMap tempoMap;
+    std::array<Load, numPeakLoads> peakLoads {};
+
+    Info info;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CompiledSong)
+};
@@ -0,0 +1,70 @@
+#include "ControllerCoalescer.h"
+
+ControllerCoalescer::ControllerCoalescer()
+{
+    heldValues.fill (-1);
+}
+
+bool ControllerCoalescer::canHold (const juce::uint8* data, int size) noexcept
+{
+    const int status = data[0] & 0xf0;
+    return size == 3 && (status == 0xb0 || status == 0xe0);
+}
+
+bool ControllerCoalescer::hold (const juce::uint8* data) noexcept
+{
+    const int channelIndex = data[0] & 0x0f;
+    const int controller = (data[0] & 0xf0) == 0xe0 ? controllersPerChannel - 1 : (data[1] & 0x7f);
+    const int slot = channelIndex * controllersPerChannel + controller;
+    auto& value = heldValues[static_cast<size_t> (slot)];
+
+    const bool replaced = value >= 0;
+    value = static_cast<juce::int16> ((data[1] & 0x7f) | ((data[2] & 0x7f) << 7));
+
+    if (! replaced)
+        heldList[static_cast<size_t> (numHeld++)] = static_cast<juce::uint16> (slot);
+
+    return replaced;
+}
+
+void ControllerCoalescer::flush (juce::MidiBuffer& output, int samplePosition, int maxMessages)
+{
+    const int numToSend = juce::jlimit (0, numHeld, maxMessages);
+
+    for (int i = 0; i < numToSend; ++i)
+    {
+        const int slot = heldList[static_cast<size_t> (i)];
+        const int channelIndex = slot / controllersPerChannel;
+        const int controller = slot % controllersPerChannel;
+        auto& value = heldValues[static_cast<size_t> (slot)];
+
+        juce::uint8 bytes[3];
+
+        if (controller == controllersPerChannel - 1)
+        {
+            bytes[0] = static_cast<juce::uint8> (0xe0 | channelIndex);
+            bytes[1] = static_cast<juce::uint8> (value & 0x7f);
+        }
+        else
+        {
+            bytes[0] = static_cast<juce::uint8> (0xb0 | channelIndex);
+            bytes[1] = static_cast<juce::uint8> (controller);
+        }
+
+        bytes[2] = static_cast<juce::uint8> ((value >> 7) & 0x7f);
+        output.addEvent (bytes, 3, samplePosition);
+        value = -1;
+    }
+
+    // Keep the rest in order for the next flush
+    std::copy (heldList.begin() + numToSend, heldList.begin() + numHeld, heldList.begin());
+    numHeld -= numToSend;
+}
+
+void ControllerCoalescer::reset() noexcept
+{
+    for (int i = 0; i < numHeld; ++i)
+        heldValues[heldList[static_cast<size_t> (i)]] = -1;
+
+    numHeld = 0;
+}
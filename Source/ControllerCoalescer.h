@@ -0,0 +1,42 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+// Holds back controller and pitch-bend messages that would not fit in a block,
+// keeping only the most recent value of each, so a dense ramp collapses into a
+// single message per controller instead of being lost or growing the buffer.
+//
+// Values are kept per channel for the 128 controllers and pitch bend, together
+// with a dense list of the ones being held so flushing costs O(held values)
+// rather than a scan of all 2064 of them. Nothing here allocates.
+class ControllerCoalescer final
+{
+public:
+    ControllerCoalescer();
+
+    // True for the messages that can be held: control changes and pitch bends.
+    static bool canHold (const juce::uint8* data, int size) noexcept;
+
+    // Holds a message that canHold() accepted. Returns true if it replaced a
+    // value already held for the same controller, which is then never sent.
+    bool hold (const juce::uint8* data) noexcept;
+
+    // Adds up to maxMessages held messages at the given sample, oldest first, and
+    // keeps holding the rest.
+    void flush (juce::MidiBuffer& output, int samplePosition, int maxMessages);
+
+    int getNumHeld() const noexcept { return numHeld; }
+
+    // Forgets every held value without sending anything.
+    void reset() noexcept;
+
+private:
+    static constexpr int controllersPerChannel = 129;   // 128 controllers, then pitch bend
+    static constexpr int numSlots = 16 * controllersPerChannel;
+
+    std::array<juce::int16, numSlots> heldValues;          // data bytes packed as 7 + 7 bits, or -1
+    std::array<juce::uint16, numSlots> heldList {};        // slots of the held values, oldest first
+    int numHeld = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ControllerCoalescer)
+};
@@ -0,0 +1,331 @@
+#include <iostream>
+#include "Benchmarks.h"
+#include "MidiFileLoader.h"
+#include "PlaybackSlot.h"
+
+// Benchmarks and checks on the playback engine.
+//
+// engine replays a song through a MidiPlaybackEngine at each of the given block
+// sizes and reports the time per block, which is what every processBlock pays
+// for MIDI playback. Without a file it generates a song of --events events:
+// notes on four channels every 64th note, with the tempo changing every bar so
+// the tempo map is walked as well. Each block size is played --passes times and
+// the fastest pass counts, to keep other work on the machine out of the result.
+//
+// block-sizes plays a song through a PlaybackSlot, the way the processor does,
+// once for every block size from 1 sample up, and compares the absolute sample
+// of every event with the run at block size 1. The clock promises that the block
+// size never moves an event, so any difference is a bug. The song is looped so
+// the wrap is covered, and the notes still held at the end are released so their
+// note-offs are compared too. Without a file it plays a generated song with
+// events off the grid, a tempo change every few beats and an end that does not
+// fall on a beat, so neither events nor the loop point line up with blocks.
+
+namespace
+{
+    double getDoubleOption (const juce::ArgumentList& args, const juce::String& option, double defaultValue)
+    {
+        auto value = args.getValueForOption (option);
+        return value.isNotEmpty() ? value.getDoubleValue() : defaultValue;
+    }
+
+    int getIntOption (const juce::ArgumentList& args, const juce::String& option, int defaultValue)
+    {
+        auto value = args.getValueForOption (option);
+        return value.isNotEmpty() ? value.getIntValue() : defaultValue;
+    }
+
+    // An event as it left the engine: where it landed and a hash of its bytes
+    struct PlacedEvent
+    {
+        int64_t sample = 0;
+        juce::uint64 hash = 0;
+
+        bool operator== (const PlacedEvent& other) const noexcept { return sample == other.sample && hash == other.hash; }
+        bool operator!= (const PlacedEvent& other) const noexcept { return ! operator== (other); }
+    };
+
+    juce::uint64 hashBytes (const juce::uint8* data, int size) noexcept
+    {
+        // FNV-1a
+        juce::uint64 hash = 0xcbf29ce484222325ull;
+
+        for (int i = 0; i < size; ++i)
+            hash = (hash ^ data[i]) * 0x100000001b3ull;
+
+        return hash;
+    }
+
+    CompiledSong::Ptr generateSong (int numEvents)
+    {
+        constexpr int ticksPerQuarterNote = 480;
+        constexpr int ticksPerStep = ticksPerQuarterNote / 16;
+        constexpr int ticksPerBar = ticksPerQuarterNote * 4;
+
+        juce::MidiMessageSequence sequence;
+
+        for (int i = 0; i < numEvents / 2; ++i)
+        {
+            const int tick = i * ticksPerStep;
+            const int channel = 1 + i % 4;
+            const int note = 36 + (i * 7) % 24;
+
+            if (tick % ticksPerBar == 0)
+                sequence.addEvent (juce::MidiMessage::tempoMetaEvent ((tick / ticksPerBar) % 2 == 0 ? 500000 : 480000), tick);
+
+            sequence.addEvent (juce::MidiMessage::noteOn (channel, note, static_cast<juce::uint8> (64 + i % 64)), tick);
+            sequence.addEvent (juce::MidiMessage::noteOff (channel, note), tick + ticksPerStep / 2);
+        }
+
+        sequence.updateMatchedPairs();
+
+        juce::MidiFile file;
+        file.setTicksPerQuarterNote (ticksPerQuarterNote);
+        file.addTrack (sequence);
+
+        return CompiledSong::compile (file);
+    }
+
+    CompiledSong::Ptr generateIrregularSong()
+    {
+        constexpr int ticksPerQuarterNote = 480;
+        constexpr int lengthInTicks = ticksPerQuarterNote * 16 + 137;
+
+        juce::Random random (0x7e4d0);
+        juce::MidiMessageSequence sequence;
+
+        for (int tick = 0; tick < lengthInTicks; tick += 240 + random.nextInt (1200))
+            sequence.addEvent (juce::MidiMessage::tempoMetaEvent (300000 + random.nextInt (500000)), tick);
+
+        for (int tick = random.nextInt (30); tick < lengthInTicks; tick += 1 + random.nextInt (100))
+        {
+            const int channel = 1 + random.nextInt (4);
+            const int note = 36 + random.nextInt (24);
+            const int endTick = juce::jmin (lengthInTicks - 1, tick + 1 + random.nextInt (400));
+
+            sequence.addEvent (juce::MidiMessage::noteOn (channel, note, static_cast<juce::uint8> (1 + random.nextInt (127))), tick);
+            sequence.addEvent (juce::MidiMessage::noteOff (channel, note), endTick);
+        }
+
+        // The last event sets the loop point
+        sequence.addEvent (juce::MidiMessage::controllerEvent (1, 123, 0), lengthInTicks);
+        sequence.updateMatchedPairs();
+
+        juce::MidiFile file;
+        file.setTicksPerQuarterNote (ticksPerQuarterNote);
+        file.addTrack (sequence);
+
+        return CompiledSong::compile (file);
+    }
+
+    // Plays the whole song once in blocks of the given size and returns the seconds it took
+    double timeEngine (const CompiledSong& song, MidiPlaybackEngine& engine, const PlaybackClock& clock,
+                       juce::MidiBuffer& midi, int64_t numSamples, int blockSize)
+    {
+        engine.setSong (&song);
+
+        const auto before = juce::Time::getHighResolutionTicks();
+
+        for (int64_t blockStart = 0; blockStart < numSamples; blockStart += blockSize)
+        {
+            midi.clear();
+            engine.renderBlock (blockStart, static_cast<int> (juce::jmin<int64_t> (blockSize, numSamples - blockStart)), clock, midi);
+        }
+
+        const auto after = juce::Time::getHighResolutionTicks();
+
+        midi.clear();
+        engine.releaseActiveNotes (midi, 0);
+
+        return juce::Time::highResolutionTicksToSeconds (after - before);
+    }
+
+    std::vector<PlacedEvent> renderAtBlockSize (const CompiledSong& song, double sampleRate, double tempo,
+                                                int64_t numSamples, int blockSize)
+    {
+        juce::MidiBuffer midi;
+        std::vector<PlacedEvent> events;
+
+        // A fresh slot each time, so nothing carries over from the previous run
+        auto slot = std::make_unique<PlaybackSlot>();
+        slot->prepare (sampleRate);
+        slot->setLooping (true);
+        slot->setTempoSource (tempo > 0.0 ? PlaybackSlot::TempoSource::host : PlaybackSlot::TempoSource::file);
+        slot->setSong (&song, midi, 0);
+        slot->start();
+
+        auto addEvents = [&midi, &events] (int64_t blockStart)
+        {
+            for (const auto metadata : midi)
+                events.push_back ({ blockStart + metadata.samplePosition, hashBytes (metadata.data, metadata.numBytes) });
+        };
+
+        for (int64_t blockStart = 0; blockStart < numSamples; blockStart += blockSize)
+        {
+            midi.clear();
+            slot->render (tempo, midi, 0, static_cast<int> (juce::jmin<int64_t> (blockSize, numSamples - blockStart)));
+            addEvents (blockStart);
+        }
+
+        midi.clear();
+        slot->releaseActiveNotes (midi, 0);
+        addEvents (numSamples);
+
+        return events;
+    }
+}
+
+int Benchmarks::runEngine (const juce::ArgumentList& args)
+{
+    const double sampleRate = getDoubleOption (args, "--rate", 44100.0);
+    const int numPasses = juce::jmax (1, getIntOption (args, "--passes", 3));
+
+    auto blockSizesOption = args.getValueForOption ("--blocks");
+    if (blockSizesOption.isEmpty())
+        blockSizesOption = "32,64";
+
+    const auto blockSizes = juce::StringArray::fromTokens (blockSizesOption, ",", {});
+
+    if (sampleRate <= 0.0)
+        juce::ConsoleApplication::fail ("Invalid sample rate");
+
+    CompiledSong::Ptr song;
+    juce::String songName;
+
+    if (args.size() > 0 && ! args[0].isOption())
+    {
+        const auto songFile = args[0].resolveAsExistingFile();
+        song = MidiFileLoader::loadFile (songFile);
+        songName = songFile.getFileName();
+
+        if (song == nullptr)
+            juce::ConsoleApplication::fail ("Could not load " + songFile.getFullPathName());
+    }
+    else
+    {
+        const int numEvents = juce::jmax (2, getIntOption (args, "--events", 100000));
+        song = generateSong (numEvents);
+        songName = "generated song";
+
+        if (song == nullptr)
+            juce::ConsoleApplication::fail ("Could not generate a song");
+    }
+
+    PlaybackClock clock;
+    clock.prepare (sampleRate);
+    clock.useTempoMap (song->getTempoMap());
+
+    const int64_t numSamples = clock.tickToSample (song->getLengthInTicks() + 1);
+
+    // Room for every event at once, so the buffer never grows while being timed
+    const auto load = song->getPeakLoad (static_cast<double> (song->getLengthInTicks() + 1));
+    juce::MidiBuffer midi;
+    midi.ensureSize (static_cast<size_t> (load.numBytes + load.numEvents * 8));
+
+    MidiPlaybackEngine engine;
+
+    std::cout << songName << ": " << song->getNumEvents() << " events, "
+              << juce::String (static_cast<double> (numSamples) / sampleRate, 1) << " s at "
+              << juce::String (sampleRate, 0) << " Hz, fastest of " << numPasses
+              << (numPasses == 1 ? " pass" : " passes") << std::endl;
+
+    for (const auto& blockSizeText : blockSizes)
+    {
+        const int blockSize = blockSizeText.getIntValue();
+        if (blockSize <= 0)
+            juce::ConsoleApplication::fail ("Not a block size: " + blockSizeText);
+
+        double fastest = std::numeric_limits<double>::max();
+
+        for (int pass = 0; pass < numPasses; ++pass)
+            fastest = juce::jmin (fastest, timeEngine (*song, engine, clock, midi, numSamples, blockSize));
+
+        const double numBlocks = std::ceil (static_cast<double> (numSamples) / blockSize);
+
+        std::cout << juce::String (blockSize).paddedLeft (' ', 6) << "-sample blocks: "
+                  << juce::String (fastest * 1.0e9 / numBlocks, 1).paddedLeft (' ', 8) << " ns/block, "
+                  << juce::String (fastest * 1.0e9 / song->getNumEvents(), 1).paddedLeft (' ', 7) << " ns/event, "
+                  << juce::String (static_cast<double> (numSamples) / sampleRate / fastest, 0) << "x real time" << std::endl;
+    }
+
+    return 0;
+}
+
+int Benchmarks::checkBlockSizes (const juce::ArgumentList& args)
+{
+    const double sampleRate = getDoubleOption (args, "--rate", 44100.0);
+    const double tempo = getDoubleOption (args, "--tempo", 0.0);
+    const int numLoops = juce::jmax (1, getIntOption (args, "--loops", 2));
+    const int maxBlockSize = juce::jmax (1, getIntOption (args, "--max-block", 4096));
+
+    if (sampleRate <= 0.0)
+        juce::ConsoleApplication::fail ("Invalid sample rate");
+
+    CompiledSong::Ptr song;
+    juce::String songName;
+
+    if (args.size() > 0 && ! args[0].isOption())
+    {
+        const auto songFile = args[0].resolveAsExistingFile();
+        song = MidiFileLoader::loadFile (songFile);
+        songName = songFile.getFileName();
+
+        if (song == nullptr)
+            juce::ConsoleApplication::fail ("Could not load " + songFile.getFullPathName());
+    }
+    else
+    {
+        song = generateIrregularSong();
+        songName = "generated song";
+
+        if (song == nullptr)
+            juce::ConsoleApplication::fail ("Could not generate a song");
+    }
+
+    PlaybackClock clock;
+    clock.prepare (sampleRate);
+
+    if (tempo > 0.0)
+        clock.useFixedTempo (tempo, song->getTicksPerQuarterNote());
+    else
+        clock.useTempoMap (song->getTempoMap());
+
+    const int64_t loopLength = clock.tickToSample (song->getLengthInTicks() + 1);
+    const int64_t numSamples = loopLength * numLoops;
+
+    if (loopLength <= 0)
+        juce::ConsoleApplication::fail (songName + " has no length to play");
+
+    const auto reference = renderAtBlockSize (*song, sampleRate, tempo, numSamples, 1);
+
+    std::cout << songName << ": " << reference.size() << " events over " << numLoops
+              << (numLoops == 1 ? " pass" : " passes") << ", block sizes 1 to " << maxBlockSize << std::endl;
+
+    int numFailed = 0;
+
+    for (int blockSize = 2; blockSize <= maxBlockSize; ++blockSize)
+    {
+        const auto events = renderAtBlockSize (*song, sampleRate, tempo, numSamples, blockSize);
+
+        if (events == reference)
+            continue;
+
+        ++numFailed;
+
+        const auto mismatch = std::mismatch (reference.begin(), reference.end(), events.begin(), events.end());
+        const auto index = std::distance (reference.begin(), mismatch.first);
+
+        std::cout << "  block size " << blockSize << ": " << events.size() << " events, first difference at event " << index;
+
+        if (mismatch.first != reference.end() && mismatch.second != events.end())
+            std::cout << " (sample " << mismatch.second->sample << " instead of " << mismatch.first->sample << ")";
+
+        std::cout << std::endl;
+    }
+
+    if (numFailed > 0)
+        juce::ConsoleApplication::fail (juce::String (numFailed) + " block sizes placed events differently");
+
+    std::cout << "Every block size placed every event on the same sample" << std::endl;
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include <iostream>
+#include "Benchmarks.h"
+#include "FingerprintKernels.h"
+
+// Times similar-groove queries against libraries of different sizes, for each
+// instruction set the CPU supports.
+//
+// The libraries are random fingerprints with about as many onsets as a typical
+// drum loop, so the timings do not depend on having a large MIDI collection at
+// hand. Each query is a full FingerprintSet::findNearest call, distances and
+// selection both, and the table shows the median and worst query time.
+
+namespace
+{
+    int getIntOption (const juce::ArgumentList& args, const juce::String& option, int defaultValue)
+    {
+        auto value = args.getValueForOption (option);
+        return value.isNotEmpty() ? value.getIntValue() : defaultValue;
+    }
+
+    RhythmFingerprint makeRandomFingerprint (juce::Random& random)
+    {
+        // Roughly one step in five set, like a busy two-bar groove
+        RhythmFingerprint fingerprint;
+
+        for (auto& word : fingerprint.words)
+            word = static_cast<juce::uint64> (random.nextInt64()) & static_cast<juce::uint64> (random.nextInt64())
+                 & (static_cast<juce::uint64> (random.nextInt64()) | static_cast<juce::uint64> (random.nextInt64()));
+
+        return fingerprint;
+    }
+
+    juce::String formatMilliseconds (double seconds)
+    {
+        return juce::String (seconds * 1.0e3, 3).paddedLeft (' ', 9) + " ms";
+    }
+}
+
+int Benchmarks::runFingerprints (const juce::ArgumentList& args)
+{
+    auto sizesOption = args.getValueForOption ("--sizes");
+    if (sizesOption.isEmpty())
+        sizesOption = "1000,10000,100000,1000000";
+
+    const auto sizes = juce::StringArray::fromTokens (sizesOption, ",", {});
+
+    const int numQueries = juce::jmax (1, getIntOption (args, "--queries", 200));
+    const int numResults = juce::jmax (1, getIntOption (args, "--results", 25));
+
+    const auto best = FingerprintKernels::getBestAvailable();
+    std::vector<const FingerprintKernels*> kernelSets;
+
+    for (auto set : { FingerprintKernels::InstructionSet::scalar,
+                      FingerprintKernels::InstructionSet::popcnt,
+                      FingerprintKernels::InstructionSet::avx2 })
+        if (set <= best)
+            kernelSets.push_back (&FingerprintKernels::get (set));
+
+    juce::Random random (0x5eed);
+    std::vector<RhythmFingerprint> queries;
+
+    for (int i = 0; i < numQueries; ++i)
+        queries.push_back (makeRandomFingerprint (random));
+
+    std::cout << numQueries << " queries for the " << numResults << " nearest, median / worst per query" << std::endl;
+
+    for (const auto& sizeText : sizes)
+    {
+        const int size = sizeText.getIntValue();
+        if (size <= 0)
+            juce::ConsoleApplication::fail ("Not a library size: " + sizeText);
+
+        FingerprintSet library;
+        library.reserve (size);
+
+        for (int i = 0; i < size; ++i)
+            library.add (makeRandomFingerprint (random), i);
+
+        std::cout << juce::String (size).paddedLeft (' ', 8) << " fingerprints";
+
+        for (const auto* kernels : kernelSets)
+        {
+            std::vector<double> querySeconds;
+            querySeconds.reserve (queries.size());
+
+            for (const auto& query : queries)
+            {
+                const auto before = juce::Time::getHighResolutionTicks();
+                const auto matches = library.findNearest (query, numResults, -1, kernels);
+                const auto after = juce::Time::getHighResolutionTicks();
+
+                jassert (! matches.empty());
+                querySeconds.push_back (juce::Time::highResolutionTicksToSeconds (after - before));
+            }
+
+            std::sort (querySeconds.begin(), querySeconds.end());
+
+            std::cout << "  " << juce::String (kernels->name).paddedRight (' ', 6)
+                      << formatMilliseconds (querySeconds[querySeconds.size() / 2]) << " /"
+                      << formatMilliseconds (querySeconds.back());
+        }
+
+        std::cout << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include "FingerprintKernels.h"
+
+// The kernels use 64-bit popcount and moves, so they are only built for x86-64
+#if JUCE_INTEL && JUCE_64BIT
+ #define FINGERPRINT_KERNELS_X64 1
+ #include <immintrin.h>
+
+ // As in MixKernels, only these functions are compiled for the newer instructions
+ #if JUCE_MSVC
+  #define FINGERPRINT_KERNEL_TARGET(isa)
+ #else
+  #define FINGERPRINT_KERNEL_TARGET(isa) __attribute__ ((target (isa)))
+ #endif
+#else
+ #define FINGERPRINT_KERNELS_X64 0
+#endif
+
+namespace
+{
+    void hammingDistancesScalar (const RhythmFingerprint* fingerprints, int numFingerprints,
+                                 const RhythmFingerprint& query, juce::uint16* distances)
+    {
+        for (int i = 0; i < numFingerprints; ++i)
+        {
+            int distance = 0;
+
+            for (size_t w = 0; w < query.words.size(); ++w)
+                distance += juce::countNumberOfBitsSet (fingerprints[i].words[w] ^ query.words[w]);
+
+            distances[i] = static_cast<juce::uint16> (distance);
+        }
+    }
+
+   #if FINGERPRINT_KERNELS_X64
+    //==============================================================================
+    FINGERPRINT_KERNEL_TARGET ("popcnt")
+    void hammingDistancesPopcnt (const RhythmFingerprint* fingerprints, int numFingerprints,
+                                 const RhythmFingerprint& query, juce::uint16* distances)
+    {
+        const auto q0 = query.words[0], q1 = query.words[1], q2 = query.words[2], q3 = query.words[3];
+
+        for (int i = 0; i < numFingerprints; ++i)
+        {
+            const auto& words = fingerprints[i].words;
+
+            distances[i] = static_cast<juce::uint16> (_mm_popcnt_u64 (words[0] ^ q0) + _mm_popcnt_u64 (words[1] ^ q1)
+                                                    + _mm_popcnt_u64 (words[2] ^ q2) + _mm_popcnt_u64 (words[3] ^ q3));
+        }
+    }
+
+    //==============================================================================
+    // A whole fingerprint fits in one register. Bits are counted a nibble at a time
+    // with a table lookup, and four fingerprints are reduced together so the
+    // horizontal sums are shared.
+    FINGERPRINT_KERNEL_TARGET ("avx2")
+    inline __m256i countDifferingBits (const RhythmFingerprint& fingerprint, __m256i query, __m256i lookup, __m256i lowNibbles)
+    {
+        const auto v = _mm256_xor_si256 (_mm256_loadu_si256 (reinterpret_cast<const __m256i*> (fingerprint.words.data())), query);
+        const auto low = _mm256_shuffle_epi8 (lookup, _mm256_and_si256 (v, lowNibbles));
+        const auto high = _mm256_shuffle_epi8 (lookup, _mm256_and_si256 (_mm256_srli_epi16 (v, 4), lowNibbles));
+
+        // Sums the byte counts of each quadword
+        return _mm256_sad_epu8 (_mm256_add_epi8 (low, high), _mm256_setzero_si256());
+    }
+
+    FINGERPRINT_KERNEL_TARGET ("avx2")
+    void hammingDistancesAVX2 (const RhythmFingerprint* fingerprints, int numFingerprints,
+                               const RhythmFingerprint& query, juce::uint16* distances)
+    {
+        static_assert (sizeof (RhythmFingerprint) == 32, "A fingerprint must fill exactly one AVX register");
+
+        const auto lookup = _mm256_setr_epi8 (0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                              0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const auto lowNibbles = _mm256_set1_epi8 (0x0f);
+        const auto q = _mm256_loadu_si256 (reinterpret_cast<const __m256i*> (query.words.data()));
+
+        int i = 0;
+
+        for (; i + 4 <= numFingerprints; i += 4)
+        {
+            // Each quadword holds a partial count of at most 64, so the four
+            // fingerprints' partials are packed into 16-bit fields and summed at once
+            const auto c0 = countDifferingBits (fingerprints[i], q, lookup, lowNibbles);
+            const auto c1 = countDifferingBits (fingerprints[i + 1], q, lookup, lowNibbles);
+            const auto c2 = countDifferingBits (fingerprints[i + 2], q, lookup, lowNibbles);
+            const auto c3 = countDifferingBits (fingerprints[i + 3], q, lookup, lowNibbles);
+
+            const auto packed = _mm256_add_epi64 (_mm256_add_epi64 (c0, _mm256_slli_epi64 (c1, 16)),
+                                                  _mm256_add_epi64 (_mm256_slli_epi64 (c2, 32), _mm256_slli_epi64 (c3, 48)));
+
+            const auto halves = _mm_add_epi64 (_mm256_castsi256_si128 (packed), _mm256_extracti128_si256 (packed, 1));
+            const auto total = static_cast<juce::uint64> (_mm_cvtsi128_si64 (_mm_add_epi64 (halves, _mm_unpackhi_epi64 (halves, halves))));
+
+            for (int k = 0; k < 4; ++k)
+                distances[i + k] = static_cast<juce::uint16> ((total >> (16 * k)) & 0xffff);
+        }
+
+        hammingDistancesScalar (fingerprints + i, numFingerprints - i, query, distances + i);
+    }
+   #endif
+
+    //==============================================================================
+    const FingerprintKernels scalarKernels { hammingDistancesScalar, FingerprintKernels::InstructionSet::scalar, "scalar" };
+
+   #if FINGERPRINT_KERNELS_X64
+    const FingerprintKernels popcntKernels { hammingDistancesPopcnt, FingerprintKernels::InstructionSet::popcnt, "POPCNT" };
+    const FingerprintKernels avx2Kernels { hammingDistancesAVX2, FingerprintKernels::InstructionSet::avx2, "AVX2" };
+   #endif
+}
+
+FingerprintKernels::InstructionSet FingerprintKernels::getBestAvailable()
+{
+   #if FINGERPRINT_KERNELS_X64
+    if (juce::SystemStats::hasAVX2())
+        return InstructionSet::avx2;
+
+    // Every CPU with SSE4.2 also has POPCNT
+    if (juce::SystemStats::hasSSE42())
+        return InstructionSet::popcnt;
+   #endif
+
+    return InstructionSet::scalar;
+}
+
+const FingerprintKernels& FingerprintKernels::get()
+{
+    static const FingerprintKernels& best = get (getBestAvailable());
+    return best;
+}
+
+const FingerprintKernels& FingerprintKernels::get (InstructionSet preferred)
+{
+   #if FINGERPRINT_KERNELS_X64
+    const auto available = getBestAvailable();
+    const auto instructionSet = static_cast<int> (preferred) < static_cast<int> (available) ? preferred : available;
+
+    if (instructionSet == InstructionSet::avx2)
+        return avx2Kernels;
+
+    if (instructionSet == InstructionSet::popcnt)
+        return popcntKernels;
+   #else
+    juce::ignoreUnused (preferred);
+   #endif
+
+    return scalarKernels;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "RhythmFingerprint.h"
+
+// Hamming distance kernels for rhythm fingerprints, with POPCNT and AVX2 versions
+// chosen at run time from what the CPU supports and a scalar version for
+// everything else, in the same way as MixKernels.
+struct FingerprintKernels
+{
+    enum class InstructionSet
+    {
+        scalar,
+        popcnt,
+        avx2
+    };
+
+    // Writes the number of bits in which each fingerprint differs from the query.
+    void (*hammingDistances) (const RhythmFingerprint* fingerprints, int numFingerprints,
+                              const RhythmFingerprint& query, juce::uint16* distances);
+
+    InstructionSet instructionSet;
+    const char* name;
+
+    // The fastest kernels this CPU supports.
+    static const FingerprintKernels& get();
+
+    // The kernels for an instruction set, or the fastest supported one below it.
+    static const FingerprintKernels& get (InstructionSet preferred);
+
+    static InstructionSet getBestAvailable();
+};
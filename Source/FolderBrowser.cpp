@@ -0,0 +1,204 @@
+#include "FolderBrowser.h"
+
+FolderBrowser::FolderBrowser (const juce::File& initialFolder, const juce::String& fileExtensionsToShow)
+    : listing (fileExtensionsToShow),
+      watcher (false, fileExtensionsToShow)
+{
+    listing.onChange = [this] {
+        listingChanged();
+    };
+
+    watcher.onChanges = [this] (const FolderWatcher::Changes& changes) {
+        if (changes.eventsLost)
+            listing.refresh();
+        else
+            listing.applyChanges (changes.files);
+    };
+
+    upButton.onClick = [this] { goUp(); };
+    addAndMakeVisible (upButton);
+
+    pathEditor.onReturnKey = [this] {
+        const auto path = pathEditor.getText().trim();
+
+        if (juce::File::isAbsolutePath (path) && juce::File (path).isDirectory())
+            setFolder (juce::File (path));
+        else
+            pathEditor.setText (getFolder().getFullPathName(), false);
+    };
+    addAndMakeVisible (pathEditor);
+
+    summaryLabel.setJustificationType (juce::Justification::centredLeft);
+    summaryLabel.setFont (juce::Font (13.0f));
+    addAndMakeVisible (summaryLabel);
+
+    itemList.setModel (this);
+    itemList.setRowHeight (20);
+    addAndMakeVisible (itemList);
+
+    setFolder (initialFolder);
+}
+
+void FolderBrowser::setFolder (const juce::File& folder)
+{
+    if (folder == listing.getFolder())
+        return;
+
+    selectedName = {};
+    revealSelection = false;
+
+    pathEditor.setText (folder.getFullPathName(), false);
+    upButton.setEnabled (folder.getParentDirectory() != folder);
+
+    watcher.setFolder (folder);
+    listing.setFolder (folder);
+    itemList.getVerticalScrollBar().setCurrentRangeStart (0.0);
+}
+
+void FolderBrowser::resized()
+{
+    auto bounds = getLocalBounds().reduced (4);
+
+    auto pathRow = bounds.removeFromTop (26);
+    upButton.setBounds (pathRow.removeFromRight (50));
+    pathRow.removeFromRight (4);
+    pathEditor.setBounds (pathRow);
+
+    summaryLabel.setBounds (bounds.removeFromTop (22));
+    itemList.setBounds (bounds);
+}
+
+void FolderBrowser::listingChanged()
+{
+    itemList.updateContent();
+
+    // Put the selection back on the item wherever it has moved to, without
+    // reporting it as newly selected
+    const int row = selectedName.isNotEmpty() ? listing.indexOf (selectedName, selectedIsFolder) : -1;
+
+    if (row != itemList.getSelectedRow())
+    {
+        const juce::ScopedValueSetter<bool> restoring (restoringSelection, true);
+
+        if (row >= 0)
+            itemList.selectRow (row, true, true);
+        else
+            itemList.deselectAllRows();
+    }
+
+    if (row >= 0 && revealSelection)
+    {
+        itemList.scrollToEnsureRowIsOnscreen (row);
+        revealSelection = false;
+    }
+
+    itemList.repaint();
+    updateSummary();
+}
+
+void FolderBrowser::updateSummary()
+{
+    const int numFolders = listing.getNumFolders();
+    const int numFiles = listing.getNumItems() - numFolders;
+
+    juce::String text;
+    text << juce::String (numFolders) << (numFolders == 1 ? " folder, " : " folders, ")
+         << juce::String (numFiles) << (numFiles == 1 ? " file" : " files");
+
+    if (listing.isListing())
+        text << " so far...";
+
+    summaryLabel.setText (text, juce::dontSendNotification);
+}
+
+void FolderBrowser::goUp()
+{
+    const auto current = getFolder();
+    const auto parent = current.getParentDirectory();
+
+    if (parent == current)
+        return;
+
+    setFolder (parent);
+
+    // Land on the folder just left, once the listing reaches it
+    selectedName = current.getFileName();
+    selectedIsFolder = true;
+    revealSelection = true;
+}
+
+void FolderBrowser::openRow (int row)
+{
+    if (! juce::isPositiveAndBelow (row, listing.getNumItems()))
+        return;
+
+    const auto file = listing.getFile (row);
+
+    if (listing.getItem (row).isFolder)
+        setFolder (file);
+    else if (onFileDoubleClicked != nullptr)
+        onFileDoubleClicked (file);
+}
+
+int FolderBrowser::getNumRows()
+{
+    return listing.getNumItems();
+}
+
+void FolderBrowser::paintListBoxItem (int rowNumber, juce::Graphics& g, int width, int height, bool rowIsSelected)
+{
+    if (! juce::isPositiveAndBelow (rowNumber, listing.getNumItems()))
+        return;
+
+    if (rowIsSelected)
+        g.fillAll (findColour (juce::TextEditor::highlightColourId));
+
+    const auto& item = listing.getItem (rowNumber);
+    const auto details = item.isFolder ? juce::String ("folder")
+                                       : juce::File::descriptionOfSizeInBytes (item.fileSize) + ", "
+                                           + juce::Time (item.modificationTime).formatted ("%Y-%m-%d");
+
+    const int nameWidth = width * 3 / 5;
+
+    g.setColour (findColour (juce::ListBox::textColourId));
+    g.setFont (14.0f);
+    g.drawText (item.isFolder ? item.name + "/" : item.name, 4, 0, nameWidth - 8, height, juce::Justification::centredLeft, true);
+
+    g.setColour (findColour (juce::ListBox::textColourId).withAlpha (0.6f));
+    g.drawText (details, nameWidth, 0, width - nameWidth - 4, height, juce::Justification::centredRight, true);
+}
+
+void FolderBrowser::listBoxItemClicked (int row, const juce::MouseEvent& e)
+{
+    if (juce::isPositiveAndBelow (row, listing.getNumItems()) && ! listing.getItem (row).isFolder && onFileClicked != nullptr)
+        onFileClicked (listing.getFile (row), e);
+}
+
+void FolderBrowser::listBoxItemDoubleClicked (int row, const juce::MouseEvent&)
+{
+    openRow (row);
+}
+
+void FolderBrowser::selectedRowsChanged (int lastRowSelected)
+{
+    if (restoringSelection || ! juce::isPositiveAndBelow (lastRowSelected, listing.getNumItems()))
+        return;
+
+    const auto& item = listing.getItem (lastRowSelected);
+    selectedName = item.name;
+    selectedIsFolder = item.isFolder;
+    revealSelection = false;
+
+    if (! item.isFolder && onSelectionChanged != nullptr)
+        onSelectionChanged (listing.getFile (lastRowSelected));
+}
+
+void FolderBrowser::returnKeyPressed (int lastRowSelected)
+{
+    openRow (lastRowSelected);
+}
+
+void FolderBrowser::deleteKeyPressed (int)
+{
+    goUp();
+}
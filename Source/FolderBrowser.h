@@ -0,0 +1,63 @@
+#pragma once
+
+#include <juce_gui_basics/juce_gui_basics.h>
+#include "FolderListing.h"
+#include "FolderWatcher.h"
+
+// A folder browser for the left panel: a path box, an Up button and the
+// subfolders and MIDI files of one folder.
+//
+// The folder is listed in the background by a FolderListing and kept current by
+// a FolderWatcher, so opening a folder of any size shows its first rows at once.
+// The list only paints the rows in view. Rows move as the listing fills in, so
+// the selection follows the selected item rather than its row. Double-click or
+// press return on a folder to open it, and press backspace to go up.
+//
+// Clicking, double-clicking or selecting a file goes through the same callbacks
+// as the library search.
+class FolderBrowser final : public juce::Component,
+                            private juce::ListBoxModel
+{
+public:
+    FolderBrowser (const juce::File& initialFolder, const juce::String& fileExtensionsToShow);
+
+    void setFolder (const juce::File& folder);
+    juce::File getFolder() const { return listing.getFolder(); }
+
+    void resized() override;
+
+    std::function<void (const juce::File&, const juce::MouseEvent&)> onFileClicked;
+    std::function<void (const juce::File&)> onFileDoubleClicked;
+    std::function<void (const juce::File&)> onSelectionChanged;
+
+private:
+    void listingChanged();
+    void updateSummary();
+    void goUp();
+    void openRow (int row);
+
+    // ListBoxModel methods
+    int getNumRows() override;
+    void paintListBoxItem (int rowNumber, juce::Graphics& g, int width, int height, bool rowIsSelected) override;
+    void listBoxItemClicked (int row, const juce::MouseEvent& e) override;
+    void listBoxItemDoubleClicked (int row, const juce::MouseEvent&) override;
+    void selectedRowsChanged (int lastRowSelected) override;
+    void returnKeyPressed (int lastRowSelected) override;
+    void deleteKeyPressed (int lastRowSelected) override;
+
+    FolderListing listing;
+    FolderWatcher watcher;
+
+    juce::TextButton upButton { "Up" };
+    juce::TextEditor pathEditor;
+    juce::Label summaryLabel;
+    juce::ListBox itemList;
+
+    // The item to keep selected while rows move, and whether to scroll to it when it turns up
+    juce::String selectedName;
+    bool selectedIsFolder = false;
+    bool revealSelection = false;
+    bool restoringSelection = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FolderBrowser)
+};
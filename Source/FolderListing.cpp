@@ -0,0 +1,214 @@
+#include "FolderListing.h"
+
+FolderListing::FolderListing (const juce::String& fileExtensionsToList)
+    : juce::Thread ("Folder listing"),
+      fileExtensions (fileExtensionsToList)
+{
+    // Create the weak reference master here so the listing thread never has to.
+    juce::WeakReference<FolderListing> initialiseMaster (this);
+    juce::ignoreUnused (initialiseMaster);
+
+    startThread (juce::Thread::Priority::normal);
+}
+
+FolderListing::~FolderListing()
+{
+    ++latestGeneration;
+    signalThreadShouldExit();
+    notify();
+    stopThread (4000);
+}
+
+void FolderListing::setFolder (const juce::File& newFolder)
+{
+    folder = newFolder;
+    items.clear();
+    listing = true;
+
+    {
+        const juce::ScopedLock sl (lock);
+        requestedFolder = newFolder;
+        requestPending = true;
+        ++latestGeneration;
+    }
+
+    notify();
+
+    if (onChange != nullptr)
+        onChange();
+}
+
+void FolderListing::refresh()
+{
+    setFolder (folder);
+}
+
+void FolderListing::applyChanges (const juce::Array<juce::File>& changed)
+{
+    int numChangedHere = 0;
+
+    for (const auto& file : changed)
+    {
+        // The folder itself was moved or deleted
+        if (file == folder)
+        {
+            refresh();
+            return;
+        }
+
+        if (file.getParentDirectory() == folder)
+            ++numChangedHere;
+    }
+
+    if (numChangedHere == 0)
+        return;
+
+    // Looking at each of a big batch on the message thread would cost more than a listing
+    if (numChangedHere > maxChangesToApply)
+    {
+        refresh();
+        return;
+    }
+
+    for (const auto& file : changed)
+        if (file.getParentDirectory() == folder)
+            setItem (file);
+
+    if (onChange != nullptr)
+        onChange();
+}
+
+int FolderListing::indexOf (const juce::String& name, bool isFolder) const
+{
+    Item key;
+    key.name = name;
+    key.isFolder = isFolder;
+
+    auto it = std::lower_bound (items.begin(), items.end(), key, comesBefore);
+    return it != items.end() && it->name == name && it->isFolder == isFolder ? static_cast<int> (it - items.begin()) : -1;
+}
+
+int FolderListing::getNumFolders() const
+{
+    return static_cast<int> (std::partition_point (items.begin(), items.end(), [] (const Item& item) { return item.isFolder; })
+                             - items.begin());
+}
+
+void FolderListing::run()
+{
+    while (! threadShouldExit())
+    {
+        juce::File folderToList;
+        juce::uint32 generation = 0;
+
+        if (! takeRequest (folderToList, generation))
+        {
+            wait (-1);
+            continue;
+        }
+
+        std::vector<Item> batch;
+        size_t batchSize = firstBatchSize;
+        auto batchStart = juce::Time::getMillisecondCounter();
+
+        for (const auto& entry : juce::RangedDirectoryIterator (folderToList, false, "*",
+                                                                juce::File::findFilesAndDirectories | juce::File::ignoreHiddenFiles))
+        {
+            // A newer request makes this listing pointless
+            if (threadShouldExit() || generation != latestGeneration)
+                break;
+
+            const bool isFolder = entry.isDirectory();
+            if (! isFolder && ! entry.getFile().hasFileExtension (fileExtensions))
+                continue;
+
+            batch.push_back ({ entry.getFile().getFileName(), entry.getFileSize(),
+                               entry.getModificationTime().toMilliseconds(), isFolder });
+
+            const auto now = juce::Time::getMillisecondCounter();
+
+            if (batch.size() >= batchSize || now - batchStart >= static_cast<juce::uint32> (maxBatchMs))
+            {
+                addBatch (std::move (batch), generation, false);
+                batch = {};
+                batchSize = juce::jmin (batchSize * 2, static_cast<size_t> (maxBatchSize));
+                batchStart = now;
+            }
+        }
+
+        if (generation == latestGeneration)
+            addBatch (std::move (batch), generation, true);
+    }
+}
+
+bool FolderListing::takeRequest (juce::File& folderToList, juce::uint32& generation)
+{
+    const juce::ScopedLock sl (lock);
+
+    if (! requestPending)
+        return false;
+
+    folderToList = requestedFolder;
+    generation = latestGeneration;
+    requestPending = false;
+    return true;
+}
+
+void FolderListing::addBatch (std::vector<Item> batch, juce::uint32 generation, bool isLast)
+{
+    // Sorting here leaves the message thread only a linear merge
+    std::sort (batch.begin(), batch.end(), comesBefore);
+
+    juce::WeakReference<FolderListing> weakThis (this);
+
+    juce::MessageManager::callAsync ([weakThis, batch = std::move (batch), generation, isLast]() mutable
+    {
+        if (weakThis == nullptr || generation != weakThis->latestGeneration)
+            return;
+
+        auto& merged = weakThis->items;
+        const auto numBefore = static_cast<std::ptrdiff_t> (merged.size());
+
+        merged.insert (merged.end(), std::make_move_iterator (batch.begin()), std::make_move_iterator (batch.end()));
+        std::inplace_merge (merged.begin(), merged.begin() + numBefore, merged.end(), comesBefore);
+
+        // An item the watcher reported while the listing ran can be in both; the first is the newer
+        merged.erase (std::unique (merged.begin(), merged.end(),
+                                   [] (const Item& a, const Item& b) { return a.isFolder == b.isFolder && a.name == b.name; }),
+                      merged.end());
+
+        if (isLast)
+            weakThis->listing = false;
+
+        if (weakThis->onChange != nullptr)
+            weakThis->onChange();
+    });
+}
+
+void FolderListing::setItem (const juce::File& file)
+{
+    const auto name = file.getFileName();
+
+    // The name may have changed between a file and a folder
+    for (const bool isFolder : { false, true })
+        if (const int index = indexOf (name, isFolder); index >= 0)
+            items.erase (items.begin() + index);
+
+    const bool isFolder = file.isDirectory();
+
+    if ((! isFolder && ! (file.existsAsFile() && file.hasFileExtension (fileExtensions))) || file.isHidden())
+        return;
+
+    Item item { name, isFolder ? 0 : file.getSize(), file.getLastModificationTime().toMilliseconds(), isFolder };
+    items.insert (std::upper_bound (items.begin(), items.end(), item, comesBefore), std::move (item));
+}
+
+bool FolderListing::comesBefore (const Item& a, const Item& b) noexcept
+{
+    if (a.isFolder != b.isFolder)
+        return a.isFolder;
+
+    // Names differing only in case still need an order
+    const int order = a.name.compareNatural (b.name);
+    return order != 0 ? order < 0 : a.name < b.name;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <juce_events/juce_events.h>
+
+// The subfolders and matching files of one folder, listed on a background thread
+// for the browser.
+//
+// Nothing waits for a listing to finish. The listing thread sorts what it finds
+// in batches and hands each to the message thread, which merges it into the
+// sorted items, so the first batch can be shown at once and a folder of tens of
+// thousands of files never stalls the editor. The first batches are small so they
+// arrive within a frame, and later ones grow to keep the merging cheap. Items
+// keep only a name, size and time; the full path is made when it is asked for.
+//
+// Folders come first, then files, each in natural order by name. All methods are
+// for the message thread.
+class FolderListing final : private juce::Thread
+{
+public:
+    struct Item
+    {
+        juce::String name;
+        juce::int64 fileSize = 0;
+        juce::int64 modificationTime = 0;   // milliseconds since the epoch
+        bool isFolder = false;
+    };
+
+    // Only files with one of the extensions (such as "mid;midi") are listed.
+    explicit FolderListing (const juce::String& fileExtensionsToList);
+    ~FolderListing() override;
+
+    // Clears the items and starts listing another folder.
+    void setFolder (const juce::File& folder);
+    const juce::File& getFolder() const noexcept { return folder; }
+
+    // Lists the current folder again from scratch.
+    void refresh();
+
+    // Updates the items for files and folders reported changed by a FolderWatcher,
+    // without listing the folder again. Large batches are listed again instead.
+    void applyChanges (const juce::Array<juce::File>& changed);
+
+    bool isListing() const noexcept { return listing; }
+
+    int getNumItems() const noexcept { return static_cast<int> (items.size()); }
+    int getNumFolders() const;
+    const Item& getItem (int index) const noexcept { return items[static_cast<size_t> (index)]; }
+    juce::File getFile (int index) const { return folder.getChildFile (getItem (index).name); }
+
+    // Where an item of that name is, or -1.
+    int indexOf (const juce::String& name, bool isFolder) const;
+
+    // Called whenever items have been added, removed or changed, or a listing finished.
+    std::function<void()> onChange;
+
+private:
+    void run() override;
+
+    bool takeRequest (juce::File& folderToList, juce::uint32& generation);
+    void addBatch (std::vector<Item> batch, juce::uint32 generation, bool isLast);
+    void setItem (const juce::File& file);
+
+    static bool comesBefore (const Item& a, const Item& b) noexcept;
+
+    static constexpr int firstBatchSize = 64;
+    static constexpr int maxBatchSize = 4096;
+    static constexpr int maxBatchMs = 10;         // a batch is sent after this long even if it is not full
+    static constexpr int maxChangesToApply = 256;  // beyond this a changed folder is listed again
+
+    const juce::String fileExtensions;
+
+    juce::File folder;
+    std::vector<Item> items;
+    bool listing = false;
+
+    juce::CriticalSection lock;
+    juce::File requestedFolder;
+    bool requestPending = false;
+    std::atomic<juce::uint32> latestGeneration { 0 };
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE (FolderListing)
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FolderListing)
+};
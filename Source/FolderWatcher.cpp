@@ -0,0 +1,338 @@
+#include "FolderWatcher.h"
+
+#if JUCE_LINUX
+ #include <cerrno>
+ #include <sys/inotify.h>
+ #include <poll.h>
+ #include <unistd.h>
+#endif
+
+FolderWatcher::FolderWatcher (bool includeSubfoldersToUse, const juce::String& fileExtensionsToReport)
+    : juce::Thread ("Folder watcher"),
+      includeSubfolders (includeSubfoldersToUse),
+      fileExtensions (fileExtensionsToReport)
+{
+    // Create the weak reference master here so the watcher thread never has to.
+    juce::WeakReference<FolderWatcher> initialiseMaster (this);
+    juce::ignoreUnused (initialiseMaster);
+
+    startThread (juce::Thread::Priority::background);
+}
+
+FolderWatcher::~FolderWatcher()
+{
+    signalThreadShouldExit();
+    notify();
+    stopThread (4000);
+}
+
+void FolderWatcher::setFolder (const juce::File& folder)
+{
+    {
+        const juce::ScopedLock sl (lock);
+
+        if (folder == requestedFolder)
+            return;
+
+        requestedFolder = folder;
+        folderChangePending = true;
+    }
+
+    notify();
+}
+
+juce::File FolderWatcher::getFolder() const
+{
+    const juce::ScopedLock sl (lock);
+    return requestedFolder;
+}
+
+void FolderWatcher::run()
+{
+    juce::File folder;
+
+    while (! threadShouldExit())
+    {
+        if (takeNewFolder (folder))
+        {
+            stopWatching();
+            startWatching (folder);
+        }
+
+        if (folder == juce::File())
+        {
+            wait (-1);
+            continue;
+        }
+
+        if (usingNotifications)
+        {
+            // Wake up in time to deliver a burst, or now and then to check for a new folder
+            const auto now = juce::Time::getMillisecondCounter();
+            const int timeoutMs = pending.empty() && ! pendingEventsLost
+                                    ? 500
+                                    : juce::jlimit (0, quietMs, static_cast<int> (juce::jmin (lastPendingTime + quietMs,
+                                                                                            firstPendingTime + maxDelayMs) - now));
+            readNotifications (folder, timeoutMs);
+
+            // A folder too many to watch: the rest of this tree has to be polled
+            if (outOfWatches)
+            {
+                stopWatching();
+                snapshot = takeSnapshot (folder);
+                addPending (folder);
+            }
+        }
+        else
+        {
+            wait (pollIntervalMs);
+
+            if (threadShouldExit() || getFolder() != folder)
+                continue;
+
+            pollForChanges (folder);
+            lastPendingTime = juce::Time::getMillisecondCounter() - quietMs;
+        }
+
+        const auto now = juce::Time::getMillisecondCounter();
+
+        if ((! pending.empty() || pendingEventsLost)
+             && (now - lastPendingTime >= static_cast<juce::uint32> (quietMs)
+                  || now - firstPendingTime >= static_cast<juce::uint32> (maxDelayMs)))
+            deliverPending (folder);
+    }
+
+    stopWatching();
+}
+
+bool FolderWatcher::takeNewFolder (juce::File& folder)
+{
+    const juce::ScopedLock sl (lock);
+
+    if (! folderChangePending)
+        return false;
+
+    folder = requestedFolder;
+    folderChangePending = false;
+    return true;
+}
+
+void FolderWatcher::startWatching (const juce::File& folder)
+{
+    if (! folder.isDirectory())
+        return;
+
+   #if JUCE_LINUX
+    notifyHandle = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+
+    if (notifyHandle >= 0 && addWatches (folder))
+    {
+        usingNotifications = true;
+        return;
+    }
+
+    stopWatching();
+   #endif
+
+    snapshot = takeSnapshot (folder);
+}
+
+void FolderWatcher::stopWatching()
+{
+   #if JUCE_LINUX
+    if (notifyHandle >= 0)
+        ::close (notifyHandle);
+   #endif
+
+    notifyHandle = -1;
+    watchedFolders.clear();
+    outOfWatches = false;
+    usingNotifications = false;
+
+    snapshot.clear();
+    pending.clear();
+    pendingEventsLost = false;
+}
+
+bool FolderWatcher::addWatches (const juce::File& folder)
+{
+   #if JUCE_LINUX
+    constexpr juce::uint32 events = IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO
+                                  | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR | IN_EXCL_UNLINK;
+
+    const int watch = inotify_add_watch (notifyHandle, folder.getFullPathName().toRawUTF8(), events);
+
+    // A folder that has gone again or cannot be read is no reason to stop, but
+    // running out of watches is
+    if (watch < 0)
+        return errno != ENOSPC && errno != ENOMEM;
+
+    watchedFolders[watch] = folder;
+
+    if (includeSubfolders)
+        for (const auto& item : juce::RangedDirectoryIterator (folder, false, "*", juce::File::findDirectories))
+            if (! addWatches (item.getFile()))
+                return false;
+
+    return true;
+   #else
+    juce::ignoreUnused (folder);
+    return false;
+   #endif
+}
+
+void FolderWatcher::readNotifications (const juce::File& folder, int timeoutMs)
+{
+   #if JUCE_LINUX
+    pollfd request { notifyHandle, POLLIN, 0 };
+    if (::poll (&request, 1, timeoutMs) <= 0)
+        return;
+
+    alignas (inotify_event) char buffer[16384];
+
+    for (;;)
+    {
+        const auto numBytes = ::read (notifyHandle, buffer, sizeof (buffer));
+        if (numBytes <= 0)
+            break;
+
+        for (const char* position = buffer; position < buffer + numBytes;)
+        {
+            const auto& event = *reinterpret_cast<const inotify_event*> (position);
+            position += sizeof (inotify_event) + event.len;
+
+            if ((event.mask & IN_Q_OVERFLOW) != 0)
+            {
+                pendingEventsLost = true;
+                addPending (folder);
+                continue;
+            }
+
+            const auto watched = watchedFolders.find (event.wd);
+            if (watched == watchedFolders.end())
+                continue;
+
+            if ((event.mask & IN_IGNORED) != 0)
+            {
+                watchedFolders.erase (watched);
+                continue;
+            }
+
+            // The events of a folder itself are only news for the top one; the
+            // others are reported by their parent
+            if ((event.mask & (IN_DELETE_SELF | IN_MOVE_SELF)) != 0)
+            {
+                if (watched->second == folder)
+                    addPending (folder);
+
+                continue;
+            }
+
+            const auto file = watched->second.getChildFile (event.name);
+            const bool isFolder = (event.mask & IN_ISDIR) != 0;
+
+            // Files may land in a new folder before its watch is set, but the
+            // folder is reported itself, which covers them
+            if (isFolder && includeSubfolders && (event.mask & (IN_CREATE | IN_MOVED_TO)) != 0)
+                outOfWatches = outOfWatches || ! addWatches (file);
+
+            if (shouldReport (file, isFolder))
+                addPending (file);
+        }
+    }
+   #else
+    juce::ignoreUnused (folder, timeoutMs);
+   #endif
+}
+
+FolderWatcher::Snapshot FolderWatcher::takeSnapshot (const juce::File& folder) const
+{
+    Snapshot result;
+
+    for (const auto& item : juce::RangedDirectoryIterator (folder, includeSubfolders, "*", juce::File::findFilesAndDirectories))
+        if (shouldReport (item.getFile(), item.isDirectory()))
+            result[item.getFile().getFullPathName()] = { item.getFileSize(), item.getModificationTime().toMilliseconds(), item.isDirectory() };
+
+    return result;
+}
+
+void FolderWatcher::pollForChanges (const juce::File& folder)
+{
+    auto latest = takeSnapshot (folder);
+
+    // Both listings are sorted by path, so one pass finds what was added, removed or changed
+    auto before = snapshot.begin();
+    auto after = latest.begin();
+
+    while (before != snapshot.end() || after != latest.end())
+    {
+        if (after == latest.end() || (before != snapshot.end() && before->first < after->first))
+        {
+            addPending (juce::File (before->first));
+            ++before;
+        }
+        else if (before == snapshot.end() || after->first < before->first)
+        {
+            addPending (juce::File (after->first));
+            ++after;
+        }
+        else
+        {
+            // A folder's own time changes with what is in it, which is reported anyway
+            if (! after->second.isFolder
+                 && (before->second.fileSize != after->second.fileSize
+                      || before->second.modificationTime != after->second.modificationTime))
+                addPending (juce::File (after->first));
+
+            ++before;
+            ++after;
+        }
+    }
+
+    snapshot = std::move (latest);
+}
+
+bool FolderWatcher::shouldReport (const juce::File& file, bool isFolder) const
+{
+    return isFolder || fileExtensions.isEmpty() || file.hasFileExtension (fileExtensions);
+}
+
+void FolderWatcher::addPending (const juce::File& file)
+{
+    const auto now = juce::Time::getMillisecondCounter();
+
+    if (pending.empty())
+        firstPendingTime = now;
+
+    lastPendingTime = now;
+    pending.insert (file);
+}
+
+void FolderWatcher::deliverPending (const juce::File& folder)
+{
+    Changes changes;
+    changes.eventsLost = pendingEventsLost;
+
+    for (const auto& file : pending)
+    {
+        // Leave out whatever is in a folder that is reported itself
+        bool isCovered = false;
+
+        for (auto parent = file.getParentDirectory(); parent.isAChildOf (folder) && ! isCovered; parent = parent.getParentDirectory())
+            isCovered = pending.count (parent) > 0;
+
+        if (! isCovered && (file == folder || file.isAChildOf (folder)))
+            changes.files.add (file);
+    }
+
+    pending.clear();
+    pendingEventsLost = false;
+
+    juce::WeakReference<FolderWatcher> weakThis (this);
+
+    juce::MessageManager::callAsync ([weakThis, changes]
+    {
+        if (weakThis != nullptr && weakThis->onChanges != nullptr)
+            weakThis->onChanges (changes);
+    });
+}
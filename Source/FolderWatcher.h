@@ -0,0 +1,93 @@
+#pragma once
+
+#include <juce_events/juce_events.h>
+
+// Reports the files and folders that appear, disappear or change under a folder,
+// so the things that show or index it can update just those instead of listing
+// it again.
+//
+// On Linux the watcher thread is told of changes by inotify, with a watch on
+// every folder in the tree. Elsewhere, or when the system runs out of inotify
+// watches, it compares a listing of the tree with the previous one every few
+// seconds instead.
+//
+// Bursts of changes, such as unzipping a pack of thousands of files, are gathered
+// up and reported together once things go quiet for a moment, or every couple of
+// seconds while the burst goes on. A folder reported as changed stands for
+// everything in it, so its contents are not reported as well.
+class FolderWatcher final : private juce::Thread
+{
+public:
+    struct Changes
+    {
+        juce::Array<juce::File> files;   // files and folders that were created, changed, moved or deleted
+        bool eventsLost = false;         // true if the system dropped events, so anything may have changed
+    };
+
+    // Only files with one of the extensions (such as "mid;midi") are reported;
+    // folders always are.
+    FolderWatcher (bool includeSubfolders, const juce::String& fileExtensionsToReport);
+    ~FolderWatcher() override;
+
+    // Message thread: watches another folder, or none.
+    void setFolder (const juce::File& folder);
+    juce::File getFolder() const;
+
+    // False while the watcher has to poll for changes.
+    bool isUsingNotifications() const noexcept { return usingNotifications; }
+
+    // Called on the message thread with each batch of changes.
+    std::function<void (const Changes&)> onChanges;
+
+private:
+    struct SnapshotEntry
+    {
+        juce::int64 fileSize = 0;
+        juce::int64 modificationTime = 0;
+        bool isFolder = false;
+    };
+
+    using Snapshot = std::map<juce::String, SnapshotEntry>;
+
+    void run() override;
+
+    bool takeNewFolder (juce::File& folder);
+    void startWatching (const juce::File& folder);
+    void stopWatching();
+
+    bool addWatches (const juce::File& folder);
+    void readNotifications (const juce::File& folder, int timeoutMs);
+
+    Snapshot takeSnapshot (const juce::File& folder) const;
+    void pollForChanges (const juce::File& folder);
+
+    bool shouldReport (const juce::File& file, bool isFolder) const;
+    void addPending (const juce::File& file);
+    void deliverPending (const juce::File& folder);
+
+    static constexpr int quietMs = 250;         // a burst is reported once no change has come for this long
+    static constexpr int maxDelayMs = 2000;     // but at least this often while it goes on
+    static constexpr int pollIntervalMs = 5000;
+
+    const bool includeSubfolders;
+    const juce::String fileExtensions;
+
+    mutable juce::CriticalSection lock;
+    juce::File requestedFolder;
+    bool folderChangePending = false;
+
+    std::atomic<bool> usingNotifications { false };
+
+    // Watcher thread only
+    int notifyHandle = -1;
+    std::map<int, juce::File> watchedFolders;
+    bool outOfWatches = false;
+    Snapshot snapshot;
+    std::set<juce::File> pending;
+    bool pendingEventsLost = false;
+    juce::uint32 firstPendingTime = 0;
+    juce::uint32 lastPendingTime = 0;
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE (FolderWatcher)
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FolderWatcher)
+};
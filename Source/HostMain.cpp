@@ -0,0 +1,466 @@
+#include <iostream>
+#include <thread>
+#include "PluginProcessor.h"
+
+// Headless host for the plugin: runs MidiFartSnifferProcessor under a synthetic
+// transport and times every processBlock call, for profiling and for checking
+// the engine on machines without a DAW or a display:
+//
+//     midifart-host <song.mid> [--rate=Hz] [--block=samples] [--seconds=N] [--tempo=BPM]
+//                   [--sig=4/4] [--loop-bars=N] [--lock] [--layers=N] [--kit=folder]
+//                   [--audition] [--thin] [--realtime] [--csv=file] [--strict]
+//
+// The host transport runs from the first block. With --lock the song follows the
+// host's position, otherwise it is started like the Play button does; --loop-bars
+// makes the host loop, so the song is re-seeked every time round. --layers plays
+// the file in that many extra layers too. --realtime waits out each block's
+// duration like a sound card would, rather than calling back to back.
+//
+// The report gives the callback time distribution against the block's deadline.
+// --csv writes the time of every callback, and --strict makes a missed deadline
+// an error, so the run can be used as a regression check.
+//
+//     midifart-host commands [--block=samples] [--seconds=N]
+//
+// checks the transport commands and slot settings across threads instead. A
+// thread calls processBlock at the block rate, stalling for a few hundred
+// milliseconds now and then, while the main thread calls the transport controls
+// and slot setters at random as fast as it can. It ends with play, stop and a
+// seek, and the song must then be stopped at that tick; played once more, every
+// slot must be muted or not, and on the channel, as last set. It fails with a
+// non-zero exit code, and is registered with CTest.
+
+namespace
+{
+    class SyntheticPlayHead final : public juce::AudioPlayHead
+    {
+    public:
+        SyntheticPlayHead (double sampleRateToUse, double tempoToUse, int numeratorToUse, int denominatorToUse, int loopBarsToUse)
+            : sampleRate (sampleRateToUse), tempo (tempoToUse),
+              numerator (numeratorToUse), denominator (denominatorToUse), loopBars (loopBarsToUse)
+        {
+        }
+
+        juce::Optional<PositionInfo> getPosition() const override
+        {
+            const double barLength = numerator * 4.0 / denominator;
+            const double loopLength = loopBars * barLength;
+
+            double ppq = static_cast<double> (samplePosition) / sampleRate * tempo / 60.0;
+            if (loopLength > 0.0)
+                ppq = std::fmod (ppq, loopLength);
+
+            PositionInfo info;
+            info.setBpm (tempo);
+            info.setTimeSignature (TimeSignature { numerator, denominator });
+            info.setTimeInSamples (samplePosition);
+            info.setPpqPosition (ppq);
+            info.setPpqPositionOfLastBarStart (std::floor (ppq / barLength) * barLength);
+            info.setIsPlaying (true);
+
+            if (loopLength > 0.0)
+            {
+                info.setIsLooping (true);
+                info.setLoopPoints (LoopPoints { 0.0, loopLength });
+            }
+
+            return info;
+        }
+
+        void advance (int numSamples) noexcept { samplePosition += numSamples; }
+
+    private:
+        const double sampleRate;
+        const double tempo;
+        const int numerator;
+        const int denominator;
+        const int loopBars;
+        juce::int64 samplePosition = 0;
+    };
+
+    double getDoubleOption (const juce::ArgumentList& args, const juce::String& option, double defaultValue)
+    {
+        auto value = args.getValueForOption (option);
+        return value.isNotEmpty() ? value.getDoubleValue() : defaultValue;
+    }
+
+    int getIntOption (const juce::ArgumentList& args, const juce::String& option, int defaultValue)
+    {
+        auto value = args.getValueForOption (option);
+        return value.isNotEmpty() ? value.getIntValue() : defaultValue;
+    }
+
+    double getPercentile (const std::vector<double>& sorted, double percent)
+    {
+        const auto index = static_cast<size_t> (std::ceil (percent / 100.0 * static_cast<double> (sorted.size()))) - 1;
+        return sorted[juce::jmin (index, sorted.size() - 1)];
+    }
+
+    juce::String formatMicroseconds (double seconds)
+    {
+        return juce::String (seconds * 1.0e6, 1) + " us";
+    }
+
+    // One note a beat for 64 bars at 120 BPM, on channel 10; the note tells the slots apart
+    juce::MidiFile makeBeatSong (int noteNumber)
+    {
+        constexpr int ticksPerQuarterNote = 480;
+
+        juce::MidiMessageSequence sequence;
+        sequence.addEvent (juce::MidiMessage::tempoMetaEvent (500000), 0.0);
+
+        for (int beat = 0; beat < 256; ++beat)
+        {
+            sequence.addEvent (juce::MidiMessage::noteOn (10, noteNumber, static_cast<juce::uint8> (100)), beat * ticksPerQuarterNote);
+            sequence.addEvent (juce::MidiMessage::noteOff (10, noteNumber), beat * ticksPerQuarterNote + ticksPerQuarterNote / 2);
+        }
+
+        sequence.updateMatchedPairs();
+
+        juce::MidiFile file;
+        file.setTicksPerQuarterNote (ticksPerQuarterNote);
+        file.addTrack (sequence);
+        return file;
+    }
+
+    // Calls processBlock at the block rate, like a sound card, and now and then
+    // stalls for long enough to let the transport commands pile up
+    class BlockCaller final : public juce::Thread
+    {
+    public:
+        BlockCaller (MidiFartSnifferProcessor& processorToCall, SyntheticPlayHead& playHeadToAdvance, double sampleRate, int blockSizeToUse)
+            : juce::Thread ("Block caller"), processor (processorToCall), playHead (playHeadToAdvance),
+              blockSize (blockSizeToUse), blockTicks (juce::Time::secondsToHighResolutionTicks (blockSizeToUse / sampleRate))
+        {
+        }
+
+        void run() override
+        {
+            juce::Random random (0x57a1);
+            juce::AudioBuffer<float> buffer (juce::jmax (2, processor.getTotalNumInputChannels(), processor.getTotalNumOutputChannels()), blockSize);
+            juce::MidiBuffer midi;
+            auto due = juce::Time::getHighResolutionTicks();
+
+            while (! threadShouldExit())
+            {
+                buffer.clear();
+                midi.clear();
+                processor.processBlock (buffer, midi);
+                playHead.advance (blockSize);
+                ++numBlocks;
+
+                due += blockTicks;
+
+                if (random.nextInt (200) == 0)
+                {
+                    due += juce::Time::secondsToHighResolutionTicks ((100 + random.nextInt (201)) * 0.001);
+                    ++numStalls;
+                }
+
+                while (! threadShouldExit() && juce::Time::getHighResolutionTicks() < due)
+                {
+                    if (juce::Time::highResolutionTicksToSeconds (due - juce::Time::getHighResolutionTicks()) > 0.002)
+                        juce::Thread::sleep (1);
+                    else
+                        std::this_thread::yield();
+                }
+            }
+        }
+
+        std::atomic<int> numBlocks { 0 };
+        int numStalls = 0;   // read once the thread has stopped
+
+    private:
+        MidiFartSnifferProcessor& processor;
+        SyntheticPlayHead& playHead;
+        const int blockSize;
+        const juce::int64 blockTicks;
+    };
+
+    int checkCommands (const juce::ArgumentList& args)
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int numSlots = MidiFartSnifferProcessor::numSlots;
+        const int blockSize = juce::jmax (1, getIntOption (args, "--block", 256));
+        const double seconds = juce::jmax (0.1, getDoubleOption (args, "--seconds", 3.0));
+
+        MidiFartSnifferProcessor processor;
+        SyntheticPlayHead playHead (sampleRate, 120.0, 4, 4, 0);
+
+        // The main song and a layer in every other slot, each on its own note
+        std::vector<std::unique_ptr<juce::TemporaryFile>> songFiles;
+
+        for (int slot = 0; slot < numSlots; ++slot)
+        {
+            songFiles.push_back (std::make_unique<juce::TemporaryFile> (".mid"));
+            const auto file = songFiles.back()->getFile();
+
+            {
+                juce::FileOutputStream out (file);
+                if (! out.openedOk() || ! makeBeatSong (36 + slot).writeTo (out))
+                    juce::ConsoleApplication::fail ("Could not write " + file.getFullPathName());
+            }
+
+            if (slot == 0)
+                processor.loadMidiFile (file);
+            else if (! processor.loadLayer (slot, file))
+                juce::ConsoleApplication::fail ("Could not load a layer from " + file.getFullPathName());
+        }
+
+        if (processor.getSongInfo().numTracks <= 0)
+            juce::ConsoleApplication::fail ("Could not load the generated song");
+
+        processor.setPlayHead (&playHead);
+        processor.setRateAndBufferSizeDetails (sampleRate, blockSize);
+        processor.prepareToPlay (sampleRate, blockSize);
+
+        BlockCaller caller (processor, playHead, sampleRate, blockSize);
+        caller.startThread (juce::Thread::Priority::highest);
+
+        juce::Random random (0xc0de);
+        std::array<bool, numSlots> muted {};
+        std::array<int, numSlots> channels {};
+        int numCalls = 0;
+        const auto endTime = juce::Time::getMillisecondCounterHiRes() + seconds * 1000.0;
+
+        while (juce::Time::getMillisecondCounterHiRes() < endTime)
+        {
+            const int slot = random.nextInt (numSlots);
+
+            switch (random.nextInt (8))
+            {
+                case 0:  processor.startPlayback(); break;
+                case 1:  processor.stopPlayback(); break;
+                case 2:  processor.seek (random.nextInt (256) * 480.0); break;
+                case 3:  processor.setSlotLooping (slot, random.nextBool()); break;
+                case 4:  processor.setSlotFollowsHostTempo (slot, random.nextBool()); break;
+                case 5:  muted[static_cast<size_t> (slot)] = random.nextBool(); processor.setSlotMuted (slot, muted[static_cast<size_t> (slot)]); break;
+                case 6:  channels[static_cast<size_t> (slot)] = random.nextInt (17); processor.setSlotOutputChannel (slot, channels[static_cast<size_t> (slot)]); break;
+                default: processor.setLockToHostPosition (random.nextBool()); processor.setStartOnNextBar (random.nextBool()); break;
+            }
+
+            // Bursts, so the commands both queue and overflow
+            if (++numCalls % 64 == 0)
+                std::this_thread::yield();
+        }
+
+        // End stopped at a known tick, going by nothing but the commands
+        processor.setLockToHostPosition (false);
+        processor.setStartOnNextBar (false);
+        processor.startPlayback();
+        processor.stopPlayback();
+
+        const int64_t finalTick = random.nextInt (256) * 480;
+        processor.seek (static_cast<double> (finalTick));
+
+        // Longer than the longest stall, then a few blocks more to be sure
+        juce::Thread::sleep (500);
+
+        const int blocksSeen = caller.numBlocks;
+        const auto giveUpTime = juce::Time::getMillisecondCounter() + 10000;
+
+        while (caller.numBlocks < blocksSeen + 4 && juce::Time::getMillisecondCounter() < giveUpTime)
+            juce::Thread::sleep (1);
+
+        caller.stopThread (1000);
+
+        const auto snapshot = processor.getPlaybackSnapshot();
+
+        // Play two seconds on this thread and sort the notes by slot
+        processor.startPlayback();
+
+        juce::AudioBuffer<float> buffer (juce::jmax (2, processor.getTotalNumInputChannels(), processor.getTotalNumOutputChannels()), blockSize);
+        juce::MidiBuffer midi;
+        std::array<int, numSlots> numNotes {};
+        int numWrongChannel = 0;
+
+        for (int block = 0; block < static_cast<int> (2.0 * sampleRate / blockSize) + 1; ++block)
+        {
+            buffer.clear();
+            midi.clear();
+            processor.processBlock (buffer, midi);
+            playHead.advance (blockSize);
+
+            for (const auto metadata : midi)
+            {
+                const auto message = metadata.getMessage();
+                const int slot = message.getNoteNumber() - 36;
+
+                if (! message.isNoteOn() || ! juce::isPositiveAndBelow (slot, numSlots))
+                    continue;
+
+                const int channel = channels[static_cast<size_t> (slot)];
+                ++numNotes[static_cast<size_t> (slot)];
+                numWrongChannel += message.getChannel() == (channel > 0 ? channel : 10) ? 0 : 1;
+            }
+        }
+
+        processor.releaseResources();
+
+        int numFailures = 0;
+
+        std::cout << "Commands: " << numCalls << " calls over " << caller.numBlocks.load() << " blocks of " << blockSize
+                  << ", " << caller.numStalls << " stalls" << std::endl
+                  << "  ended " << (snapshot.isPlaying ? "playing" : "stopped") << " at tick " << snapshot.tick
+                  << ", expected stopped at tick " << finalTick << std::endl;
+
+        if (snapshot.isPlaying || snapshot.tick != finalTick)
+            ++numFailures;
+
+        for (int slot = 0; slot < numSlots; ++slot)
+        {
+            const bool isMuted = muted[static_cast<size_t> (slot)];
+            const int notes = numNotes[static_cast<size_t> (slot)];
+
+            std::cout << "  slot " << slot << ": " << (isMuted ? "muted" : "not muted") << ", channel "
+                      << channels[static_cast<size_t> (slot)] << ", " << notes << " notes" << std::endl;
+
+            if (isMuted != (notes == 0))
+                ++numFailures;
+        }
+
+        std::cout << "  " << numWrongChannel << " notes on the wrong channel" << std::endl;
+
+        if (numWrongChannel > 0)
+            ++numFailures;
+
+        if (numFailures > 0)
+            juce::ConsoleApplication::fail ("The transport commands or slot settings did not take effect");
+
+        return 0;
+    }
+
+    int run (const juce::ArgumentList& args)
+    {
+        args.checkMinNumArguments (1);
+
+        const auto songFile = args[0].resolveAsExistingFile();
+        const double sampleRate = getDoubleOption (args, "--rate", 48000.0);
+        const int blockSize = juce::jmax (1, getIntOption (args, "--block", 256));
+        const double seconds = getDoubleOption (args, "--seconds", 60.0);
+        const double tempo = getDoubleOption (args, "--tempo", 120.0);
+        const int numLayers = juce::jlimit (0, MidiFartSnifferProcessor::numSlots - 1, getIntOption (args, "--layers", 0));
+        const bool lockToHost = args.containsOption ("--lock");
+        const bool realtime = args.containsOption ("--realtime");
+
+        auto signature = juce::StringArray::fromTokens (args.getValueForOption ("--sig"), "/", {});
+        const int numerator = signature.size() == 2 ? juce::jmax (1, signature[0].getIntValue()) : 4;
+        const int denominator = signature.size() == 2 ? juce::jmax (1, signature[1].getIntValue()) : 4;
+
+        MidiFartSnifferProcessor processor;
+        SyntheticPlayHead playHead (sampleRate, tempo, numerator, denominator,
+                                    juce::jmax (0, getIntOption (args, "--loop-bars", 0)));
+
+        processor.loadMidiFile (songFile);
+        if (processor.getSongInfo().numTracks <= 0)
+            juce::ConsoleApplication::fail ("Could not load " + songFile.getFullPathName());
+
+        for (int slot = 1; slot <= numLayers; ++slot)
+        {
+            processor.loadLayer (slot, songFile);
+            processor.setSlotLooping (slot, true);
+        }
+
+        if (args.containsOption ("--kit") && ! processor.loadSampleKit (args.getExistingFolderForOption ("--kit")))
+            juce::ConsoleApplication::fail ("No samples found in " + args.getValueForOption ("--kit"));
+
+        processor.setAuditionEnabled (args.containsOption ("--audition"));
+        processor.setThinningEnabled (args.containsOption ("--thin"));
+        processor.setPlayHead (&playHead);
+        processor.setRateAndBufferSizeDetails (sampleRate, blockSize);
+        processor.prepareToPlay (sampleRate, blockSize);
+
+        processor.setLooping (true);
+        processor.setLockToHostPosition (lockToHost);
+        if (! lockToHost)
+            processor.startPlayback();
+
+        const int numBlocks = juce::jmax (1, static_cast<int> (seconds * sampleRate / blockSize));
+        const double deadline = blockSize / sampleRate;
+
+        juce::AudioBuffer<float> buffer (juce::jmax (2, processor.getTotalNumInputChannels(), processor.getTotalNumOutputChannels()), blockSize);
+        juce::MidiBuffer midi;
+        std::vector<double> callbackSeconds (static_cast<size_t> (numBlocks));
+        juce::int64 numEventsOut = 0;
+
+        const double startTime = juce::Time::getMillisecondCounterHiRes();
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            buffer.clear();
+            midi.clear();
+
+            const auto before = juce::Time::getHighResolutionTicks();
+            processor.processBlock (buffer, midi);
+            const auto after = juce::Time::getHighResolutionTicks();
+
+            callbackSeconds[static_cast<size_t> (block)] = juce::Time::highResolutionTicksToSeconds (after - before);
+            numEventsOut += midi.getNumEvents();
+            playHead.advance (blockSize);
+
+            if (realtime)
+            {
+                const double due = startTime + (block + 1) * deadline * 1000.0;
+                const double wait = due - juce::Time::getMillisecondCounterHiRes();
+
+                if (wait > 1.0)
+                    juce::Thread::sleep (static_cast<int> (wait));
+            }
+        }
+
+        const double wallSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) * 0.001;
+        processor.releaseResources();
+
+        if (args.containsOption ("--csv"))
+        {
+            juce::String csv ("block,microseconds\n");
+            for (size_t i = 0; i < callbackSeconds.size(); ++i)
+                csv << juce::String (static_cast<int> (i)) << ',' << juce::String (callbackSeconds[i] * 1.0e6, 2) << '\n';
+
+            const auto csvFile = args.getFileForOption ("--csv");
+            if (! csvFile.replaceWithText (csv))
+                juce::ConsoleApplication::fail ("Could not write " + csvFile.getFullPathName());
+        }
+
+        auto sorted = callbackSeconds;
+        std::sort (sorted.begin(), sorted.end());
+
+        double totalSeconds = 0.0;
+        for (auto s : sorted)
+            totalSeconds += s;
+
+        const auto numMissed = static_cast<int> (sorted.end() - std::upper_bound (sorted.begin(), sorted.end(), deadline));
+
+        std::cout << songFile.getFileName() << ": " << numBlocks << " blocks of " << blockSize << " at "
+                  << juce::String (sampleRate, 0) << " Hz, deadline " << formatMicroseconds (deadline) << std::endl
+                  << "  min " << formatMicroseconds (sorted.front())
+                  << ", mean " << formatMicroseconds (totalSeconds / numBlocks)
+                  << ", p50 " << formatMicroseconds (getPercentile (sorted, 50.0))
+                  << ", p99 " << formatMicroseconds (getPercentile (sorted, 99.0))
+                  << ", p99.9 " << formatMicroseconds (getPercentile (sorted, 99.9))
+                  << ", max " << formatMicroseconds (sorted.back()) << std::endl
+                  << "  load " << juce::String (100.0 * totalSeconds / (numBlocks * deadline), 2) << "%, "
+                  << numMissed << " over deadline, "
+                  << numEventsOut << " MIDI events out ("
+                  << processor.getNumCoalescedEvents() << " coalesced, "
+                  << processor.getNumDroppedEvents() << " dropped), "
+                  << juce::String (wallSeconds, 2) << " s wall" << std::endl;
+
+        if (args.containsOption ("--strict") && numMissed > 0)
+            juce::ConsoleApplication::fail (juce::String (numMissed) + " callbacks missed their deadline");
+
+        return 0;
+    }
+}
+
+int main (int argc, char* argv[])
+{
+    // The processor's loaders and timers expect a message manager
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::ArgumentList args (argc, argv);
+    return juce::ConsoleApplication::invokeCatchingFailures ([&args]
+    {
+        return args.size() > 0 && args[0].text == "commands" ? checkCommands (args) : run (args);
+    });
+}
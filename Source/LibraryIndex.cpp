@@ -0,0 +1,395 @@
+#include "LibraryIndex.h"
+#include "MidiFileLoader.h"
+
+namespace
+{
+    void addSaturating (juce::uint16& count) noexcept
+    {
+        if (count < std::numeric_limits<juce::uint16>::max())
+            ++count;
+    }
+
+    float getTempoOfSegment (const TempoMap::Segment& segment, double ticksPerQuarterNote) noexcept
+    {
+        return static_cast<float> (60.0 / (segment.secondsPerTick * ticksPerQuarterNote));
+    }
+}
+
+LibraryIndex::Entry LibraryIndex::readEntry (const juce::File& file)
+{
+    Entry entry;
+    entry.path = file.getFileName();
+    entry.fileSize = file.getSize();
+    entry.modificationTime = file.getLastModificationTime().toMilliseconds();
+
+    auto song = MidiFileLoader::loadFile (file);
+    if (song == nullptr)
+        return entry;
+
+    const auto& info = song->getInfo();
+    entry.isReadable = true;
+    entry.initialTempo = static_cast<float> (info.initialTempo);
+    entry.lengthInBars = static_cast<float> (info.lengthInBars);
+    entry.lengthInSeconds = static_cast<float> (info.lengthInSeconds);
+    entry.ticksPerQuarterNote = static_cast<juce::uint16> (juce::jlimit (0.0, 65535.0, info.ticksPerQuarterNote));
+    entry.numTracks = static_cast<juce::uint16> (juce::jmin (info.numTracks, 65535));
+    entry.timeSigNumerator = static_cast<juce::uint8> (juce::jlimit (1, 255, info.timeSigNumerator));
+    entry.timeSigDenominator = static_cast<juce::uint8> (juce::jlimit (1, 255, info.timeSigDenominator));
+
+    // The tempo map starts with a 120 BPM segment that only counts if a tick of
+    // the song falls in it, so take the range over the segments the song reaches
+    const auto& tempoMap = song->getTempoMap();
+    entry.minTempo = entry.maxTempo = entry.initialTempo;
+
+    for (int i = 0; i < tempoMap.getNumSegments(); ++i)
+    {
+        const auto& segment = tempoMap.getSegment (i);
+        if (segment.startTick > info.lengthInTicks || segment.secondsPerTick <= 0.0)
+            continue;
+
+        const float tempo = getTempoOfSegment (segment, info.ticksPerQuarterNote);
+        entry.minTempo = juce::jmin (entry.minTempo, tempo);
+        entry.maxTempo = juce::jmax (entry.maxTempo, tempo);
+    }
+
+    for (int i = 0; i < song->getNumEvents(); ++i)
+    {
+        juce::uint8 bytes[3];
+        if (song->getShortMessage (i, bytes) != 3 || (bytes[0] & 0xf0) != 0x90 || bytes[2] == 0)
+            continue;
+
+        ++entry.numNotes;
+        addSaturating (entry.noteCounts[bytes[1] & 0x7f]);
+        addSaturating (entry.channelCounts[bytes[0] & 0x0f]);
+    }
+
+    entry.fingerprint = RhythmFingerprint::compute (*song);
+    return entry;
+}
+
+LibraryIndex::Ptr LibraryIndex::build (const juce::File& root, const LibraryIndex* previous, int numThreads,
+                                       Progress& progress, const std::atomic<bool>& shouldStop)
+{
+    std::vector<FoundFile> found;
+    findFiles (root, root, found, progress, shouldStop);
+
+    if (shouldStop)
+        return nullptr;
+
+    std::sort (found.begin(), found.end(), [] (const FoundFile& a, const FoundFile& b) { return a.path < b.path; });
+
+    Ptr index (new LibraryIndex (root));
+    index->entries.resize (found.size());
+
+    const bool canReuse = previous != nullptr && previous->root == root;
+    std::vector<size_t> toRead;
+
+    for (size_t i = 0; i < found.size(); ++i)
+    {
+        const auto& file = found[i];
+        auto& entry = index->entries[i];
+
+        if (const auto* old = canReuse ? previous->findEntry (file.path) : nullptr;
+            old != nullptr && isCurrent (*old, file.fileSize, file.modificationTime))
+        {
+            entry = *old;
+            ++index->numReused;
+            ++progress.numDone;
+        }
+        else
+        {
+            toRead.push_back (i);
+        }
+    }
+
+    readEntries (found, toRead, index->entries.data(), numThreads, progress, shouldStop);
+
+    if (shouldStop)
+        return nullptr;
+
+    return index;
+}
+
+LibraryIndex::Ptr LibraryIndex::update (const LibraryIndex& previous, const juce::Array<juce::File>& changed, int numThreads,
+                                        Progress& progress, const std::atomic<bool>& shouldStop)
+{
+    const auto& root = previous.root;
+
+    // The root itself moving or going away changes everything
+    if (changed.contains (root))
+        return build (root, &previous, numThreads, progress, shouldStop);
+
+    // Each changed path replaces the entries at or under it with what is there now
+    std::vector<juce::String> replaced;
+    std::vector<FoundFile> found;
+
+    for (const auto& file : changed)
+    {
+        if (shouldStop)
+            return nullptr;
+
+        if (! file.isAChildOf (root))
+            continue;
+
+        replaced.push_back (getRelativePath (root, file));
+
+        if (file.isDirectory())
+        {
+            findFiles (root, file, found, progress, shouldStop);
+        }
+        else if (file.existsAsFile() && file.hasFileExtension ("mid;midi"))
+        {
+            found.push_back ({ file, replaced.back(), file.getSize(), file.getLastModificationTime().toMilliseconds() });
+            progress.numFound = static_cast<int> (found.size());
+        }
+    }
+
+    std::sort (replaced.begin(), replaced.end());
+    std::sort (found.begin(), found.end(), [] (const FoundFile& a, const FoundFile& b) { return a.path < b.path; });
+    found.erase (std::unique (found.begin(), found.end(), [] (const FoundFile& a, const FoundFile& b) { return a.path == b.path; }),
+                 found.end());
+
+    // An entry is replaced if its path or that of a folder above it changed
+    auto isReplaced = [&replaced] (const juce::String& path)
+    {
+        for (int end = path.length(); end > 0; end = path.substring (0, end).lastIndexOfChar ('/'))
+            if (std::binary_search (replaced.begin(), replaced.end(), path.substring (0, end)))
+                return true;
+
+        return false;
+    };
+
+    Ptr index (new LibraryIndex (root));
+    index->entries.reserve (static_cast<size_t> (previous.getNumEntries()) + found.size());
+
+    for (const auto& entry : previous.entries)
+        if (! isReplaced (entry.path))
+            index->entries.push_back (entry);
+
+    const auto numKept = index->entries.size();
+    index->entries.resize (numKept + found.size());
+
+    std::vector<size_t> toRead;
+
+    for (size_t i = 0; i < found.size(); ++i)
+    {
+        // A change that left the size and time alone, such as a new owner, needs no reading
+        if (const auto* old = previous.findEntry (found[i].path);
+            old != nullptr && isCurrent (*old, found[i].fileSize, found[i].modificationTime))
+            index->entries[numKept + i] = *old;
+        else
+            toRead.push_back (i);
+    }
+
+    readEntries (found, toRead, index->entries.data() + numKept, numThreads, progress, shouldStop);
+
+    if (shouldStop)
+        return nullptr;
+
+    // Both parts are sorted by path, and no path is in both
+    std::inplace_merge (index->entries.begin(), index->entries.begin() + static_cast<std::ptrdiff_t> (numKept), index->entries.end(),
+                        [] (const Entry& a, const Entry& b) { return a.path < b.path; });
+
+    index->numReused = static_cast<int> (index->entries.size() - toRead.size());
+    return index;
+}
+
+void LibraryIndex::findFiles (const juce::File& root, const juce::File& folder, std::vector<FoundFile>& found,
+                              Progress& progress, const std::atomic<bool>& shouldStop)
+{
+    // The directory listing gives each file's size and time without another stat. It
+    // lists everything and matches the extension without regard to case, as update()
+    // and the folder watcher do; a wildcard would be case-sensitive on some systems.
+    for (const auto& item : juce::RangedDirectoryIterator (folder, true, "*", juce::File::findFiles))
+    {
+        if (shouldStop)
+            return;
+
+        if (! item.getFile().hasFileExtension ("mid;midi"))
+            continue;
+
+        found.push_back ({ item.getFile(), getRelativePath (root, item.getFile()),
+                           item.getFileSize(), item.getModificationTime().toMilliseconds() });
+        progress.numFound = static_cast<int> (found.size());
+    }
+}
+
+void LibraryIndex::readEntries (const std::vector<FoundFile>& files, const std::vector<size_t>& toRead, Entry* destination,
+                                int numThreads, Progress& progress, const std::atomic<bool>& shouldStop)
+{
+    if (toRead.empty())
+        return;
+
+    // Each worker takes the next unread file until none are left, so a few
+    // slow files never leave the other threads idle
+    const int numWorkers = juce::jlimit (1, static_cast<int> (toRead.size()),
+                                         numThreads > 0 ? numThreads : juce::SystemStats::getNumCpus());
+    std::atomic<size_t> nextToRead { 0 };
+    std::atomic<int> numFinished { 0 };
+    juce::WaitableEvent allDone;
+
+    juce::ThreadPool pool (numWorkers);
+
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        pool.addJob ([&]
+        {
+            for (size_t n = nextToRead++; n < toRead.size() && ! shouldStop; n = nextToRead++)
+            {
+                const auto& file = files[toRead[n]];
+                auto& entry = destination[toRead[n]];
+
+                entry = readEntry (file.file);
+                entry.path = file.path;
+                entry.fileSize = file.fileSize;
+                entry.modificationTime = file.modificationTime;
+
+                ++progress.numRead;
+                ++progress.numDone;
+            }
+
+            if (++numFinished == numWorkers)
+                allDone.signal();
+        });
+    }
+
+    allDone.wait();
+}
+
+bool LibraryIndex::save (const juce::File& indexFile) const
+{
+    juce::MemoryOutputStream out;
+    out.writeInt (fileMagic);
+    out.writeInt (fileVersion);
+    out.writeString (root.getFullPathName());
+    out.writeInt (getNumEntries());
+
+    for (const auto& entry : entries)
+    {
+        out.writeString (entry.path);
+        out.writeInt64 (entry.fileSize);
+        out.writeInt64 (entry.modificationTime);
+        out.writeBool (entry.isReadable);
+
+        if (! entry.isReadable)
+            continue;
+
+        out.writeFloat (entry.initialTempo);
+        out.writeFloat (entry.minTempo);
+        out.writeFloat (entry.maxTempo);
+        out.writeFloat (entry.lengthInBars);
+        out.writeFloat (entry.lengthInSeconds);
+        out.writeShort (static_cast<short> (entry.ticksPerQuarterNote));
+        out.writeShort (static_cast<short> (entry.numTracks));
+        out.writeByte (static_cast<char> (entry.timeSigNumerator));
+        out.writeByte (static_cast<char> (entry.timeSigDenominator));
+        out.writeInt (static_cast<int> (entry.numNotes));
+
+        // Most files use a handful of notes, so only the ones played are stored
+        const auto numUsed = std::count_if (entry.noteCounts.begin(), entry.noteCounts.end(), [] (juce::uint16 c) { return c > 0; });
+        out.writeByte (static_cast<char> (numUsed));
+
+        for (size_t note = 0; note < entry.noteCounts.size(); ++note)
+        {
+            if (entry.noteCounts[note] > 0)
+            {
+                out.writeByte (static_cast<char> (note));
+                out.writeShort (static_cast<short> (entry.noteCounts[note]));
+            }
+        }
+
+        for (auto count : entry.channelCounts)
+            out.writeShort (static_cast<short> (count));
+
+        for (auto word : entry.fingerprint.words)
+            out.writeInt64 (static_cast<juce::int64> (word));
+    }
+
+    return indexFile.getParentDirectory().createDirectory()
+        && indexFile.replaceWithData (out.getData(), out.getDataSize());
+}
+
+LibraryIndex::Ptr LibraryIndex::load (const juce::File& indexFile)
+{
+    juce::MemoryBlock data;
+    if (! indexFile.loadFileAsData (data))
+        return nullptr;
+
+    juce::MemoryInputStream in (data, false);
+
+    if (in.readInt() != fileMagic || in.readInt() != fileVersion)
+        return nullptr;
+
+    const auto rootPath = in.readString();
+    const int numEntries = in.readInt();
+
+    if (! juce::File::isAbsolutePath (rootPath) || ! juce::isPositiveAndBelow (numEntries, static_cast<int> (data.getSize()) + 1))
+        return nullptr;
+
+    Ptr index (new LibraryIndex (juce::File (rootPath)));
+    index->entries.resize (static_cast<size_t> (numEntries));
+
+    for (auto& entry : index->entries)
+    {
+        if (in.isExhausted())
+            return nullptr;
+
+        entry.path = in.readString();
+        entry.fileSize = in.readInt64();
+        entry.modificationTime = in.readInt64();
+        entry.isReadable = in.readBool();
+
+        if (! entry.isReadable)
+            continue;
+
+        entry.initialTempo = in.readFloat();
+        entry.minTempo = in.readFloat();
+        entry.maxTempo = in.readFloat();
+        entry.lengthInBars = in.readFloat();
+        entry.lengthInSeconds = in.readFloat();
+        entry.ticksPerQuarterNote = static_cast<juce::uint16> (in.readShort());
+        entry.numTracks = static_cast<juce::uint16> (in.readShort());
+        entry.timeSigNumerator = static_cast<juce::uint8> (in.readByte());
+        entry.timeSigDenominator = static_cast<juce::uint8> (in.readByte());
+        entry.numNotes = static_cast<juce::uint32> (in.readInt());
+
+        const int numUsed = static_cast<juce::uint8> (in.readByte());
+
+        for (int i = 0; i < numUsed; ++i)
+        {
+            const auto note = static_cast<size_t> (in.readByte() & 0x7f);
+            entry.noteCounts[note] = static_cast<juce::uint16> (in.readShort());
+        }
+
+        for (auto& count : entry.channelCounts)
+            count = static_cast<juce::uint16> (in.readShort());
+
+        for (auto& word : entry.fingerprint.words)
+            word = static_cast<juce::uint64> (in.readInt64());
+    }
+
+    return index;
+}
+
+const LibraryIndex::Entry* LibraryIndex::findEntry (const juce::File& file) const
+{
+    return file.isAChildOf (root) ? findEntry (getRelativePath (root, file)) : nullptr;
+}
+
+const LibraryIndex::Entry* LibraryIndex::findEntry (const juce::String& path) const noexcept
+{
+    auto it = std::lower_bound (entries.begin(), entries.end(), path,
+                                [] (const Entry& entry, const juce::String& p) { return entry.path < p; });
+
+    return it != entries.end() && it->path == path ? &*it : nullptr;
+}
+
+juce::String LibraryIndex::getRelativePath (const juce::File& root, const juce::File& file)
+{
+    return file.getRelativePathFrom (root).replaceCharacter ('\\', '/');
+}
+
+bool LibraryIndex::isCurrent (const Entry& entry, juce::int64 fileSize, juce::int64 modificationTime) noexcept
+{
+    return entry.fileSize == fileSize && entry.modificationTime == modificationTime;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "RhythmFingerprint.h"
+
+// Metadata for every MIDI file under a library folder, read once and kept on disk
+// so the browser knows what is in a file without opening it.
+//
+// Building an index lists the folder tree, then reads the files on a thread pool.
+// Files whose size and modification time match an entry of the previous index
+// keep that entry and are not read again, so refreshing a large library that has
+// barely changed costs little more than listing it. Entries are sorted by path.
+//
+// An index is immutable once built and reference counted, so the indexer thread
+// can publish a new one while the editor keeps using the old.
+class LibraryIndex final : public juce::ReferenceCountedObject
+{
+public:
+    using Ptr = juce::ReferenceCountedObjectPtr<LibraryIndex>;
+
+    struct Entry
+    {
+        juce::String path;                         // relative to the root, '/' separated
+        juce::int64 fileSize = 0;
+        juce::int64 modificationTime = 0;          // milliseconds since the epoch
+        bool isReadable = false;                   // false if the file did not parse; the rest is then empty
+
+        float initialTempo = 120.0f;               // BPM
+        float minTempo = 120.0f;
+        float maxTempo = 120.0f;
+        float lengthInBars = 0.0f;
+        float lengthInSeconds = 0.0f;
+        juce::uint16 ticksPerQuarterNote = 0;
+        juce::uint16 numTracks = 0;
+        juce::uint8 timeSigNumerator = 4;
+        juce::uint8 timeSigDenominator = 4;
+        juce::uint32 numNotes = 0;
+
+        // Note-ons per note number and per channel, saturating at 65535
+        std::array<juce::uint16, 128> noteCounts {};
+        std::array<juce::uint16, 16> channelCounts {};
+
+        RhythmFingerprint fingerprint;
+    };
+
+    // Updated by build() as it goes; read from any thread.
+    struct Progress
+    {
+        std::atomic<int> numFound { 0 };
+        std::atomic<int> numDone { 0 };
+        std::atomic<int> numRead { 0 };            // files actually parsed, rather than carried over
+    };
+
+    // Indexes every .mid and .midi file under the root, reusing the entries of the
+    // previous index (which may be null, or of another root) that are still current.
+    // Returns null if shouldStop was set before it finished.
+    static Ptr build (const juce::File& root, const LibraryIndex* previous, int numThreads,
+                      Progress& progress, const std::atomic<bool>& shouldStop);
+
+    // A copy of the previous index with the given files and folders looked at
+    // again: a MIDI file is read if it changed, a folder is listed, and anything
+    // that no longer exists is dropped along with everything under it. Paths
+    // outside the root are ignored. Returns null if shouldStop was set before it
+    // finished.
+    static Ptr update (const LibraryIndex& previous, const juce::Array<juce::File>& changed, int numThreads,
+                       Progress& progress, const std::atomic<bool>& shouldStop);
+
+    // Reads an index written by save(); null if the file is missing or not a valid index.
+    static Ptr load (const juce::File& indexFile);
+    bool save (const juce::File& indexFile) const;
+
+    // Reads the metadata of one file.
+    static Entry readEntry (const juce::File& file);
+
+    const juce::File& getRoot() const noexcept { return root; }
+    int getNumEntries() const noexcept { return static_cast<int> (entries.size()); }
+    const Entry& getEntry (int index) const noexcept { return entries[static_cast<size_t> (index)]; }
+    juce::File getFile (int index) const { return root.getChildFile (getEntry (index).path); }
+
+    // The entry for a file under the root, or null.
+    const Entry* findEntry (const juce::File& file) const;
+
+    // Entries carried over from the previous index when this one was built.
+    int getNumReused() const noexcept { return numReused; }
+
+private:
+    struct FoundFile
+    {
+        juce::File file;
+        juce::String path;
+        juce::int64 fileSize = 0;
+        juce::int64 modificationTime = 0;
+    };
+
+    explicit LibraryIndex (const juce::File& rootToUse) : root (rootToUse) {}
+
+    static void findFiles (const juce::File& root, const juce::File& folder, std::vector<FoundFile>& found,
+                           Progress& progress, const std::atomic<bool>& shouldStop);
+    static void readEntries (const std::vector<FoundFile>& files, const std::vector<size_t>& toRead, Entry* destination,
+                             int numThreads, Progress& progress, const std::atomic<bool>& shouldStop);
+
+    static juce::String getRelativePath (const juce::File& root, const juce::File& file);
+    static bool isCurrent (const Entry& entry, juce::int64 fileSize, juce::int64 modificationTime) noexcept;
+    const Entry* findEntry (const juce::String& path) const noexcept;
+
+    static constexpr int fileMagic = 0x494c464d;   // "MFLI"
+    static constexpr int fileVersion = 2;
+
+    juce::File root;
+    std::vector<Entry> entries;
+    int numReused = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LibraryIndex)
+};
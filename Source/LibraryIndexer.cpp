@@ -0,0 +1,191 @@
+#include "LibraryIndexer.h"
+
+LibraryIndexer::LibraryIndexer (const juce::File& cacheFolderToUse)
+    : juce::Thread ("Library indexer"),
+      cacheFolder (cacheFolderToUse)
+{
+    // Create the weak reference master here so the indexer thread never has to.
+    juce::WeakReference<LibraryIndexer> initialiseMaster (this);
+    juce::ignoreUnused (initialiseMaster);
+
+    watcher.onChanges = [this] (const FolderWatcher::Changes& changes) {
+        applyChanges (changes);
+    };
+
+    startThread (juce::Thread::Priority::background);
+}
+
+LibraryIndexer::~LibraryIndexer()
+{
+    signalThreadShouldExit();
+
+    {
+        // Under the lock, so takeRequest either sees the exit flag or runs
+        // before this and has its reset of cancelBuild overridden here
+        const juce::ScopedLock sl (lock);
+        cancelBuild = true;
+    }
+
+    notify();
+    stopThread (10000);
+}
+
+void LibraryIndexer::setRoot (const juce::File& folder)
+{
+    {
+        const juce::ScopedLock sl (lock);
+
+        if (folder == root)
+            return;
+
+        root = folder;
+
+        // A build of the old folder is no longer wanted. Cancelled under the lock,
+        // before the request is posted, so it can never cancel the new build once
+        // takeRequest has picked that up.
+        cancelBuild = true;
+        requestPending = true;
+        rootChangePending = true;
+        pendingChanges.clear();
+    }
+
+    // Watching starts before the first scan, so nothing that changes during it is missed
+    watcher.setFolder (folder);
+    notify();
+}
+
+juce::File LibraryIndexer::getRoot() const
+{
+    const juce::ScopedLock sl (lock);
+    return root;
+}
+
+void LibraryIndexer::refresh()
+{
+    {
+        const juce::ScopedLock sl (lock);
+        requestPending = true;
+    }
+
+    notify();
+}
+
+void LibraryIndexer::applyChanges (const FolderWatcher::Changes& changes)
+{
+    if (changes.eventsLost)
+    {
+        refresh();
+        return;
+    }
+
+    {
+        const juce::ScopedLock sl (lock);
+
+        if (requestPending)
+            return;
+
+        pendingChanges.addArray (changes.files);
+    }
+
+    notify();
+}
+
+LibraryIndex::Ptr LibraryIndexer::getIndex() const
+{
+    const juce::ScopedLock sl (lock);
+    return index;
+}
+
+juce::File LibraryIndexer::getIndexFileFor (const juce::File& folder) const
+{
+    return cacheFolder.getChildFile (juce::String::toHexString (folder.getFullPathName().hashCode64()) + ".index");
+}
+
+void LibraryIndexer::run()
+{
+    while (! threadShouldExit())
+    {
+        juce::File folder;
+        bool rootChanged = false;
+        juce::Array<juce::File> changes;
+
+        if (! takeRequest (folder, rootChanged, changes))
+        {
+            wait (-1);
+            continue;
+        }
+
+        if (folder == juce::File())
+        {
+            publish (nullptr);
+            continue;
+        }
+
+        // The saved index is shown while it is brought up to date
+        if (rootChanged)
+        {
+            auto saved = LibraryIndex::load (getIndexFileFor (folder));
+            if (saved != nullptr && saved->getRoot() == folder)
+                publish (saved);
+        }
+
+        progress.numFound = 0;
+        progress.numDone = 0;
+        progress.numRead = 0;
+        indexing = true;
+
+        // Changes reported by the watcher are applied to the index of the same folder
+        auto previous = getIndex();
+        auto built = ! changes.isEmpty() && previous != nullptr && previous->getRoot() == folder
+                       ? LibraryIndex::update (*previous, changes, numThreads, progress, cancelBuild)
+                       : LibraryIndex::build (folder, previous.get(), numThreads, progress, cancelBuild);
+
+        indexing = false;
+
+        if (built != nullptr)
+        {
+            publish (built);
+
+            // Nothing read means nothing changed, unless files were removed
+            if (progress.numRead > 0 || previous == nullptr || previous->getNumEntries() != built->getNumEntries())
+                built->save (getIndexFileFor (folder));
+        }
+    }
+}
+
+bool LibraryIndexer::takeRequest (juce::File& folder, bool& rootChanged, juce::Array<juce::File>& changes)
+{
+    const juce::ScopedLock sl (lock);
+
+    // No new build once the thread is told to exit; the reset below would undo the destructor's cancel
+    if (threadShouldExit() || (! requestPending && pendingChanges.isEmpty()))
+        return false;
+
+    // A full refresh covers any changes reported meanwhile
+    if (! requestPending)
+        changes.swapWith (pendingChanges);
+
+    folder = root;
+    rootChanged = rootChangePending;
+    requestPending = false;
+    rootChangePending = false;
+    pendingChanges.clear();
+    cancelBuild = false;
+    return true;
+}
+
+void LibraryIndexer::publish (LibraryIndex::Ptr newIndex)
+{
+    {
+        const juce::ScopedLock sl (lock);
+        index = std::move (newIndex);
+    }
+
+    juce::WeakReference<LibraryIndexer> weakThis (this);
+
+    juce::MessageManager::callAsync ([weakThis]
+    {
+        if (weakThis != nullptr && weakThis->onIndexChanged != nullptr)
+            weakThis->onIndexChanged();
+    });
+}
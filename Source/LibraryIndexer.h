@@ -0,0 +1,71 @@
+#pragma once
+
+#include <juce_events/juce_events.h>
+#include "FolderWatcher.h"
+#include "LibraryIndex.h"
+
+// Keeps a LibraryIndex of one library folder up to date on a background thread.
+//
+// Each folder's index is saved under the cache folder. Setting the root first
+// loads the saved index, so the browser has metadata for the whole library
+// almost at once, then refreshes it, reading only the files that are new or
+// changed since it was saved. After that a FolderWatcher reports what changes
+// in the folder, and only those files and folders are read again, so the index
+// stays current without the folder being listed again. Every index built or
+// loaded is published and announced on the message thread through onIndexChanged.
+class LibraryIndexer final : private juce::Thread
+{
+public:
+    explicit LibraryIndexer (const juce::File& cacheFolderToUse);
+    ~LibraryIndexer() override;
+
+    // Message thread: switches to another library folder, or none.
+    void setRoot (const juce::File& folder);
+    juce::File getRoot() const;
+
+    // Message thread: rescans the current folder.
+    void refresh();
+
+    // Any thread: the latest index, which may be of a previous root while the
+    // new one is loading, or null before anything has been indexed.
+    LibraryIndex::Ptr getIndex() const;
+
+    // Threads used to read files; 0 uses every core. Applies to the next refresh.
+    void setNumThreads (int numThreadsToUse) noexcept { numThreads = numThreadsToUse; }
+
+    bool isIndexing() const noexcept { return indexing; }
+    bool isWatching() const noexcept { return watcher.isUsingNotifications(); }
+    const LibraryIndex::Progress& getProgress() const noexcept { return progress; }
+
+    // Called on the message thread whenever a new index has been published.
+    std::function<void()> onIndexChanged;
+
+    // Where the index of a folder is saved.
+    juce::File getIndexFileFor (const juce::File& folder) const;
+
+private:
+    void run() override;
+
+    void applyChanges (const FolderWatcher::Changes& changes);
+    bool takeRequest (juce::File& folder, bool& rootChanged, juce::Array<juce::File>& changes);
+    void publish (LibraryIndex::Ptr newIndex);
+
+    const juce::File cacheFolder;
+
+    mutable juce::CriticalSection lock;
+    juce::File root;
+    LibraryIndex::Ptr index;
+    bool requestPending = false;
+    bool rootChangePending = false;
+    juce::Array<juce::File> pendingChanges;   // applied to the current index unless a full refresh is pending
+
+    std::atomic<int> numThreads { 0 };
+    std::atomic<bool> indexing { false };
+    std::atomic<bool> cancelBuild { false };
+    LibraryIndex::Progress progress;
+
+    FolderWatcher watcher { true, "mid;midi" };
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE (LibraryIndexer)
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LibraryIndexer)
+};
@@ -0,0 +1,188 @@
+#include "LibrarySearch.h"
+
+namespace
+{
+    // Notes of the General MIDI drum map that a drum name in a query stands for
+    LibrarySearch::NoteMask getDrumNotes (const juce::String& word)
+    {
+        static const std::map<juce::String, std::vector<int>> drums {
+            { "kick",    { 35, 36 } },
+            { "snare",   { 38, 40 } },
+            { "rim",     { 37 } },
+            { "clap",    { 39 } },
+            { "hat",     { 42, 44, 46 } },
+            { "hihat",   { 42, 44, 46 } },
+            { "tom",     { 41, 43, 45, 47, 48, 50 } },
+            { "crash",   { 49, 57 } },
+            { "ride",    { 51, 53, 59 } },
+            { "china",   { 52 } },
+            { "splash",  { 55 } },
+            { "cymbal",  { 49, 51, 52, 55, 57, 59 } },
+            { "tamb",    { 54 } },
+            { "cowbell", { 56 } },
+            { "conga",   { 62, 63, 64 } },
+            { "bongo",   { 60, 61 } },
+            { "shaker",  { 69, 70, 82 } }
+        };
+
+        LibrarySearch::NoteMask mask;
+        auto it = drums.find (word);
+
+        if (it != drums.end())
+            for (int note : it->second)
+                mask.add (note);
+
+        return mask;
+    }
+
+    // Reads "a-b" or "a" into a range; returns false if neither number is valid.
+    bool parseRange (const juce::String& text, double& low, double& high)
+    {
+        const auto first = text.upToFirstOccurrenceOf ("-", false, false).trim();
+        const auto second = text.fromFirstOccurrenceOf ("-", false, false).trim();
+
+        if (! first.containsOnly ("0123456789.") || first.isEmpty())
+            return false;
+
+        low = first.getDoubleValue();
+        high = second.isNotEmpty() && second.containsOnly ("0123456789.") ? second.getDoubleValue() : low;
+
+        if (high < low)
+            std::swap (low, high);
+
+        return true;
+    }
+
+    int getBarCount (const LibraryIndex::Entry& entry) noexcept
+    {
+        // A song a hair short of a whole bar (an early final note-off) still counts as that bar
+        return juce::jmax (0, static_cast<int> (std::ceil (entry.lengthInBars - 0.01f)));
+    }
+}
+
+LibrarySearch::Query LibrarySearch::Query::parse (const juce::String& text)
+{
+    Query query;
+
+    for (auto token : juce::StringArray::fromTokens (text.toLowerCase(), " \t", "\""))
+    {
+        token = token.unquoted().trim();
+        double low = 0.0, high = 0.0;
+
+        if (token.isEmpty())
+            continue;
+
+        if (token.startsWith ("bpm:") && parseRange (token.substring (4), low, high))
+        {
+            // A single tempo allows for files written at a fraction off it
+            query.minTempo = static_cast<float> (low == high ? low - 0.5 : low);
+            query.maxTempo = static_cast<float> (low == high ? high + 0.5 : high);
+        }
+        else if (token.startsWith ("bars:") && parseRange (token.substring (5), low, high))
+        {
+            query.minBars = juce::roundToInt (low);
+            query.maxBars = juce::roundToInt (high);
+        }
+        else if (token.startsWith ("sig:") && token.contains ("/"))
+        {
+            query.timeSigNumerator = token.substring (4).upToFirstOccurrenceOf ("/", false, false).getIntValue();
+            query.timeSigDenominator = token.fromFirstOccurrenceOf ("/", false, false).getIntValue();
+        }
+        else if (token.startsWith ("note:") && parseRange (token.substring (5), low, high))
+        {
+            NoteMask group;
+            for (int note = juce::jlimit (0, 127, static_cast<int> (low)); note <= juce::jlimit (0, 127, static_cast<int> (high)); ++note)
+                group.add (note);
+
+            query.noteGroups.push_back (group);
+        }
+        else if (auto drum = getDrumNotes (token); ! drum.isEmpty())
+        {
+            query.noteGroups.push_back (drum);
+        }
+        else
+        {
+            query.words.add (token);
+        }
+    }
+
+    return query;
+}
+
+bool LibrarySearch::Query::isEmpty() const noexcept
+{
+    return minTempo <= 0.0f && maxTempo <= 0.0f && minBars <= 0 && maxBars <= 0
+        && timeSigNumerator <= 0 && noteGroups.empty() && words.isEmpty();
+}
+
+LibrarySearch::LibrarySearch (const LibraryIndex& index)
+{
+    const auto numEntries = static_cast<size_t> (index.getNumEntries());
+
+    minTempos.resize (numEntries);
+    maxTempos.resize (numEntries);
+    barCounts.resize (numEntries);
+    timeSigNumerators.resize (numEntries);
+    timeSigDenominators.resize (numEntries);
+    noteMasks.resize (numEntries);
+    lowerCasePaths.resize (numEntries);
+
+    for (size_t i = 0; i < numEntries; ++i)
+    {
+        const auto& entry = index.getEntry (static_cast<int> (i));
+        lowerCasePaths[i] = entry.path.toLowerCase();
+
+        // Files that could not be read keep zeros, which no metadata filter accepts
+        if (! entry.isReadable)
+            continue;
+
+        minTempos[i] = entry.minTempo;
+        maxTempos[i] = entry.maxTempo;
+        barCounts[i] = static_cast<juce::uint16> (juce::jmin (getBarCount (entry), 65535));
+        timeSigNumerators[i] = entry.timeSigNumerator;
+        timeSigDenominators[i] = entry.timeSigDenominator;
+
+        for (int note = 0; note < 128; ++note)
+            if (entry.noteCounts[static_cast<size_t> (note)] > 0)
+                noteMasks[i].add (note);
+    }
+}
+
+std::vector<int> LibrarySearch::search (const Query& query) const
+{
+    const bool filterTempo = query.minTempo > 0.0f || query.maxTempo > 0.0f;
+    const float minTempo = filterTempo ? juce::jmax (query.minTempo, 1.0e-3f) : 0.0f;
+    const float maxTempo = query.maxTempo > 0.0f ? query.maxTempo : std::numeric_limits<float>::max();
+    const int maxBars = query.maxBars > 0 ? query.maxBars : std::numeric_limits<int>::max();
+
+    std::vector<int> results;
+
+    for (size_t i = 0; i < barCounts.size(); ++i)
+    {
+        // The file's tempo range has to overlap the one asked for
+        if (filterTempo && (maxTempos[i] < minTempo || minTempos[i] > maxTempo))
+            continue;
+
+        if (barCounts[i] < query.minBars || barCounts[i] > maxBars)
+            continue;
+
+        if (query.timeSigNumerator > 0
+             && (timeSigNumerators[i] != query.timeSigNumerator
+                  || (query.timeSigDenominator > 0 && timeSigDenominators[i] != query.timeSigDenominator)))
+            continue;
+
+        const auto& mask = noteMasks[i];
+        if (! std::all_of (query.noteGroups.begin(), query.noteGroups.end(),
+                           [&mask] (const NoteMask& group) { return mask.intersects (group); }))
+            continue;
+
+        const auto& path = lowerCasePaths[i];
+        if (! std::all_of (query.words.begin(), query.words.end(),
+                           [&path] (const juce::String& word) { return path.contains (word); }))
+            continue;
+
+        results.push_back (static_cast<int> (i));
+    }
+
+    return results;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "LibraryIndex.h"
+
+// Filters a LibraryIndex by tempo, length, time signature, the notes played and
+// words in the path, fast enough to run on every keystroke.
+//
+// The fields the filters look at are copied out of the index into one array per
+// field, and the notes each file plays into a 128-bit mask, so a search is a
+// straight pass over a few small arrays and a couple of AND instructions per
+// file. Only files that pass those tests have their paths compared with the words.
+//
+// Built on the message thread whenever a new index is published; immutable after.
+class LibrarySearch final
+{
+public:
+    // One bit per MIDI note number.
+    struct NoteMask
+    {
+        juce::uint64 low = 0;    // notes 0-63
+        juce::uint64 high = 0;   // notes 64-127
+
+        void add (int note) noexcept
+        {
+            if (note < 64)
+                low |= juce::uint64 (1) << note;
+            else
+                high |= juce::uint64 (1) << (note - 64);
+        }
+
+        bool intersects (const NoteMask& other) const noexcept
+        {
+            return ((low & other.low) | (high & other.high)) != 0;
+        }
+
+        bool isEmpty() const noexcept { return (low | high) == 0; }
+    };
+
+    struct Query
+    {
+        float minTempo = 0.0f;            // BPM; a file matches if any of its tempos is in range
+        float maxTempo = 0.0f;            // 0 for no limit
+        int minBars = 0;                  // whole bars, counting a partial last bar
+        int maxBars = 0;                  // 0 for no limit
+        int timeSigNumerator = 0;         // 0 for any
+        int timeSigDenominator = 0;
+        std::vector<NoteMask> noteGroups; // a file must play at least one note of each group
+        juce::StringArray words;          // lower case; each must appear in the file's path
+
+        // Reads a query typed as words and filters, in any order:
+        //
+        //     bpm:90-100  bpm:96  bars:4  bars:2-8  sig:7/8  note:36  note:42-46
+        //
+        // and General MIDI drum names such as kick, snare, hat, ride or crash, which
+        // each stand for the notes of that drum. Anything else is matched against
+        // the path.
+        static Query parse (const juce::String& text);
+
+        bool isEmpty() const noexcept;
+    };
+
+    explicit LibrarySearch (const LibraryIndex& index);
+
+    // Indices into the index of the matching entries, in path order.
+    std::vector<int> search (const Query& query) const;
+
+    int getNumEntries() const noexcept { return static_cast<int> (barCounts.size()); }
+
+private:
+    std::vector<float> minTempos;
+    std::vector<float> maxTempos;
+    std::vector<juce::uint16> barCounts;
+    std::vector<juce::uint8> timeSigNumerators;
+    std::vector<juce::uint8> timeSigDenominators;
+    std::vector<NoteMask> noteMasks;
+    std::vector<juce::String> lowerCasePaths;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LibrarySearch)
+};
@@ -0,0 +1,203 @@
+#include "LibrarySearchPanel.h"
+#include "MidiFileLoader.h"
+
+LibrarySearchPanel::LibrarySearchPanel()
+{
+    queryEditor.setTextToShowWhenEmpty ("e.g. bpm:90-100 bars:4 ride funk", juce::Colours::grey);
+    queryEditor.onTextChange = [this] {
+        similarTo = juce::File();
+        runQuery();
+    };
+    addAndMakeVisible (queryEditor);
+
+    summaryLabel.setJustificationType (juce::Justification::centredLeft);
+    summaryLabel.setFont (juce::Font (13.0f));
+    addAndMakeVisible (summaryLabel);
+
+    resultsList.setModel (this);
+    resultsList.setRowHeight (20);
+    addAndMakeVisible (resultsList);
+}
+
+void LibrarySearchPanel::setIndex (LibraryIndex::Ptr newIndex)
+{
+    index = std::move (newIndex);
+    search = index != nullptr ? std::make_unique<LibrarySearch> (*index) : nullptr;
+    fingerprints.reset();
+
+    if (index != nullptr)
+    {
+        // Files with no notes have nothing to compare, so they are left out
+        fingerprints = std::make_unique<FingerprintSet>();
+        fingerprints->reserve (index->getNumEntries());
+
+        for (int i = 0; i < index->getNumEntries(); ++i)
+            if (! index->getEntry (i).fingerprint.isEmpty())
+                fingerprints->add (index->getEntry (i).fingerprint, i);
+    }
+
+    if (similarTo != juce::File())
+        runSimilaritySearch();
+    else
+        runQuery();
+}
+
+void LibrarySearchPanel::showSimilar (const juce::File& file)
+{
+    similarTo = file;
+    similarFingerprint = {};
+
+    // Read now rather than on every index update, which come every few seconds while files change
+    if (const auto* entry = index != nullptr ? index->findEntry (file) : nullptr)
+        similarFingerprint = entry->fingerprint;
+    else if (auto song = MidiFileLoader::loadFile (file))
+        similarFingerprint = RhythmFingerprint::compute (*song);
+
+    runSimilaritySearch();
+}
+
+void LibrarySearchPanel::resized()
+{
+    auto bounds = getLocalBounds().reduced (4);
+
+    queryEditor.setBounds (bounds.removeFromTop (26));
+    summaryLabel.setBounds (bounds.removeFromTop (22));
+    resultsList.setBounds (bounds);
+}
+
+void LibrarySearchPanel::runQuery()
+{
+    // Clear the selection first so a row that now shows another file is not loaded
+    resultsList.deselectAllRows();
+    results.clear();
+
+    if (search == nullptr)
+    {
+        summaryLabel.setText ("No library set", juce::dontSendNotification);
+        resultsList.updateContent();
+        return;
+    }
+
+    const auto query = LibrarySearch::Query::parse (queryEditor.getText());
+
+    const double startTime = juce::Time::getMillisecondCounterHiRes();
+    results = search->search (query);
+    const double elapsed = juce::Time::getMillisecondCounterHiRes() - startTime;
+
+    summaryLabel.setText (juce::String (static_cast<int> (results.size())) + " of " + juce::String (search->getNumEntries())
+                            + " files (" + juce::String (elapsed, 2) + " ms)",
+                          juce::dontSendNotification);
+
+    resultsList.updateContent();
+    resultsList.repaint();
+}
+
+void LibrarySearchPanel::runSimilaritySearch()
+{
+    resultsList.deselectAllRows();
+    results.clear();
+
+    if (fingerprints == nullptr)
+    {
+        summaryLabel.setText ("No library set", juce::dontSendNotification);
+        resultsList.updateContent();
+        return;
+    }
+
+    // The index has the file's latest fingerprint if it is in the library
+    const auto* entry = index->findEntry (similarTo);
+    const int entryIndex = entry != nullptr ? static_cast<int> (entry - &index->getEntry (0)) : -1;
+    const auto& fingerprint = entry != nullptr ? entry->fingerprint : similarFingerprint;
+
+    // An empty fingerprint would only match the files with the fewest notes
+    if (fingerprint.isEmpty())
+    {
+        summaryLabel.setText ("No rhythm to compare in " + similarTo.getFileName(), juce::dontSendNotification);
+        resultsList.updateContent();
+        return;
+    }
+
+    const double startTime = juce::Time::getMillisecondCounterHiRes();
+    const auto matches = fingerprints->findNearest (fingerprint, numSimilarResults, entryIndex);
+    const double elapsed = juce::Time::getMillisecondCounterHiRes() - startTime;
+
+    for (const auto& match : matches)
+        results.push_back (match.id);
+
+    summaryLabel.setText ("Grooves like " + similarTo.getFileName() + " (" + juce::String (fingerprints->size())
+                            + " compared in " + juce::String (elapsed, 2) + " ms)",
+                          juce::dontSendNotification);
+
+    resultsList.updateContent();
+    resultsList.repaint();
+}
+
+juce::File LibrarySearchPanel::getResultFile (int row) const
+{
+    if (index == nullptr || ! juce::isPositiveAndBelow (row, static_cast<int> (results.size())))
+        return {};
+
+    return index->getFile (results[static_cast<size_t> (row)]);
+}
+
+int LibrarySearchPanel::getNumRows()
+{
+    return static_cast<int> (results.size());
+}
+
+void LibrarySearchPanel::paintListBoxItem (int rowNumber, juce::Graphics& g, int width, int height, bool rowIsSelected)
+{
+    if (index == nullptr || ! juce::isPositiveAndBelow (rowNumber, static_cast<int> (results.size())))
+        return;
+
+    if (rowIsSelected)
+        g.fillAll (findColour (juce::TextEditor::highlightColourId));
+
+    const auto& entry = index->getEntry (results[static_cast<size_t> (rowNumber)]);
+    const auto name = entry.path.fromLastOccurrenceOf ("/", false, false);
+
+    juce::String details ("unreadable");
+
+    if (entry.isReadable)
+    {
+        const auto minTempo = juce::roundToInt (entry.minTempo);
+        const auto maxTempo = juce::roundToInt (entry.maxTempo);
+
+        details = (minTempo == maxTempo ? juce::String (minTempo) : juce::String (minTempo) + "-" + juce::String (maxTempo))
+                + " BPM, " + juce::String (entry.lengthInBars, 1) + " bars, "
+                + juce::String (entry.timeSigNumerator) + "/" + juce::String (entry.timeSigDenominator);
+    }
+
+    const int nameWidth = width * 3 / 5;
+
+    g.setColour (findColour (juce::ListBox::textColourId));
+    g.setFont (14.0f);
+    g.drawText (name, 4, 0, nameWidth - 8, height, juce::Justification::centredLeft, true);
+
+    g.setColour (findColour (juce::ListBox::textColourId).withAlpha (0.6f));
+    g.drawText (details, nameWidth, 0, width - nameWidth - 4, height, juce::Justification::centredRight, true);
+}
+
+void LibrarySearchPanel::listBoxItemClicked (int row, const juce::MouseEvent& e)
+{
+    auto file = getResultFile (row);
+
+    if (file != juce::File() && onFileClicked != nullptr)
+        onFileClicked (file, e);
+}
+
+void LibrarySearchPanel::listBoxItemDoubleClicked (int row, const juce::MouseEvent&)
+{
+    auto file = getResultFile (row);
+
+    if (file != juce::File() && onFileDoubleClicked != nullptr)
+        onFileDoubleClicked (file);
+}
+
+void LibrarySearchPanel::selectedRowsChanged (int lastRowSelected)
+{
+    auto file = getResultFile (lastRowSelected);
+
+    if (file != juce::File() && onSelectionChanged != nullptr)
+        onSelectionChanged (file);
+}
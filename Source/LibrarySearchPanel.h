@@ -0,0 +1,60 @@
+#pragma once
+
+#include <juce_gui_basics/juce_gui_basics.h>
+#include "LibrarySearch.h"
+#include "RhythmFingerprint.h"
+
+// A search box and result list over the library index, shown beside the file
+// browser.
+//
+// The results are worked out again on every keystroke. The panel can also list
+// the files whose groove is closest to a given file's, by rhythm fingerprint. Clicking, double-clicking
+// or selecting a result goes through the same callbacks as the browser, so
+// loading and auto-play behave the same from either.
+class LibrarySearchPanel final : public juce::Component,
+                                 private juce::ListBoxModel
+{
+public:
+    LibrarySearchPanel();
+
+    // Message thread: searches a newly published index with the current query.
+    void setIndex (LibraryIndex::Ptr newIndex);
+
+    // Lists the library files whose rhythm is closest to the given file's, until
+    // the query is edited. A file outside the library is read once, here, to
+    // fingerprint it.
+    void showSimilar (const juce::File& file);
+
+    void resized() override;
+
+    std::function<void (const juce::File&, const juce::MouseEvent&)> onFileClicked;
+    std::function<void (const juce::File&)> onFileDoubleClicked;
+    std::function<void (const juce::File&)> onSelectionChanged;
+
+private:
+    void runQuery();
+    void runSimilaritySearch();
+    juce::File getResultFile (int row) const;
+
+    // ListBoxModel methods
+    int getNumRows() override;
+    void paintListBoxItem (int rowNumber, juce::Graphics& g, int width, int height, bool rowIsSelected) override;
+    void listBoxItemClicked (int row, const juce::MouseEvent& e) override;
+    void listBoxItemDoubleClicked (int row, const juce::MouseEvent&) override;
+    void selectedRowsChanged (int lastRowSelected) override;
+
+    LibraryIndex::Ptr index;
+    std::unique_ptr<LibrarySearch> search;
+    std::unique_ptr<FingerprintSet> fingerprints;
+    std::vector<int> results;
+    juce::File similarTo;   // shown instead of the query's results while set
+    RhythmFingerprint similarFingerprint;   // similarTo's, for when it is not in the index
+
+    static constexpr int numSimilarResults = 25;
+
+    juce::TextEditor queryEditor;
+    juce::Label summaryLabel { {}, "No library set" };
+    juce::ListBox resultsList;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LibrarySearchPanel)
+};
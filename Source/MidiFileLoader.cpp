@@ -0,0 +1,184 @@
+#include "MidiFileLoader.h"
+
+MidiFileLoader::MidiFileLoader (SongCache& cacheToUse)
+    : juce::Thread ("MIDI file loader"),
+      cache (cacheToUse)
+{
+    // Create the weak reference master here so the loader thread never has to.
+    juce::WeakReference<MidiFileLoader> initialiseMaster (this);
+    juce::ignoreUnused (initialiseMaster);
+
+    startThread (juce::Thread::Priority::background);
+}
+
+MidiFileLoader::~MidiFileLoader()
+{
+    signalThreadShouldExit();
+    notify();
+    stopThread (4000);
+}
+
+void MidiFileLoader::loadAsync (const juce::File& file, Callback onLoaded)
+{
+    {
+        const juce::ScopedLock sl (lock);
+        requestedFile = file;
+        requestedCallback = std::move (onLoaded);
+        requestPending = true;
+        ++latestRequestId;
+    }
+
+    notify();
+}
+
+void MidiFileLoader::cancelPendingLoad()
+{
+    const juce::ScopedLock sl (lock);
+    requestPending = false;
+    requestedCallback = nullptr;
+    ++latestRequestId;
+}
+
+void MidiFileLoader::setPrefetchRadius (int numFilesEachSide)
+{
+    const juce::ScopedLock sl (lock);
+    prefetchRadius = juce::jmax (0, numFilesEachSide);
+}
+
+CompiledSong::Ptr MidiFileLoader::getOrLoad (const juce::File& file)
+{
+    if (auto song = cache.find (file))
+        return song;
+
+    auto song = loadFile (file);
+    cache.insert (file, song);
+    return song;
+}
+
+CompiledSong::Ptr MidiFileLoader::loadFile (const juce::File& file)
+{
+    juce::FileInputStream fileStream (file);
+    juce::MidiFile midiFile;
+
+    if (! fileStream.openedOk() || ! midiFile.readFrom (fileStream))
+    {
+        DBG ("Failed to load MIDI file: " + file.getFullPathName());
+        return nullptr;
+    }
+
+    return CompiledSong::compile (midiFile);
+}
+
+void MidiFileLoader::run()
+{
+    while (! threadShouldExit())
+    {
+        juce::File file;
+        Callback callback;
+        uint32_t requestId = 0;
+
+        if (takeRequest (file, callback, requestId))
+        {
+            auto song = getOrLoad (file);
+            deliver (file, song, std::move (callback), requestId);
+            updatePrefetchQueue (file);
+            continue;
+        }
+
+        if (! prefetchQueue.isEmpty())
+        {
+            prefetchNext();
+            continue;
+        }
+
+        wait (-1);
+    }
+}
+
+bool MidiFileLoader::takeRequest (juce::File& file, Callback& callback, uint32_t& requestId)
+{
+    const juce::ScopedLock sl (lock);
+
+    if (! requestPending)
+        return false;
+
+    file = requestedFile;
+    callback = std::move (requestedCallback);
+    requestId = latestRequestId;
+    requestPending = false;
+    requestedCallback = nullptr;
+    return true;
+}
+
+void MidiFileLoader::deliver (const juce::File& file, CompiledSong::Ptr song, Callback callback, uint32_t requestId)
+{
+    if (callback == nullptr || requestId != latestRequestId)
+        return;
+
+    juce::WeakReference<MidiFileLoader> weakThis (this);
+
+    juce::MessageManager::callAsync ([weakThis, file, song, callback = std::move (callback), requestId]
+    {
+        // Drop the result if a newer request came in while it was in flight
+        if (weakThis != nullptr && weakThis->latestRequestId == requestId)
+            callback (file, song);
+    });
+}
+
+void MidiFileLoader::updatePrefetchQueue (const juce::File& file)
+{
+    prefetchQueue.clearQuick();
+
+    int radius = 0;
+    {
+        const juce::ScopedLock sl (lock);
+        radius = prefetchRadius;
+    }
+
+    if (radius == 0)
+        return;
+
+    auto directory = file.getParentDirectory();
+    int index = directory == listedDirectory ? directoryFiles.indexOf (file) : -1;
+
+    // Re-list the folder when it changed or the file is new to us
+    if (index < 0)
+    {
+        listedDirectory = directory;
+        directoryFiles.clearQuick();
+
+        // Wildcards are case-sensitive on some systems; hasFileExtension is not, so FILE.MID is found too
+        for (const auto& child : directory.findChildFiles (juce::File::findFiles, false, "*"))
+            if (child.hasFileExtension ("mid;midi"))
+                directoryFiles.add (child);
+
+        directoryFiles.sort();
+        index = directoryFiles.indexOf (file);
+    }
+
+    if (index < 0)
+        return;
+
+    // Queue the following file first, since that is where browsing usually goes next
+    for (int distance = 1; distance <= radius; ++distance)
+    {
+        for (int neighbour : { index + distance, index - distance })
+        {
+            if (! juce::isPositiveAndBelow (neighbour, directoryFiles.size()))
+                continue;
+
+            const auto& candidate = directoryFiles.getReference (neighbour);
+            if (! cache.contains (candidate))
+                prefetchQueue.add (candidate);
+        }
+    }
+}
+
+void MidiFileLoader::prefetchNext()
+{
+    auto file = prefetchQueue.removeAndReturn (0);
+
+    // Prefetches bypass find() so they do not skew the cache hit counters
+    if (! cache.contains (file))
+        cache.insert (file, loadFile (file));
+}
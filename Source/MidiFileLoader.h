@@ -0,0 +1,64 @@
+#pragma once
+
+#include <juce_events/juce_events.h>
+#include "CompiledSong.h"
+#include "SongCache.h"
+
+// Reads and compiles MIDI files on a background thread.
+//
+// Only the most recent load request matters: a new request cancels any that has
+// not completed yet, and completion callbacks for cancelled requests are never
+// delivered. Compiled songs go through a shared SongCache. While idle, the thread
+// speculatively compiles the files next to the last requested one in its folder
+// into that cache, so stepping through a library finds the next song already parsed.
+class MidiFileLoader final : private juce::Thread
+{
+public:
+    // Called on the message thread. The song is nullptr if the file could not be read.
+    using Callback = std::function<void (const juce::File&, CompiledSong::Ptr)>;
+
+    explicit MidiFileLoader (SongCache& cacheToUse);
+    ~MidiFileLoader() override;
+
+    // Message thread: reads the file in the background and calls back when done.
+    void loadAsync (const juce::File& file, Callback onLoaded);
+
+    // Message thread: drops the outstanding request, if any, without calling back.
+    void cancelPendingLoad();
+
+    // Number of files on each side of the requested one to compile ahead of time.
+    void setPrefetchRadius (int numFilesEachSide);
+
+    // Returns the cached song for the file, or reads, compiles and caches it on
+    // the calling thread.
+    CompiledSong::Ptr getOrLoad (const juce::File& file);
+
+    // Reads and compiles a file on the calling thread, bypassing the cache.
+    static CompiledSong::Ptr loadFile (const juce::File& file);
+
+private:
+    void run() override;
+
+    bool takeRequest (juce::File& file, Callback& callback, uint32_t& requestId);
+    void deliver (const juce::File& file, CompiledSong::Ptr song, Callback callback, uint32_t requestId);
+
+    void updatePrefetchQueue (const juce::File& file);
+    void prefetchNext();
+
+    SongCache& cache;
+
+    juce::CriticalSection lock;
+    juce::File requestedFile;
+    Callback requestedCallback;
+    bool requestPending = false;
+    std::atomic<uint32_t> latestRequestId { 0 };
+    int prefetchRadius = 2;
+
+    // Loader thread only
+    juce::File listedDirectory;
+    juce::Array<juce::File> directoryFiles;
+    juce::Array<juce::File> prefetchQueue;
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE (MidiFileLoader)
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiFileLoader)
+};
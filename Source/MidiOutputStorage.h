@@ -0,0 +1,47 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+// A set of MidiBuffers with room already reserved, for growing the processor's
+// output buffers without allocating on the audio thread.
+//
+// When a denser file is loaded, the message thread builds one of these and hands
+// it over through a RealtimeExchange. The audio thread swaps the storage into
+// its own buffers, which leaves the old, smaller storage in here to be freed on
+// the message thread when the object is retired.
+//
+// Two more buffers, each with room for the merged output, are for the host's
+// side: one replaces hostInput's storage and one is swapped into the host's own
+// buffer, so neither of the two storages that trade places there every block is
+// ever grown on the audio thread.
+class MidiOutputStorage final : public juce::ReferenceCountedObject
+{
+public:
+    using Ptr = juce::ReferenceCountedObjectPtr<MidiOutputStorage>;
+
+    MidiOutputStorage (int numBuffers, int numBytesPerBuffer, int numBytesPerHostBuffer)
+        : buffers (static_cast<size_t> (numBuffers)), bytesPerBuffer (numBytesPerBuffer)
+    {
+        for (auto& buffer : buffers)
+            buffer.ensureSize (static_cast<size_t> (bytesPerBuffer));
+
+        for (auto& buffer : hostBuffers)
+            buffer.ensureSize (static_cast<size_t> (numBytesPerHostBuffer));
+    }
+
+    int getNumBuffers() const noexcept { return static_cast<int> (buffers.size()); }
+    int getBytesPerBuffer() const noexcept { return bytesPerBuffer; }
+
+    // Audio thread: exchanges the reserved storage with the buffer's own.
+    void swapInto (int index, juce::MidiBuffer& buffer) noexcept { buffer.swapWith (buffers[static_cast<size_t> (index)]); }
+
+    // Audio thread: the same for the two host-side buffers.
+    void swapIntoHostBuffer (int index, juce::MidiBuffer& buffer) noexcept { buffer.swapWith (hostBuffers[static_cast<size_t> (index)]); }
+
+private:
+    std::vector<juce::MidiBuffer> buffers;
+    std::array<juce::MidiBuffer, 2> hostBuffers;
+    int bytesPerBuffer = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiOutputStorage)
+};
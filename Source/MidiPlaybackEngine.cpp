@@ -0,0 +1,123 @@
+#include "MidiPlaybackEngine.h"
+
+void MidiPlaybackEngine::setSong (const CompiledSong* newSong)
+{
+    song = newSong;
+    cursor = 0;
+    needsSeek = true;
+}
+
+void MidiPlaybackEngine::clear()
+{
+    song = nullptr;
+    cursor = 0;
+    needsSeek = true;
+}
+
+void MidiPlaybackEngine::seek (int64_t samplePosition, const PlaybackClock& clock)
+{
+    needsSeek = false;
+    nextExpectedSample = samplePosition;
+    tempoSegment = -1;
+
+    if (song == nullptr)
+    {
+        cursor = 0;
+        return;
+    }
+
+    const auto& ticks = song->getTicks();
+    auto it = std::partition_point (ticks.begin(), ticks.end(), [&clock, samplePosition] (int64_t tick)
+    {
+        return clock.tickToSample (tick) < samplePosition;
+    });
+
+    cursor = static_cast<int> (std::distance (ticks.begin(), it));
+}
+
+void MidiPlaybackEngine::renderBlock (int64_t blockStart, int numSamples, const PlaybackClock& clock,
+                                      juce::MidiBuffer& output, int outputOffset)
+{
+    if (song == nullptr)
+        return;
+
+    if (needsSeek || blockStart != nextExpectedSample)
+        seek (blockStart, clock);
+
+    const auto& ticks = song->getTicks();
+    const int numEvents = song->getNumEvents();
+    const int64_t blockEnd = blockStart + numSamples;
+
+    while (cursor < numEvents)
+    {
+        const int64_t eventSample = clock.tickToSample (ticks[static_cast<size_t> (cursor)], tempoSegment);
+        if (eventSample >= blockEnd)
+            break;
+
+        // An event can only fall before the block if the tempo changed under it;
+        // play it late rather than dropping it.
+        const int sampleOffset = static_cast<int> (std::max<int64_t> (0, eventSample - blockStart));
+
+        if (! muted)
+            emitEvent (cursor, output, outputOffset + sampleOffset);
+
+        ++cursor;
+    }
+
+    nextExpectedSample = blockEnd;
+}
+
+void MidiPlaybackEngine::flushHeldControllers (juce::MidiBuffer& output, int samplePosition)
+{
+    if (heldControllers.getNumHeld() == 0)
+        return;
+
+    int maxMessages = heldControllers.getNumHeld();
+
+    if (thinning && outputBudget > 0)
+        maxMessages = (outputBudget - static_cast<int> (output.data.size())) / (bytesPerEventHeader + 3);
+
+    heldControllers.flush (output, samplePosition, maxMessages);
+}
+
+void MidiPlaybackEngine::emitEvent (int index, juce::MidiBuffer& output, int samplePosition)
+{
+    juce::uint8 bytes[3];
+    const int length = song->getShortMessage (index, bytes);
+
+    if (length == 0)
+    {
+        if (hasRoomFor (output, song->getMessageLength (index)))
+            song->addEventToBuffer (index, output, samplePosition);
+        else
+            ++numDropped;
+
+        return;
+    }
+
+    // Only channel messages (0x80-0xef) are moved
+    if (outputChannel > 0 && bytes[0] < 0xf0)
+        bytes[0] = static_cast<juce::uint8> ((bytes[0] & 0xf0) | (outputChannel - 1));
+
+    const int status = bytes[0] & 0xf0;
+    const bool isNoteOff = length == 3 && (status == 0x80 || (status == 0x90 && bytes[2] == 0));
+
+    if (! isNoteOff && ! hasRoomFor (output, length))
+    {
+        if (! ControllerCoalescer::canHold (bytes, length))
+            ++numDropped;
+        else if (heldControllers.hold (bytes))
+            ++numCoalesced;
+
+        return;
+    }
+
+    output.addEvent (bytes, length, samplePosition);
+    activeNotes.handleMessage (bytes, length);
+}
+
+bool MidiPlaybackEngine::hasRoomFor (const juce::MidiBuffer& output, int messageLength) const noexcept
+{
+    return ! thinning || outputBudget <= 0
+        || static_cast<int> (output.data.size()) + bytesPerEventHeader + messageLength <= outputBudget;
+}
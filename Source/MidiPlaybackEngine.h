@@ -0,0 +1,105 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "ActiveNoteTracker.h"
+#include "CompiledSong.h"
+#include "ControllerCoalescer.h"
+#include "PlaybackClock.h"
+
+// Streams the events of a CompiledSong into MidiBuffers block by block.
+//
+// A single read cursor points at the first event that has not been emitted yet,
+// so rendering a block only touches the events that fall inside it. Blocks are
+// ranges of absolute sample positions on a PlaybackClock, and each event goes out
+// at the sample the clock assigns to its tick. The cursor is re-positioned with a
+// binary search whenever a block does not continue from the previous one (start,
+// loop wrap or seek). Between seeks the tempo segment of the last event is kept
+// too, so placing each event only walks forward through the tempo map.
+//
+// The engine remembers which of the notes it has emitted are still sounding, so
+// the caller can end them with releaseActiveNotes() wherever playback stops or
+// jumps: on stop, at a loop wrap, on a seek and before a song change.
+//
+// With thinning on, the engine keeps each output buffer within a byte budget so
+// that a dense stretch (a sysex dump, a controller ramp) cannot make the buffer
+// grow on the audio thread. Controller and pitch-bend messages that do not fit
+// are held and coalesced, going out with their latest value at the start of the
+// next block; other messages that do not fit are dropped. Note-offs always go out
+// so nothing is left hanging.
+//
+// The engine does not own the song; the processor keeps it alive through its
+// RealtimeExchange for as long as it is active.
+class MidiPlaybackEngine final
+{
+public:
+    MidiPlaybackEngine() = default;
+
+    // Replaces the song being played. The cursor is re-seeked on the next block.
+    void setSong (const CompiledSong* newSong);
+    void clear();
+
+    bool isEmpty() const { return song == nullptr || song->getNumEvents() == 0; }
+    const CompiledSong* getSong() const { return song; }
+
+    // Tick of the last event in the song.
+    int64_t getLengthInTicks() const { return song != nullptr ? song->getLengthInTicks() : 0; }
+
+    // Moves the cursor to the first event that the clock places at or after the given sample.
+    void seek (int64_t samplePosition, const PlaybackClock& clock);
+
+    // Adds every event the clock places in [blockStart, blockStart + numSamples)
+    // to the buffer, at its offset from blockStart plus outputOffset.
+    void renderBlock (int64_t blockStart, int numSamples, const PlaybackClock& clock,
+                      juce::MidiBuffer& output, int outputOffset = 0);
+
+    // Channel 1-16 that every channel message is moved to, or 0 to keep the file's own.
+    void setOutputChannel (int channel) noexcept { outputChannel = channel; }
+    int getOutputChannel() const noexcept { return outputChannel; }
+
+    // While muted the cursor keeps advancing but nothing is emitted.
+    void setMuted (bool shouldMute) noexcept { muted = shouldMute; }
+    bool isMuted() const noexcept { return muted; }
+
+    // Adds a note-off at the given sample for every note that is still sounding.
+    void releaseActiveNotes (juce::MidiBuffer& output, int samplePosition) { activeNotes.releaseAll (output, samplePosition); }
+    int getNumActiveNotes() const noexcept { return activeNotes.getNumActiveNotes(); }
+
+    // Bytes the output buffer may hold in one block, counting what other sources
+    // put in it, and whether messages past that are thinned. A budget of 0 means
+    // no limit.
+    void setOutputBudget (int numBytes) noexcept { outputBudget = numBytes; }
+    void setThinningEnabled (bool shouldThin) noexcept { thinning = shouldThin; }
+
+    // Sends the controller values held back from earlier blocks, as many as fit.
+    // Call once at the start of every block, before rendering into it.
+    void flushHeldControllers (juce::MidiBuffer& output, int samplePosition);
+
+    // Running totals since the engine was created: messages dropped for lack of
+    // room, and controller messages merged into a later value of the same controller.
+    int64_t getNumDroppedEvents() const noexcept { return numDropped; }
+    int64_t getNumCoalescedEvents() const noexcept { return numCoalesced; }
+
+private:
+    void emitEvent (int index, juce::MidiBuffer& output, int samplePosition);
+    bool hasRoomFor (const juce::MidiBuffer& output, int messageLength) const noexcept;
+
+    // What a MidiBuffer stores for each event besides the message: its sample position and size
+    static constexpr int bytesPerEventHeader = static_cast<int> (sizeof (juce::int32) + sizeof (juce::uint16));
+
+    const CompiledSong* song = nullptr;
+    int cursor = 0;
+    int tempoSegment = -1;   // tempo map segment of the last event placed, or -1
+    int64_t nextExpectedSample = -1;
+    bool needsSeek = true;
+    int outputChannel = 0;
+    bool muted = false;
+    ActiveNoteTracker activeNotes;
+
+    ControllerCoalescer heldControllers;
+    int outputBudget = 0;
+    bool thinning = false;
+    int64_t numDropped = 0;
+    int64_t numCoalesced = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiPlaybackEngine)
+};
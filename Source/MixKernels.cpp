@@ -0,0 +1,255 @@
+#include "MixKernels.h"
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+
+ // GCC and Clang only emit SSE/AVX instructions in functions that ask for them,
+ // which keeps the rest of the plugin runnable on any x86 CPU
+ #if JUCE_MSVC
+  #define MIX_KERNEL_TARGET(isa)
+ #else
+  #define MIX_KERNEL_TARGET(isa) __attribute__ ((target (isa)))
+ #endif
+#endif
+
+namespace
+{
+    inline float cubic (float xm1, float x0, float x1, float x2, float t) noexcept
+    {
+        // Catmull-Rom spline through the four neighbours of the read position
+        const float c1 = 0.5f * (x1 - xm1);
+        const float c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+        const float c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+        return ((c3 * t + c2) * t + c1) * t + x0;
+    }
+
+    //==============================================================================
+    void addWithGainRampScalar (float* dest, const float* source, int numSamples, float startGain, float endGain)
+    {
+        const float step = numSamples > 0 ? (endGain - startGain) / static_cast<float> (numSamples) : 0.0f;
+
+        for (int i = 0; i < numSamples; ++i)
+            dest[i] += source[i] * (startGain + step * static_cast<float> (i));
+    }
+
+    double resampleLinearScalar (float* dest, const float* source, int sourceLength,
+                                 double position, double increment, int numSamples)
+    {
+        const int last = sourceLength - 1;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const int whole = static_cast<int> (position);
+            const int index = juce::jmin (whole, last);
+            const int next = juce::jmin (index + 1, last);
+            const float t = static_cast<float> (position - static_cast<double> (whole));
+
+            dest[i] = source[index] + t * (source[next] - source[index]);
+            position += increment;
+        }
+
+        return position;
+    }
+
+    double resampleCubicScalar (float* dest, const float* source, int sourceLength,
+                                double position, double increment, int numSamples)
+    {
+        const int last = sourceLength - 1;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const int whole = static_cast<int> (position);
+            const int index = juce::jmin (whole, last);
+            const float t = static_cast<float> (position - static_cast<double> (whole));
+
+            dest[i] = cubic (source[juce::jmax (0, index - 1)], source[index],
+                             source[juce::jmin (index + 1, last)], source[juce::jmin (index + 2, last)], t);
+            position += increment;
+        }
+
+        return position;
+    }
+
+   #if JUCE_INTEL
+    //==============================================================================
+    MIX_KERNEL_TARGET ("sse2")
+    void addWithGainRampSSE2 (float* dest, const float* source, int numSamples, float startGain, float endGain)
+    {
+        const float step = numSamples > 0 ? (endGain - startGain) / static_cast<float> (numSamples) : 0.0f;
+
+        __m128 gain = _mm_setr_ps (startGain, startGain + step, startGain + 2.0f * step, startGain + 3.0f * step);
+        const __m128 gainStep = _mm_set1_ps (4.0f * step);
+
+        int i = 0;
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            const __m128 sum = _mm_add_ps (_mm_loadu_ps (dest + i), _mm_mul_ps (_mm_loadu_ps (source + i), gain));
+            _mm_storeu_ps (dest + i, sum);
+            gain = _mm_add_ps (gain, gainStep);
+        }
+
+        for (; i < numSamples; ++i)
+            dest[i] += source[i] * (startGain + step * static_cast<float> (i));
+    }
+
+    //==============================================================================
+    MIX_KERNEL_TARGET ("avx2")
+    void addWithGainRampAVX2 (float* dest, const float* source, int numSamples, float startGain, float endGain)
+    {
+        const float step = numSamples > 0 ? (endGain - startGain) / static_cast<float> (numSamples) : 0.0f;
+
+        __m256 gain = _mm256_add_ps (_mm256_set1_ps (startGain),
+                                     _mm256_mul_ps (_mm256_setr_ps (0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f),
+                                                    _mm256_set1_ps (step)));
+        const __m256 gainStep = _mm256_set1_ps (8.0f * step);
+
+        int i = 0;
+        for (; i + 8 <= numSamples; i += 8)
+        {
+            const __m256 sum = _mm256_add_ps (_mm256_loadu_ps (dest + i), _mm256_mul_ps (_mm256_loadu_ps (source + i), gain));
+            _mm256_storeu_ps (dest + i, sum);
+            gain = _mm256_add_ps (gain, gainStep);
+        }
+
+        for (; i < numSamples; ++i)
+            dest[i] += source[i] * (startGain + step * static_cast<float> (i));
+    }
+
+    // Lanes read at base + offset, where base is the integer part of the current
+    // position and offset stays small. Keeping the large part of the position in an
+    // integer means long samples do not lose fractional precision in single floats.
+    struct LanePositions
+    {
+        __m256i index;
+        __m256 fraction;
+    };
+
+    MIX_KERNEL_TARGET ("avx2")
+    inline LanePositions getLanePositions (double position, double increment) noexcept
+    {
+        const auto base = static_cast<int> (position);
+        const __m256 offsets = _mm256_add_ps (_mm256_set1_ps (static_cast<float> (position - base)),
+                                              _mm256_mul_ps (_mm256_setr_ps (0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f),
+                                                             _mm256_set1_ps (static_cast<float> (increment))));
+        const __m256 whole = _mm256_floor_ps (offsets);
+
+        return { _mm256_add_epi32 (_mm256_set1_epi32 (base), _mm256_cvttps_epi32 (whole)),
+                 _mm256_sub_ps (offsets, whole) };
+    }
+
+    MIX_KERNEL_TARGET ("avx2")
+    double resampleLinearAVX2 (float* dest, const float* source, int sourceLength,
+                               double position, double increment, int numSamples)
+    {
+        const __m256i last = _mm256_set1_epi32 (sourceLength - 1);
+        const __m256i one = _mm256_set1_epi32 (1);
+
+        int i = 0;
+        for (; i + 8 <= numSamples; i += 8)
+        {
+            const auto lanes = getLanePositions (position, increment);
+            const __m256i index = _mm256_min_epi32 (lanes.index, last);
+            const __m256i next = _mm256_min_epi32 (_mm256_add_epi32 (index, one), last);
+
+            const __m256 a = _mm256_i32gather_ps (source, index, 4);
+            const __m256 b = _mm256_i32gather_ps (source, next, 4);
+
+            _mm256_storeu_ps (dest + i, _mm256_add_ps (a, _mm256_mul_ps (lanes.fraction, _mm256_sub_ps (b, a))));
+            position += 8.0 * increment;
+        }
+
+        return resampleLinearScalar (dest + i, source, sourceLength, position, increment, numSamples - i);
+    }
+
+    MIX_KERNEL_TARGET ("avx2")
+    double resampleCubicAVX2 (float* dest, const float* source, int sourceLength,
+                              double position, double increment, int numSamples)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i last = _mm256_set1_epi32 (sourceLength - 1);
+        const __m256i one = _mm256_set1_epi32 (1);
+        const __m256 half = _mm256_set1_ps (0.5f);
+        const __m256 oneAndHalf = _mm256_set1_ps (1.5f);
+        const __m256 two = _mm256_set1_ps (2.0f);
+        const __m256 twoAndHalf = _mm256_set1_ps (2.5f);
+
+        int i = 0;
+        for (; i + 8 <= numSamples; i += 8)
+        {
+            const auto lanes = getLanePositions (position, increment);
+            const __m256i i0 = _mm256_min_epi32 (lanes.index, last);
+            const __m256i im1 = _mm256_max_epi32 (_mm256_sub_epi32 (i0, one), zero);
+            const __m256i i1 = _mm256_min_epi32 (_mm256_add_epi32 (i0, one), last);
+            const __m256i i2 = _mm256_min_epi32 (_mm256_add_epi32 (i1, one), last);
+
+            const __m256 xm1 = _mm256_i32gather_ps (source, im1, 4);
+            const __m256 x0  = _mm256_i32gather_ps (source, i0, 4);
+            const __m256 x1  = _mm256_i32gather_ps (source, i1, 4);
+            const __m256 x2  = _mm256_i32gather_ps (source, i2, 4);
+            const __m256 t = lanes.fraction;
+
+            const __m256 c1 = _mm256_mul_ps (half, _mm256_sub_ps (x1, xm1));
+            const __m256 c2 = _mm256_sub_ps (_mm256_add_ps (_mm256_sub_ps (xm1, _mm256_mul_ps (twoAndHalf, x0)), _mm256_mul_ps (two, x1)),
+                                             _mm256_mul_ps (half, x2));
+            const __m256 c3 = _mm256_add_ps (_mm256_mul_ps (half, _mm256_sub_ps (x2, xm1)),
+                                             _mm256_mul_ps (oneAndHalf, _mm256_sub_ps (x0, x1)));
+
+            const __m256 y = _mm256_add_ps (_mm256_mul_ps (_mm256_add_ps (_mm256_mul_ps (_mm256_add_ps (_mm256_mul_ps (c3, t), c2), t), c1), t), x0);
+            _mm256_storeu_ps (dest + i, y);
+            position += 8.0 * increment;
+        }
+
+        return resampleCubicScalar (dest + i, source, sourceLength, position, increment, numSamples - i);
+    }
+   #endif
+
+    //==============================================================================
+    const MixKernels scalarKernels { addWithGainRampScalar, resampleLinearScalar, resampleCubicScalar,
+                                     MixKernels::InstructionSet::scalar, "scalar" };
+
+   #if JUCE_INTEL
+    // SSE2 has no gather, so resampling stays scalar at that level
+    const MixKernels sse2Kernels { addWithGainRampSSE2, resampleLinearScalar, resampleCubicScalar,
+                                   MixKernels::InstructionSet::sse2, "SSE2" };
+
+    const MixKernels avx2Kernels { addWithGainRampAVX2, resampleLinearAVX2, resampleCubicAVX2,
+                                   MixKernels::InstructionSet::avx2, "AVX2" };
+   #endif
+}
+
+MixKernels::InstructionSet MixKernels::getBestAvailable()
+{
+   #if JUCE_INTEL
+    if (juce::SystemStats::hasAVX2())
+        return InstructionSet::avx2;
+
+    if (juce::SystemStats::hasSSE2())
+        return InstructionSet::sse2;
+   #endif
+
+    return InstructionSet::scalar;
+}
+
+const MixKernels& MixKernels::get()
+{
+    static const MixKernels& best = get (getBestAvailable());
+    return best;
+}
+
+const MixKernels& MixKernels::get (InstructionSet preferred)
+{
+   #if JUCE_INTEL
+    const auto available = getBestAvailable();
+    const auto instructionSet = static_cast<int> (preferred) < static_cast<int> (available) ? preferred : available;
+
+    if (instructionSet == InstructionSet::avx2)
+        return avx2Kernels;
+
+    if (instructionSet == InstructionSet::sse2)
+        return sse2Kernels;
+   #else
+    juce::ignoreUnused (preferred);
+   #endif
+
+    return scalarKernels;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+// The inner loops of the sample voice engine, with SSE and AVX2 versions chosen
+// at run time from what the CPU supports and a scalar version for everything else.
+//
+// A set of kernels is a table of function pointers. get() returns the fastest set
+// the machine can run; a specific set can be requested for benchmarking, in which
+// case an unsupported one falls back to the next slower.
+struct MixKernels
+{
+    enum class InstructionSet
+    {
+        scalar,
+        sse2,
+        avx2
+    };
+
+    // Adds source into dest, scaled by a gain that moves linearly from startGain
+    // towards endGain over the run.
+    void (*addWithGainRamp) (float* dest, const float* source, int numSamples, float startGain, float endGain);
+
+    // Writes numSamples values of source read at position, position + increment,
+    // ... into dest, interpolating linearly or with a 4-point cubic. Reads are
+    // clamped to [0, sourceLength). Returns the position after the last sample.
+    double (*resampleLinear) (float* dest, const float* source, int sourceLength,
+                              double position, double increment, int numSamples);
+    double (*resampleCubic) (float* dest, const float* source, int sourceLength,
+                             double position, double increment, int numSamples);
+
+    InstructionSet instructionSet;
+    const char* name;
+
+    // The fastest kernels this CPU supports.
+    static const MixKernels& get();
+
+    // The kernels for an instruction set, or the fastest supported one below it.
+    static const MixKernels& get (InstructionSet preferred);
+
+    static InstructionSet getBestAvailable();
+};
@@ -0,0 +1,203 @@
+#include "OfflineRenderer.h"
+#include "MidiPlaybackEngine.h"
+#include "PlaybackClock.h"
+#include "SampleVoiceEngine.h"
+
+namespace
+{
+    // Runs the engine over the whole song in blocks of the given size and hands
+    // each block's events to the handler, with the block's first sample and
+    // length. A last, empty block at the end carries the note-offs for notes the
+    // file never ended.
+    template <typename BlockHandler>
+    void renderEvents (const CompiledSong& song, const OfflineRenderer::Options& options,
+                       const PlaybackClock& clock, BlockHandler&& handleBlock)
+    {
+        MidiPlaybackEngine engine;
+        engine.setSong (&song);
+        engine.setOutputChannel (juce::jlimit (0, 16, options.outputChannel));
+
+        const int blockSize = juce::jmax (1, options.blockSize);
+        const int64_t endSample = clock.tickToSample (song.getLengthInTicks() + 1);
+        juce::MidiBuffer midi;
+
+        for (int64_t blockStart = 0; blockStart < endSample; blockStart += blockSize)
+        {
+            const int numSamples = static_cast<int> (juce::jmin<int64_t> (blockSize, endSample - blockStart));
+
+            midi.clear();
+            engine.renderBlock (blockStart, numSamples, clock, midi);
+            handleBlock (midi, blockStart, numSamples);
+        }
+
+        midi.clear();
+        engine.releaseActiveNotes (midi, 0);
+        handleBlock (midi, endSample, 0);
+    }
+
+    void prepareClock (PlaybackClock& clock, const CompiledSong& song, const OfflineRenderer::Options& options)
+    {
+        clock.prepare (options.sampleRate);
+
+        if (options.tempo > 0.0)
+            clock.useFixedTempo (options.tempo, song.getTicksPerQuarterNote());
+        else
+            clock.useTempoMap (song.getTempoMap());
+    }
+
+    bool isMetaEvent (const juce::uint8* data, int size, int type) noexcept
+    {
+        return size >= 2 && data[0] == 0xff && data[1] == type;
+    }
+
+    double getSeconds() noexcept
+    {
+        return juce::Time::getMillisecondCounterHiRes() * 0.001;
+    }
+}
+
+OfflineRenderer::Report OfflineRenderer::renderToMidi (const CompiledSong& song, const juce::File& destination, const Options& options)
+{
+    Report report;
+    const double startTime = getSeconds();
+
+    if (options.sampleRate <= 0.0)
+    {
+        report.result = juce::Result::fail ("Invalid sample rate");
+        return report;
+    }
+
+    PlaybackClock clock;
+    prepareClock (clock, song, options);
+
+    const int outputTicksPerQuarterNote = options.ticksPerQuarterNote > 0 ? options.ticksPerQuarterNote
+                                                                          : static_cast<int> (song.getTicksPerQuarterNote());
+    const double tickScale = outputTicksPerQuarterNote / song.getTicksPerQuarterNote();
+    const bool replaceTempo = options.tempo > 0.0;
+
+    juce::MidiMessageSequence sequence;
+
+    if (replaceTempo)
+        sequence.addEvent (juce::MidiMessage::tempoMetaEvent (juce::roundToInt (60.0e6 / options.tempo)), 0.0);
+
+    renderEvents (song, options, clock, [&] (const juce::MidiBuffer& midi, int64_t blockStart, int)
+    {
+        for (const auto metadata : midi)
+        {
+            // MidiFile writes its own end-of-track
+            if (isMetaEvent (metadata.data, metadata.numBytes, 0x2f)
+                || (replaceTempo && isMetaEvent (metadata.data, metadata.numBytes, 0x51)))
+                continue;
+
+            // Back from the sample the engine placed the event on to its tick
+            const double tick = clock.sampleToTick (blockStart + metadata.samplePosition);
+            sequence.addEvent (juce::MidiMessage (metadata.data, metadata.numBytes, std::round (tick * tickScale)));
+            ++report.numEvents;
+        }
+    });
+
+    juce::MidiFile file;
+    file.setTicksPerQuarterNote (outputTicksPerQuarterNote);
+    file.addTrack (sequence);
+
+    destination.deleteFile();
+    juce::FileOutputStream stream (destination);
+
+    if (! stream.openedOk() || ! file.writeTo (stream))
+    {
+        report.result = juce::Result::fail ("Could not write " + destination.getFullPathName());
+        return report;
+    }
+
+    report.songSeconds = clock.tickToSample (song.getLengthInTicks()) / options.sampleRate;
+    report.renderSeconds = getSeconds() - startTime;
+    return report;
+}
+
+OfflineRenderer::Report OfflineRenderer::renderToAudio (const CompiledSong& song, const SampleKit& kit,
+                                                        const juce::File& destination, const Options& options)
+{
+    Report report;
+    const double startTime = getSeconds();
+
+    if (options.sampleRate <= 0.0)
+    {
+        report.result = juce::Result::fail ("Invalid sample rate");
+        return report;
+    }
+
+    destination.deleteFile();
+    std::unique_ptr<juce::OutputStream> stream (destination.createOutputStream());
+    juce::WavAudioFormat wavFormat;
+    std::unique_ptr<juce::AudioFormatWriter> writer;
+
+    if (stream != nullptr)
+        writer.reset (wavFormat.createWriterFor (stream.get(), options.sampleRate, 2,
+                                                 options.bitsPerSample, {}, 0));
+
+    if (writer == nullptr)
+    {
+        report.result = juce::Result::fail ("Could not write " + destination.getFullPathName());
+        return report;
+    }
+
+    stream.release();   // now owned by the writer
+
+    PlaybackClock clock;
+    prepareClock (clock, song, options);
+
+    SampleVoiceEngine voices;
+    voices.prepare (options.sampleRate);
+    voices.setKit (&kit);
+
+    const int blockSize = juce::jmax (1, options.blockSize);
+    juce::AudioBuffer<float> audio (2, blockSize);
+    int64_t numSamplesWritten = 0;
+    bool writeFailed = false;
+
+    const auto renderAudio = [&] (const juce::MidiBuffer& midi, int numSamples)
+    {
+        juce::AudioBuffer<float> block (audio.getArrayOfWritePointers(), 2, numSamples);
+        block.clear();
+        voices.renderNextBlock (block, midi);
+
+        writeFailed = writeFailed || ! writer->writeFromAudioSampleBuffer (block, 0, numSamples);
+        numSamplesWritten += numSamples;
+    };
+
+    renderEvents (song, options, clock, [&] (const juce::MidiBuffer& midi, int64_t, int numSamples)
+    {
+        report.numEvents += midi.getNumEvents();
+
+        if (numSamples > 0)
+            renderAudio (midi, numSamples);
+    });
+
+    // Let the last samples ring out, stopping early once every voice has ended
+    const juce::MidiBuffer noEvents;
+    auto tailSamples = static_cast<int64_t> (juce::jmax (0.0, options.tailSeconds) * options.sampleRate);
+
+    while (tailSamples > 0 && voices.getNumActiveVoices() > 0)
+    {
+        const int numSamples = static_cast<int> (juce::jmin<int64_t> (blockSize, tailSamples));
+        renderAudio (noEvents, numSamples);
+        tailSamples -= numSamples;
+    }
+
+    writer.reset();
+
+    if (writeFailed)
+    {
+        report.result = juce::Result::fail ("Could not write " + destination.getFullPathName());
+        return report;
+    }
+
+    report.songSeconds = numSamplesWritten / options.sampleRate;
+    report.renderSeconds = getSeconds() - startTime;
+    return report;
+}
+
+SampleKit::Ptr OfflineRenderer::loadKit (const juce::File& folder, juce::AudioFormatManager& formatManager)
+{
+    return SampleKit::loadFromFolder (folder, formatManager, std::numeric_limits<int>::max());
+}
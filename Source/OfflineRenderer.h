@@ -0,0 +1,50 @@
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include "CompiledSong.h"
+#include "SampleKit.h"
+
+// Bounces a song faster than real time, either to a MIDI file re-timed onto a
+// new tempo and resolution or through a sample kit to a WAV file.
+//
+// Rendering runs the same MidiPlaybackEngine and SampleVoiceEngine as live
+// playback, in large blocks on the calling thread, with nothing waiting on a
+// clock or the disk. Every call keeps its state on the stack and only reads the
+// song and kit, so any number of renders can run on different threads at once.
+class OfflineRenderer final
+{
+public:
+    struct Options
+    {
+        double tempo = 0.0;              // BPM to conform to; 0 keeps the file's own tempo changes
+        int ticksPerQuarterNote = 0;     // of a written MIDI file; 0 keeps the song's
+        int outputChannel = 0;           // 1-16, or 0 for the file's own channels
+        double sampleRate = 44100.0;     // of a written WAV file
+        int bitsPerSample = 24;
+        int blockSize = 8192;
+        double tailSeconds = 2.0;        // rendered after the last event so samples can ring out
+    };
+
+    struct Report
+    {
+        juce::Result result = juce::Result::ok();
+        int numEvents = 0;               // MIDI messages written or played
+        double songSeconds = 0.0;        // length of what was rendered
+        double renderSeconds = 0.0;      // wall-clock time it took
+
+        double getSpeedFactor() const noexcept { return renderSeconds > 0.0 ? songSeconds / renderSeconds : 0.0; }
+    };
+
+    // Writes a single-track MIDI file. With a tempo set, the file's own tempo
+    // events are replaced by one at that tempo; either way every event keeps its
+    // musical position, rounded to the new resolution.
+    static Report renderToMidi (const CompiledSong& song, const juce::File& destination, const Options& options);
+
+    // Plays the song through the kit and writes a stereo WAV file.
+    static Report renderToAudio (const CompiledSong& song, const SampleKit& kit,
+                                 const juce::File& destination, const Options& options);
+
+    // Loads a kit with every sample decoded whole. Offline voices cannot wait for
+    // a streamer, so a kit loaded for live playback would cut long samples short.
+    static SampleKit::Ptr loadKit (const juce::File& folder, juce::AudioFormatManager& formatManager);
+};
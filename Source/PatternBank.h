@@ -0,0 +1,73 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "CompiledSong.h"
+
+// The patterns assigned to the pads of a pad controller, each compiled ahead of
+// time so launching one on the audio thread only starts a cursor.
+//
+// Pads are the notes from firstPadNote upwards, on any channel. Each pattern
+// loops over its length rounded up to whole bars of its own time signature, so
+// patterns launched on the same bar stay in phase.
+//
+// A bank is immutable once published. Changing a pad makes a new bank that
+// shares the other pads' songs, and the processor hands it to the audio thread
+// through a RealtimeExchange.
+class PatternBank final : public juce::ReferenceCountedObject
+{
+public:
+    using Ptr = juce::ReferenceCountedObjectPtr<PatternBank>;
+
+    static constexpr int numPads = 16;
+    static constexpr int firstPadNote = 36;   // C1, the bottom-left pad on most controllers
+
+    struct Pad
+    {
+        CompiledSong::Ptr pattern;
+        juce::File file;
+        int64_t loopLengthInTicks = 0;
+    };
+
+    PatternBank() = default;
+
+    // Returns a copy of this bank with one pad changed; a null pattern clears it.
+    Ptr withPattern (int padIndex, const juce::File& file, CompiledSong::Ptr pattern) const
+    {
+        Ptr bank (new PatternBank());
+        bank->pads = pads;
+
+        auto& pad = bank->pads[static_cast<size_t> (padIndex)];
+        pad.pattern = std::move (pattern);
+        pad.file = pad.pattern != nullptr ? file : juce::File();
+        pad.loopLengthInTicks = pad.pattern != nullptr ? getLoopLength (pad.pattern->getInfo()) : 0;
+        return bank;
+    }
+
+    const Pad& getPad (int padIndex) const noexcept { return pads[static_cast<size_t> (padIndex)]; }
+
+    int getNumAssigned() const noexcept
+    {
+        return static_cast<int> (std::count_if (pads.begin(), pads.end(), [] (const Pad& pad) { return pad.pattern != nullptr; }));
+    }
+
+    // The pad a note number triggers, or -1.
+    static int getPadForNote (int noteNumber) noexcept
+    {
+        const int padIndex = noteNumber - firstPadNote;
+        return juce::isPositiveAndBelow (padIndex, numPads) ? padIndex : -1;
+    }
+
+private:
+    static int64_t getLoopLength (const CompiledSong::Info& info)
+    {
+        // The song ends one tick after its last event, as in normal looping
+        const auto ticksPerBar = juce::jmax<int64_t> (1, std::llround (info.ticksPerQuarterNote * 4.0 * info.timeSigNumerator
+                                                                         / juce::jmax (1, info.timeSigDenominator)));
+        const auto numBars = (info.lengthInTicks + ticksPerBar) / ticksPerBar;
+        return numBars * ticksPerBar;
+    }
+
+    std::array<Pad, numPads> pads;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PatternBank)
+};
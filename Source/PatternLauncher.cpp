@@ -0,0 +1,201 @@
+#include "PatternLauncher.h"
+
+void PatternLauncher::prepare (double newSampleRate)
+{
+    sampleRate = newSampleRate > 0.0 ? newSampleRate : 44100.0;
+
+    for (auto& slot : slots)
+    {
+        slot.clock.prepare (sampleRate);
+        slot.isPlaying = false;
+        slot.pendingAction = Action::none;
+    }
+}
+
+void PatternLauncher::setBank (const PatternBank* newBank, juce::MidiBuffer& output, int samplePosition)
+{
+    bank = newBank;
+
+    for (int i = 0; i < PatternBank::numPads; ++i)
+    {
+        auto& slot = slots[static_cast<size_t> (i)];
+        const auto* pattern = bank != nullptr ? bank->getPad (i).pattern.get() : nullptr;
+
+        if (pattern == slot.pattern)
+            continue;
+
+        // The old pattern may be freed once the previous bank is retired
+        stopSlot (slot, output, samplePosition);
+        slot.pendingAction = Action::none;
+        slot.pattern = pattern;
+        slot.loopLengthInTicks = pattern != nullptr ? bank->getPad (i).loopLengthInTicks : 0;
+        slot.engine.setSong (pattern);
+    }
+}
+
+void PatternLauncher::setOutputBudget (int numBytes, bool shouldThin) noexcept
+{
+    for (auto& slot : slots)
+    {
+        slot.engine.setOutputBudget (numBytes);
+        slot.engine.setThinningEnabled (shouldThin);
+    }
+}
+
+void PatternLauncher::padPressed (int padIndex, int samplePosition) noexcept
+{
+    if (! juce::isPositiveAndBelow (padIndex, PatternBank::numPads))
+        return;
+
+    auto& slot = slots[static_cast<size_t> (padIndex)];
+    if (slot.pattern == nullptr)
+        return;
+
+    // A second press before the first takes effect undoes it
+    const bool willBePlaying = slot.pendingAction == Action::none ? slot.isPlaying
+                                                                  : slot.pendingAction == Action::start;
+
+    slot.pendingAction = (willBePlaying && ! retriggerOnRelaunch) ? Action::stop : Action::start;
+    slot.pressOffset = samplePosition;
+    slot.targetBeat = -1.0;
+}
+
+void PatternLauncher::renderBlock (const Grid& grid, int numSamples, juce::MidiBuffer& output)
+{
+    // Controller values held back last block go out first
+    for (auto& slot : slots)
+        slot.engine.flushHeldControllers (output, 0);
+
+    if (bank == nullptr || grid.tempo <= 0.0)
+        return;
+
+    const double samplesPerBeat = (60.0 / grid.tempo) * sampleRate;
+
+    for (auto& slot : slots)
+    {
+        if (slot.pattern == nullptr)
+            continue;
+
+        slot.clock.useFixedTempo (grid.tempo, slot.pattern->getTicksPerQuarterNote());
+        int startSample = 0;
+
+        if (slot.pendingAction != Action::none)
+        {
+            const int actionOffset = findActionOffset (slot, grid, samplesPerBeat);
+
+            if (actionOffset < numSamples)
+            {
+                if (slot.isPlaying)
+                    renderSlot (slot, output, 0, actionOffset);
+
+                // A retrigger ends the old notes on the sample the pattern restarts
+                stopSlot (slot, output, actionOffset);
+
+                if (slot.pendingAction == Action::start)
+                {
+                    slot.clock.seekToTick (0.0);
+                    slot.isPlaying = true;
+                }
+
+                slot.pendingAction = Action::none;
+                startSample = actionOffset;
+            }
+        }
+
+        if (slot.isPlaying)
+            renderSlot (slot, output, startSample, numSamples);
+    }
+}
+
+void PatternLauncher::stopAll (juce::MidiBuffer& output, int samplePosition)
+{
+    for (auto& slot : slots)
+    {
+        stopSlot (slot, output, samplePosition);
+        slot.pendingAction = Action::none;
+    }
+}
+
+int PatternLauncher::getNumPlaying() const noexcept
+{
+    return static_cast<int> (std::count_if (slots.begin(), slots.end(), [] (const Slot& slot) { return slot.isPlaying; }));
+}
+
+int64_t PatternLauncher::getNumDroppedEvents() const noexcept
+{
+    int64_t total = 0;
+    for (const auto& slot : slots)
+        total += slot.engine.getNumDroppedEvents();
+
+    return total;
+}
+
+int64_t PatternLauncher::getNumCoalescedEvents() const noexcept
+{
+    int64_t total = 0;
+    for (const auto& slot : slots)
+        total += slot.engine.getNumCoalescedEvents();
+
+    return total;
+}
+
+void PatternLauncher::stopSlot (Slot& slot, juce::MidiBuffer& output, int samplePosition)
+{
+    slot.engine.releaseActiveNotes (output, samplePosition);
+    slot.isPlaying = false;
+}
+
+int PatternLauncher::findActionOffset (Slot& slot, const Grid& grid, double samplesPerBeat)
+{
+    const bool onBars = quantization == Quantization::bar && grid.barLengthInBeats > 0.0;
+    const double unit = onBars ? grid.barLengthInBeats : 1.0;
+    const double origin = onBars ? grid.barStartPosition : 0.0;
+
+    // A target further away than one unit means the grid jumped back (a host
+    // loop or seek) since the press; aim for the next boundary from here instead
+    if (slot.targetBeat >= 0.0 && slot.targetBeat - grid.beatPosition > unit)
+    {
+        slot.targetBeat = -1.0;
+        slot.pressOffset = 0;
+    }
+
+    if (slot.targetBeat < 0.0)
+    {
+        // A press right on a boundary takes effect there rather than a unit later
+        const double pressBeat = grid.beatPosition + slot.pressOffset / samplesPerBeat;
+        slot.targetBeat = origin + std::ceil ((pressBeat - origin) / unit - 1.0e-9) * unit;
+    }
+
+    const double samplesAhead = (slot.targetBeat - grid.beatPosition) * samplesPerBeat;
+    return static_cast<int> (juce::jmax (0.0, std::ceil (samplesAhead - 1.0e-6)));
+}
+
+void PatternLauncher::renderSlot (Slot& slot, juce::MidiBuffer& output, int startSample, int endSample)
+{
+    auto& clock = slot.clock;
+
+    // Without a usable tempo the pattern has no length and cannot advance
+    if (clock.tickToSample (slot.loopLengthInTicks) <= clock.tickToSample (0))
+        return;
+
+    int rendered = startSample;
+
+    while (rendered < endSample)
+    {
+        const int64_t loopEnd = clock.tickToSample (slot.loopLengthInTicks);
+
+        if (clock.getPosition() >= loopEnd)
+        {
+            slot.engine.releaseActiveNotes (output, rendered);
+            clock.seekToTick (0.0);
+            continue;
+        }
+
+        const int64_t position = clock.getPosition();
+        const int length = static_cast<int> (juce::jmin<int64_t> (endSample - rendered, loopEnd - position));
+
+        slot.engine.renderBlock (position, length, clock, output, rendered);
+        clock.advance (length);
+        rendered += length;
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "MidiPlaybackEngine.h"
+#include "PatternBank.h"
+#include "PlaybackClock.h"
+
+// Launches, stops and retriggers the patterns of a PatternBank from pad presses,
+// with every change quantized to the next beat or bar.
+//
+// Each pad has its own MidiPlaybackEngine and PlaybackClock, so any number of
+// patterns can loop at once and each one's notes are released on its own when it
+// stops. A press only marks the pad; the beat it takes effect on is worked out
+// when the block is rendered and the change happens on that exact sample, which
+// may fall in a later block. Nothing here allocates.
+//
+// The launcher runs on a grid of quarter notes supplied by the caller for each
+// block: the host's position while its transport runs, otherwise a free-running
+// count kept by the processor.
+class PatternLauncher final
+{
+public:
+    enum class Quantization
+    {
+        beat,
+        bar
+    };
+
+    // Where the grid is at the first sample of the block being rendered.
+    struct Grid
+    {
+        double tempo = 120.0;                  // BPM
+        double beatPosition = 0.0;             // in quarter notes
+        double barStartPosition = 0.0;         // quarter note of the bar line at or before beatPosition
+        double barLengthInBeats = 4.0;
+    };
+
+    PatternLauncher() = default;
+
+    void prepare (double newSampleRate);
+
+    // Audio thread: switches bank. Pads whose pattern changed are stopped, with
+    // their notes released at the given sample; the others keep playing.
+    void setBank (const PatternBank* newBank, juce::MidiBuffer& output, int samplePosition);
+
+    void setQuantization (Quantization newQuantization) noexcept { quantization = newQuantization; }
+
+    // Whether pressing a playing pad restarts its pattern rather than stopping it.
+    void setRetriggerOnRelaunch (bool shouldRetrigger) noexcept { retriggerOnRelaunch = shouldRetrigger; }
+
+    // Output budget shared by all the pads, and whether they thin what does not fit.
+    void setOutputBudget (int numBytes, bool shouldThin) noexcept;
+
+    // Handles a press on a pad at the given sample of the next block to render.
+    // A pad without a pattern is ignored.
+    void padPressed (int padIndex, int samplePosition) noexcept;
+
+    // Renders every playing pattern into the buffer, carrying out pending
+    // launches and stops whose beat falls inside the block.
+    void renderBlock (const Grid& grid, int numSamples, juce::MidiBuffer& output);
+
+    // Stops every pad now, releasing its notes, and forgets pending presses.
+    void stopAll (juce::MidiBuffer& output, int samplePosition);
+
+    int getNumPlaying() const noexcept;
+
+    // Totals over all the pads; see MidiPlaybackEngine.
+    int64_t getNumDroppedEvents() const noexcept;
+    int64_t getNumCoalescedEvents() const noexcept;
+
+private:
+    enum class Action
+    {
+        none,
+        start,
+        stop
+    };
+
+    struct Slot
+    {
+        MidiPlaybackEngine engine;
+        PlaybackClock clock;
+        const CompiledSong* pattern = nullptr;
+        int64_t loopLengthInTicks = 0;
+        bool isPlaying = false;
+
+        Action pendingAction = Action::none;
+        int pressOffset = 0;          // sample in the block the press arrived in
+        double targetBeat = -1.0;     // grid beat the action happens on, once known
+    };
+
+    void stopSlot (Slot& slot, juce::MidiBuffer& output, int samplePosition);
+    int findActionOffset (Slot& slot, const Grid& grid, double samplesPerBeat);
+    void renderSlot (Slot& slot, juce::MidiBuffer& output, int startSample, int endSample);
+
+    std::array<Slot, PatternBank::numPads> slots;
+    const PatternBank* bank = nullptr;
+    double sampleRate = 44100.0;
+    Quantization quantization = Quantization::bar;
+    bool retriggerOnRelaunch = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PatternLauncher)
+};
@@ -0,0 +1,98 @@
+#include "PlaybackClock.h"
+
+void PlaybackClock::prepare (double newSampleRate)
+{
+    sampleRate = newSampleRate > 0.0 ? newSampleRate : 44100.0;
+    seekToTick (0.0);
+}
+
+void PlaybackClock::useTempoMap (const TempoMap& map)
+{
+    if (tempoMap == &map)
+        return;
+
+    if (tempoMap != nullptr)
+    {
+        switchTempoMap (&map);
+        return;
+    }
+
+    const double tick = getPositionInTicks();
+    tempoMap = &map;
+    seekToTick (tick);
+}
+
+void PlaybackClock::switchTempoMap (const TempoMap* map)
+{
+    if (tempoMap == map)
+        return;
+
+    const bool wasFollowingMap = tempoMap != nullptr;
+    tempoMap = map;
+
+    // Without the old map there is no tick to carry over, so the fixed tempo
+    // timeline is anchored at sample 0 and the position stays where it is
+    if (map == nullptr && wasFollowingMap)
+    {
+        anchorTick = 0.0;
+        anchorSample = 0;
+    }
+}
+
+void PlaybackClock::useFixedTempo (double bpm, double ticksPerQuarterNote)
+{
+    if (bpm <= 0.0 || ticksPerQuarterNote <= 0.0)
+        return;
+
+    const double newSamplesPerTick = (60.0 / bpm) * sampleRate / ticksPerQuarterNote;
+
+    if (tempoMap == nullptr && newSamplesPerTick == samplesPerTick)
+        return;
+
+    // Re-anchor so the tick under the playhead stays put while the tempo changes
+    const double tick = getPositionInTicks();
+    tempoMap = nullptr;
+    samplesPerTick = newSamplesPerTick;
+    anchorTick = tick;
+    anchorSample = position;
+}
+
+int64_t PlaybackClock::tickToSample (int64_t tick) const noexcept
+{
+    if (tempoMap != nullptr)
+        return std::llround (tempoMap->tickToSeconds (static_cast<double> (tick)) * sampleRate);
+
+    return anchorSample + std::llround ((static_cast<double> (tick) - anchorTick) * samplesPerTick);
+}
+
+int64_t PlaybackClock::tickToSample (int64_t tick, int& tempoSegmentHint) const noexcept
+{
+    if (tempoMap != nullptr)
+        return std::llround (tempoMap->tickToSeconds (static_cast<double> (tick), tempoSegmentHint) * sampleRate);
+
+    return anchorSample + std::llround ((static_cast<double> (tick) - anchorTick) * samplesPerTick);
+}
+
+double PlaybackClock::sampleToTick (int64_t sample) const noexcept
+{
+    if (tempoMap != nullptr)
+        return tempoMap->secondsToTick (static_cast<double> (sample) / sampleRate);
+
+    if (samplesPerTick <= 0.0)
+        return anchorTick;
+
+    return anchorTick + static_cast<double> (sample - anchorSample) / samplesPerTick;
+}
+
+void PlaybackClock::seekToTick (double tick)
+{
+    if (tempoMap != nullptr)
+    {
+        position = std::llround (tempoMap->tickToSeconds (tick) * sampleRate);
+        return;
+    }
+
+    anchorTick = tick;
+    anchorSample = std::llround (tick * samplesPerTick);
+    position = anchorSample;
+}
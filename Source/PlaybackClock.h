@@ -0,0 +1,62 @@
+#pragma once
+
+#include "TempoMap.h"
+
+// The playback position of a song, kept as a 64-bit sample count.
+//
+// Every event tick maps to one absolute sample through tickToSample(), which
+// depends only on the tick and the tempo settings, never on how the audio has
+// been split into blocks. Rendering any block size therefore places every event
+// on exactly the same sample, and no rounding error builds up between blocks.
+//
+// The mapping either follows a song's TempoMap or plays at a fixed tempo. A
+// fixed tempo is anchored at the position where it was last changed, so tempo
+// automation from the host bends the timeline without making it jump.
+class PlaybackClock final
+{
+public:
+    PlaybackClock() = default;
+
+    // Sets the sample rate and rewinds to the start.
+    void prepare (double newSampleRate);
+    double getSampleRate() const noexcept { return sampleRate; }
+
+    // Follow the tempo changes in a song. The map must outlive its use here.
+    // Switching from a fixed tempo keeps the tick position; switching from
+    // another map keeps the sample position, as the old map is not read.
+    void useTempoMap (const TempoMap& map);
+
+    // Follows another map, or stops following one when map is null, without
+    // reading through the map in use. Call this when the song that owns the
+    // map is swapped out, since the old song may be freed soon after. The
+    // sample position is kept; a fixed tempo in use stays as it is.
+    void switchTempoMap (const TempoMap* map);
+
+    // Play every tick at one tempo. The current tick position is preserved.
+    void useFixedTempo (double bpm, double ticksPerQuarterNote);
+
+    int64_t tickToSample (int64_t tick) const noexcept;
+
+    // The same for rising ticks, with a tempo segment hint kept by the caller;
+    // see TempoMap::tickToSeconds(). Set the hint to -1 after a jump.
+    int64_t tickToSample (int64_t tick, int& tempoSegmentHint) const noexcept;
+    double sampleToTick (int64_t sample) const noexcept;
+
+    int64_t getPosition() const noexcept { return position; }
+    double getPositionInTicks() const noexcept { return sampleToTick (position); }
+
+    // Jumps to a tick; for a fixed tempo this also re-anchors the timeline there.
+    void seekToTick (double tick);
+
+    void advance (int numSamples) noexcept { position += numSamples; }
+
+private:
+    double sampleRate = 44100.0;
+    int64_t position = 0;
+
+    const TempoMap* tempoMap = nullptr;
+
+    double samplesPerTick = 0.0;
+    double anchorTick = 0.0;
+    int64_t anchorSample = 0;
+};
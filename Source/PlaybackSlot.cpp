@@ -0,0 +1,162 @@
+#include "PlaybackSlot.h"
+
+void PlaybackSlot::prepare (double sampleRate)
+{
+    clock.prepare (sampleRate);
+    finished = false;
+}
+
+void PlaybackSlot::setSong (const CompiledSong* newSong, juce::MidiBuffer& output, int samplePosition)
+{
+    engine.releaseActiveNotes (output, samplePosition);
+
+    // Re-point the clock before the old song can be retired and freed. In host
+    // tempo it keeps its fixed tempo, so the tick position carries over.
+    clock.switchTempoMap (newSong != nullptr && tempoSource == TempoSource::file ? &newSong->getTempoMap() : nullptr);
+
+    engine.setSong (newSong);
+    finished = false;
+}
+
+void PlaybackSlot::setMuted (bool shouldMute, juce::MidiBuffer& output, int samplePosition)
+{
+    if (shouldMute == engine.isMuted())
+        return;
+
+    engine.releaseActiveNotes (output, samplePosition);
+    engine.setMuted (shouldMute);
+}
+
+void PlaybackSlot::setOutputChannel (int channel, juce::MidiBuffer& output, int samplePosition)
+{
+    channel = juce::jlimit (0, 16, channel);
+    if (channel == engine.getOutputChannel())
+        return;
+
+    engine.releaseActiveNotes (output, samplePosition);
+    engine.setOutputChannel (channel);
+}
+
+void PlaybackSlot::start()
+{
+    clock.seekToTick (0.0);
+    finished = false;
+}
+
+void PlaybackSlot::seekToQuarterNote (double quarterNote)
+{
+    const auto* song = getSong();
+    if (song == nullptr)
+        return;
+
+    const double loopLength = static_cast<double> (song->getLengthInTicks() + 1);
+    double tick = juce::jmax (0.0, quarterNote * song->getTicksPerQuarterNote());
+
+    if (looping)
+        tick = std::fmod (tick, loopLength);
+
+    clock.seekToTick (tick);
+    finished = tick >= loopLength;
+}
+
+double PlaybackSlot::getPositionInQuarterNotes() const noexcept
+{
+    const auto* song = getSong();
+    return song != nullptr ? clock.getPositionInTicks() / song->getTicksPerQuarterNote() : 0.0;
+}
+
+void PlaybackSlot::render (double hostTempo, juce::MidiBuffer& output, int outputOffset, int numSamples)
+{
+    const auto* song = getSong();
+    if (song == nullptr || finished)
+        return;
+
+    if (tempoSource == TempoSource::host)
+        clock.useFixedTempo (hostTempo, song->getTicksPerQuarterNote());
+    else
+        clock.useTempoMap (song->getTempoMap());
+
+    if (! renderFromClock (output, outputOffset, numSamples))
+        finished = true;
+}
+
+void PlaybackSlot::renderLocked (double quarterNotesFromAnchor, double hostTempo,
+                                 juce::MidiBuffer& output, int outputOffset, int numSamples)
+{
+    const auto* song = getSong();
+    if (song == nullptr || hostTempo <= 0.0)
+        return;
+
+    const double ticksPerQuarterNote = song->getTicksPerQuarterNote();
+    const double loopLength = static_cast<double> (song->getLengthInTicks() + 1);
+    clock.useFixedTempo (hostTempo, ticksPerQuarterNote);
+
+    double songTick = quarterNotesFromAnchor * ticksPerQuarterNote;
+
+    if (looping)
+        songTick = std::fmod (songTick, loopLength);
+
+    if (! looping && songTick >= loopLength)
+    {
+        engine.releaseActiveNotes (output, outputOffset);
+        return;
+    }
+
+    // Re-seek when the host jumped (seek, loop brace, tempo change) rather than
+    // following our own running position
+    const double samplesPerTick = (60.0 / hostTempo) * clock.getSampleRate() / ticksPerQuarterNote;
+    const double samplesOff = std::abs (clock.getPositionInTicks() - songTick) * samplesPerTick;
+
+    if (samplesOff > hostJumpToleranceSamples)
+    {
+        engine.releaseActiveNotes (output, outputOffset);
+        clock.seekToTick (songTick);
+    }
+
+    renderFromClock (output, outputOffset, numSamples);
+}
+
+bool PlaybackSlot::renderFromClock (juce::MidiBuffer& output, int outputOffset, int numSamples)
+{
+    // The loop wraps one tick after the last event
+    const int64_t endTick = engine.getLengthInTicks() + 1;
+
+    // Without a usable tempo the timeline has no length and cannot advance
+    if (clock.tickToSample (endTick) <= clock.tickToSample (0))
+        return true;
+
+    const int endOfBlock = outputOffset + numSamples;
+    int rendered = outputOffset;
+
+    // Events are placed by absolute sample position, so the result does not
+    // depend on the block size. A loop wrap inside the block is rendered in
+    // two parts so the restart lands on the exact sample. The end is handled
+    // at the top of the loop so that, when it falls on a block boundary, the
+    // note-offs for notes still held go out at the start of the next block.
+    while (rendered < endOfBlock)
+    {
+        const int64_t songEnd = clock.tickToSample (endTick);
+
+        if (clock.getPosition() >= songEnd)
+        {
+            engine.releaseActiveNotes (output, rendered);
+
+            if (! looping)
+                return false;
+
+            clock.seekToTick (0.0);
+        }
+
+        const int64_t position = clock.getPosition();
+        const int length = static_cast<int> (juce::jmin<int64_t> (endOfBlock - rendered, songEnd - position));
+
+        if (length > 0)
+        {
+            engine.renderBlock (position, length, clock, output, rendered);
+            clock.advance (length);
+            rendered += length;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "MidiPlaybackEngine.h"
+#include "PlaybackClock.h"
+
+// One of the songs the processor plays at the same time.
+//
+// Each slot has its own cursor and clock, so songs of different lengths and
+// resolutions can be layered and each loops on its own. The transport is shared:
+// the processor starts, stops and seeks every slot together, and in host-locked
+// mode hands each one the same host position. What a slot decides for itself is
+// whether it loops, whether it is heard, which MIDI channel it plays on and
+// whether it follows the host's tempo or its file's own tempo map.
+//
+// Slot 0 holds the file picked in the browser; the others are layers. Slots
+// belong to the audio thread and never allocate.
+class PlaybackSlot final
+{
+public:
+    enum class TempoSource
+    {
+        file,
+        host
+    };
+
+    PlaybackSlot() = default;
+
+    void prepare (double sampleRate);
+
+    // Swaps the song, releasing the old one's notes at the given sample. The
+    // position is kept, and the clock stops using the old song's tempo map.
+    void setSong (const CompiledSong* newSong, juce::MidiBuffer& output, int samplePosition);
+    const CompiledSong* getSong() const noexcept { return engine.getSong(); }
+    bool isEmpty() const noexcept { return engine.isEmpty(); }
+
+    void setLooping (bool shouldLoop) noexcept { looping = shouldLoop; }
+    bool isLooping() const noexcept { return looping; }
+
+    void setTempoSource (TempoSource newSource) noexcept { tempoSource = newSource; }
+    TempoSource getTempoSource() const noexcept { return tempoSource; }
+
+    // Muting or moving to another channel first releases the notes that are sounding.
+    void setMuted (bool shouldMute, juce::MidiBuffer& output, int samplePosition);
+    void setOutputChannel (int channel, juce::MidiBuffer& output, int samplePosition);
+
+    // Rewinds to tick 0.
+    void start();
+
+    // Jumps to a position given in quarter notes, wrapped into the loop if looping.
+    void seekToQuarterNote (double quarterNote);
+    double getPositionInQuarterNotes() const noexcept;
+    double getPositionInTicks() const noexcept { return clock.getPositionInTicks(); }
+
+    void releaseActiveNotes (juce::MidiBuffer& output, int samplePosition) { engine.releaseActiveNotes (output, samplePosition); }
+
+    // Output budget and thinning; see MidiPlaybackEngine.
+    void setOutputBudget (int numBytes) noexcept { engine.setOutputBudget (numBytes); }
+    void setThinningEnabled (bool shouldThin) noexcept { engine.setThinningEnabled (shouldThin); }
+    void flushHeldControllers (juce::MidiBuffer& output) { engine.flushHeldControllers (output, 0); }
+    int64_t getNumDroppedEvents() const noexcept { return engine.getNumDroppedEvents(); }
+    int64_t getNumCoalescedEvents() const noexcept { return engine.getNumCoalescedEvents(); }
+
+    // True once a slot that does not loop has played to its end.
+    bool hasFinished() const noexcept { return finished; }
+
+    // Free-running playback: renders the next numSamples from the slot's own clock,
+    // at the host tempo or along the file's tempo map.
+    void render (double hostTempo, juce::MidiBuffer& output, int outputOffset, int numSamples);
+
+    // Host-locked playback: renders a segment that starts the given number of
+    // quarter notes after the host position where tick 0 is anchored, re-seeking
+    // if the host has jumped since the last one.
+    void renderLocked (double quarterNotesFromAnchor, double hostTempo,
+                       juce::MidiBuffer& output, int outputOffset, int numSamples);
+
+private:
+    bool renderFromClock (juce::MidiBuffer& output, int outputOffset, int numSamples);
+
+    static constexpr double hostJumpToleranceSamples = 2.0;
+
+    MidiPlaybackEngine engine;
+    PlaybackClock clock;
+    TempoSource tempoSource = TempoSource::host;
+    bool looping = false;
+    bool finished = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PlaybackSlot)
+};
@@ -4,18 +4,38 @@
 MidiFartSnifferEditor::MidiFartSnifferEditor (MidiFartSnifferProcessor& p)
     : AudioProcessorEditor (&p), audioProcessor (p)
 {
-    // File browser setup
-    wildCardFilter = std::make_unique<juce::WildcardFileFilter> ("*.mid;*.midi", "*", "MIDI Files");
-    fileBrowser = std::make_unique<juce::FileBrowserComponent> (
-        juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
-        juce::File::getSpecialLocation (juce::File::userDocumentsDirectory),
-        wildCardFilter.get(),
-        nullptr
-    );
-    
-    fileBrowser->addListener (this);
+    // Folder browser, listing in the background so large folders open at once
+    folderBrowser.onFileClicked = [this] (const juce::File& file, const juce::MouseEvent& e) {
+        fileClicked (file, e);
+    };
+    folderBrowser.onFileDoubleClicked = [this] (const juce::File& file) {
+        fileDoubleClicked (file);
+    };
+    folderBrowser.onSelectionChanged = [this] (const juce::File& file) {
+        fileSelected (file);
+    };
+
+    // Library search, sharing the left panel with the browser and its load path
+    searchPanel.onFileClicked = [this] (const juce::File& file, const juce::MouseEvent& e) {
+        fileClicked (file, e);
+    };
+    searchPanel.onFileDoubleClicked = [this] (const juce::File& file) {
+        fileDoubleClicked (file);
+    };
+    searchPanel.onSelectionChanged = [this] (const juce::File& file) {
+        fileSelected (file);
+    };
+
+    audioProcessor.getLibraryIndexer().onIndexChanged = [this] {
+        searchPanel.setIndex (audioProcessor.getLibraryIndexer().getIndex());
+        updateLibraryLabel();
+    };
+    searchPanel.setIndex (audioProcessor.getLibraryIndexer().getIndex());
 
-    addAndMakeVisible (fileBrowser.get());
+    const auto tabColour = getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId);
+    browserTabs.addTab ("Browse", tabColour, &folderBrowser, false);
+    browserTabs.addTab ("Search", tabColour, &searchPanel, false);
+    addAndMakeVisible (browserTabs);
 
     // Playback controls
     playButton.onClick = [this] { 
@@ -36,6 +56,17 @@ MidiFartSnifferEditor::MidiFartSnifferEditor (MidiFartSnifferProcessor& p)
         updateStatus();
     };
     syncButton.setToggleState (audioProcessor.isSyncedToHost(), juce::dontSendNotification);
+
+    lockButton.onClick = [this] {
+        audioProcessor.setLockToHostPosition (lockButton.getToggleState());
+        updateStatus();
+    };
+    lockButton.setToggleState (audioProcessor.isLockedToHostPosition(), juce::dontSendNotification);
+
+    startOnBarButton.onClick = [this] {
+        audioProcessor.setStartOnNextBar (startOnBarButton.getToggleState());
+    };
+    startOnBarButton.setToggleState (audioProcessor.isStartingOnNextBar(), juce::dontSendNotification);
     
     autoPlayCheckbox.onClick = [this] {
         audioProcessor.setAutoPlay (autoPlayCheckbox.getToggleState());
@@ -45,19 +76,125 @@ MidiFartSnifferEditor::MidiFartSnifferEditor (MidiFartSnifferProcessor& p)
     favoriteButton.onClick = [this] {
         toggleFavorite();
     };
+    thinningButton.onClick = [this] {
+        audioProcessor.setThinningEnabled (thinningButton.getToggleState());
+    };
+    thinningButton.setToggleState (audioProcessor.isThinningEnabled(), juce::dontSendNotification);
+
+    loadKitButton.onClick = [this] {
+        chooseSampleKit();
+    };
+    clearKitButton.onClick = [this] {
+        audioProcessor.unloadSampleKit();
+        updateKitLabel();
+    };
+    auditionButton.onClick = [this] {
+        audioProcessor.setAuditionEnabled (auditionButton.getToggleState());
+    };
+    auditionButton.setToggleState (audioProcessor.isAuditionEnabled(), juce::dontSendNotification);
+
+    padLaunchButton.onClick = [this] {
+        audioProcessor.setPatternLaunchEnabled (padLaunchButton.getToggleState());
+    };
+    padLaunchButton.setToggleState (audioProcessor.isPatternLaunchEnabled(), juce::dontSendNotification);
+
+    retriggerButton.onClick = [this] {
+        audioProcessor.setRetriggerOnRelaunch (retriggerButton.getToggleState());
+    };
+    retriggerButton.setToggleState (audioProcessor.isRetriggeringOnRelaunch(), juce::dontSendNotification);
+
+    quantizeBox.addItem ("On beat", 1);
+    quantizeBox.addItem ("On bar", 2);
+    quantizeBox.setSelectedId (audioProcessor.getLaunchQuantization() == PatternLauncher::Quantization::beat ? 1 : 2,
+                               juce::dontSendNotification);
+    quantizeBox.onChange = [this] {
+        audioProcessor.setLaunchQuantization (quantizeBox.getSelectedId() == 1 ? PatternLauncher::Quantization::beat
+                                                                                 : PatternLauncher::Quantization::bar);
+    };
+
+    for (int i = 0; i < PatternBank::numPads; ++i)
+        padBox.addItem ("Pad " + juce::String (i + 1) + " (note " + juce::String (PatternBank::firstPadNote + i) + ")", i + 1);
+
+    padBox.setSelectedId (1, juce::dontSendNotification);
+    padBox.onChange = [this] {
+        updatePadControls();
+    };
+
+    assignPadButton.onClick = [this] {
+        togglePadAssignment();
+    };
+
+    for (int i = 1; i < MidiFartSnifferProcessor::numSlots; ++i)
+        layerBox.addItem ("Layer " + juce::String (i), i);
+
+    layerBox.setSelectedId (1, juce::dontSendNotification);
+    layerBox.onChange = [this] {
+        updateLayerControls();
+    };
+
+    layerChannelBox.addItem ("File channels", 1);
+    for (int channel = 1; channel <= 16; ++channel)
+        layerChannelBox.addItem ("Channel " + juce::String (channel), channel + 1);
+
+    layerChannelBox.onChange = [this] {
+        audioProcessor.setSlotOutputChannel (layerBox.getSelectedId(), layerChannelBox.getSelectedId() - 1);
+    };
+
+    layerButton.onClick = [this] {
+        toggleLayer();
+    };
+    layerMuteButton.onClick = [this] {
+        audioProcessor.setSlotMuted (layerBox.getSelectedId(), layerMuteButton.getToggleState());
+    };
+    layerLoopButton.onClick = [this] {
+        audioProcessor.setSlotLooping (layerBox.getSelectedId(), layerLoopButton.getToggleState());
+    };
+    layerSyncButton.onClick = [this] {
+        audioProcessor.setSlotFollowsHostTempo (layerBox.getSelectedId(), layerSyncButton.getToggleState());
+    };
 
     addAndMakeVisible (playButton);
     addAndMakeVisible (stopButton);
     addAndMakeVisible (loopButton);
     addAndMakeVisible (syncButton);
+    addAndMakeVisible (lockButton);
+    addAndMakeVisible (startOnBarButton);
     addAndMakeVisible (autoPlayCheckbox);
     addAndMakeVisible (favoriteButton);
+    addAndMakeVisible (thinningButton);
+    addAndMakeVisible (loadKitButton);
+    addAndMakeVisible (clearKitButton);
+    addAndMakeVisible (auditionButton);
+    addAndMakeVisible (padLaunchButton);
+    addAndMakeVisible (retriggerButton);
+    addAndMakeVisible (quantizeBox);
+    addAndMakeVisible (padBox);
+    addAndMakeVisible (assignPadButton);
+    addAndMakeVisible (layerBox);
+    addAndMakeVisible (layerButton);
+    addAndMakeVisible (layerMuteButton);
+    addAndMakeVisible (layerChannelBox);
+    addAndMakeVisible (layerLoopButton);
+    addAndMakeVisible (layerSyncButton);
+
+    // Library: the folder shown in the browser becomes the indexed library
+    libraryButton.onClick = [this] {
+        audioProcessor.setLibraryFolder (folderBrowser.getFolder());
+        updateLibraryLabel();
+    };
+    rescanButton.onClick = [this] {
+        audioProcessor.getLibraryIndexer().refresh();
+    };
+    addAndMakeVisible (libraryButton);
+    addAndMakeVisible (rescanButton);
 
     // Position slider
     positionSlider.setRange (0.0, 1.0, 0.0);
     positionSlider.setSliderStyle (juce::Slider::LinearHorizontal);
     positionSlider.setTextBoxStyle (juce::Slider::NoTextBox, false, 0, 0);
-    positionSlider.setEnabled (false);
+    positionSlider.onDragEnd = [this] {
+        audioProcessor.seek (positionSlider.getValue() * static_cast<double> (audioProcessor.getMaxTick()));
+    };
     addAndMakeVisible (positionSlider);
 
     // Status labels
@@ -71,6 +208,31 @@ MidiFartSnifferEditor::MidiFartSnifferEditor (MidiFartSnifferProcessor& p)
     addAndMakeVisible (fileNameLabel);
     addAndMakeVisible (statusLabel);
     addAndMakeVisible (tempoLabel);
+
+    kitLabel.setJustificationType (juce::Justification::centredLeft);
+    kitLabel.setFont (juce::Font (15.0f));
+    addAndMakeVisible (kitLabel);
+    updateKitLabel();
+
+    padsLabel.setJustificationType (juce::Justification::centredLeft);
+    padsLabel.setFont (juce::Font (15.0f));
+    addAndMakeVisible (padsLabel);
+    updatePadControls();
+
+    layerLabel.setJustificationType (juce::Justification::centredLeft);
+    layerLabel.setFont (juce::Font (15.0f));
+    addAndMakeVisible (layerLabel);
+    updateLayerControls();
+
+    outputLabel.setJustificationType (juce::Justification::centredLeft);
+    outputLabel.setFont (juce::Font (15.0f));
+    addAndMakeVisible (outputLabel);
+    updateOutputLabel();
+
+    libraryLabel.setJustificationType (juce::Justification::centredLeft);
+    libraryLabel.setFont (juce::Font (15.0f));
+    addAndMakeVisible (libraryLabel);
+    updateLibraryLabel();
     
     // Favorites list setup
     favoritesLabel.setJustificationType (juce::Justification::centredLeft);
@@ -89,21 +251,28 @@ MidiFartSnifferEditor::MidiFartSnifferEditor (MidiFartSnifferProcessor& p)
     // Start timer for updating position
     startTimerHz (30);
 
-    setSize (800, 600);
+    setSize (800, 795);
 }
 
 MidiFartSnifferEditor::~MidiFartSnifferEditor()
 {
     stopTimer();
+    audioProcessor.getLibraryIndexer().onIndexChanged = nullptr;
 }
 
 void MidiFartSnifferEditor::timerCallback()
 {
-    if (audioProcessor.getIsPlaying())
+    auto snapshot = audioProcessor.getPlaybackSnapshot();
+
+    if (snapshot.isPlaying && ! positionSlider.isMouseButtonDown())
     {
-        positionSlider.setValue (audioProcessor.getPlaybackPosition(), juce::dontSendNotification);
+        positionSlider.setValue (snapshot.position, juce::dontSendNotification);
         updateStatus();
     }
+
+    updatePadControls();
+    updateOutputLabel();
+    updateLibraryLabel();
 }
 
 void MidiFartSnifferEditor::paint (juce::Graphics& g)
@@ -115,8 +284,8 @@ void MidiFartSnifferEditor::resized()
 {
     auto bounds = getLocalBounds();
 
-    // Left panel: File browser (60% width)
-    fileBrowser->setBounds (bounds.removeFromLeft (bounds.proportionOfWidth (0.6f)));
+    // Left panel: File browser and library search (60% width)
+    browserTabs.setBounds (bounds.removeFromLeft (bounds.proportionOfWidth (0.6f)));
 
     // Right panel: Controls and status
     auto rightPanel = bounds.reduced (5);
@@ -130,12 +299,52 @@ void MidiFartSnifferEditor::resized()
     auto buttonRow2 = rightPanel.removeFromTop (30);
     loopButton.setBounds (buttonRow2.removeFromLeft (buttonRow2.proportionOfWidth (0.5f)).reduced (2));
     syncButton.setBounds (buttonRow2.reduced (2));
+
+    // Buttons row 3
+    auto buttonRow3 = rightPanel.removeFromTop (30);
+    lockButton.setBounds (buttonRow3.removeFromLeft (buttonRow3.proportionOfWidth (0.5f)).reduced (2));
+    startOnBarButton.setBounds (buttonRow3.reduced (2));
     
-    // Auto-play checkbox
-    autoPlayCheckbox.setBounds (rightPanel.removeFromTop (30).reduced (2));
+    // Auto-play and audition checkboxes
+    auto buttonRow4 = rightPanel.removeFromTop (30);
+    autoPlayCheckbox.setBounds (buttonRow4.removeFromLeft (buttonRow4.proportionOfWidth (0.5f)).reduced (2));
+    auditionButton.setBounds (buttonRow4.reduced (2));
     
-    // Favorite button
-    favoriteButton.setBounds (rightPanel.removeFromTop (30).reduced (2));
+    // Favorite button and thinning toggle
+    auto buttonRow5 = rightPanel.removeFromTop (30);
+    favoriteButton.setBounds (buttonRow5.removeFromLeft (buttonRow5.proportionOfWidth (0.5f)).reduced (2));
+    thinningButton.setBounds (buttonRow5.reduced (2));
+
+    // Sample kit row
+    auto kitRow = rightPanel.removeFromTop (30);
+    loadKitButton.setBounds (kitRow.removeFromLeft (kitRow.proportionOfWidth (0.5f)).reduced (2));
+    clearKitButton.setBounds (kitRow.reduced (2));
+
+    // Pattern launch rows
+    auto launchRow = rightPanel.removeFromTop (30);
+    padLaunchButton.setBounds (launchRow.removeFromLeft (launchRow.proportionOfWidth (0.5f)).reduced (2));
+    retriggerButton.setBounds (launchRow.reduced (2));
+
+    auto padRow = rightPanel.removeFromTop (30);
+    quantizeBox.setBounds (padRow.removeFromLeft (padRow.proportionOfWidth (0.34f)).reduced (2));
+    padBox.setBounds (padRow.removeFromLeft (padRow.proportionOfWidth (0.5f)).reduced (2));
+    assignPadButton.setBounds (padRow.reduced (2));
+
+    // Layer rows
+    auto layerRow = rightPanel.removeFromTop (30);
+    layerBox.setBounds (layerRow.removeFromLeft (layerRow.proportionOfWidth (0.34f)).reduced (2));
+    layerButton.setBounds (layerRow.removeFromLeft (layerRow.proportionOfWidth (0.5f)).reduced (2));
+    layerMuteButton.setBounds (layerRow.reduced (2));
+
+    auto layerSettingsRow = rightPanel.removeFromTop (30);
+    layerChannelBox.setBounds (layerSettingsRow.removeFromLeft (layerSettingsRow.proportionOfWidth (0.34f)).reduced (2));
+    layerLoopButton.setBounds (layerSettingsRow.removeFromLeft (layerSettingsRow.proportionOfWidth (0.5f)).reduced (2));
+    layerSyncButton.setBounds (layerSettingsRow.reduced (2));
+
+    // Library row
+    auto libraryRow = rightPanel.removeFromTop (30);
+    libraryButton.setBounds (libraryRow.removeFromLeft (libraryRow.proportionOfWidth (0.5f)).reduced (2));
+    rescanButton.setBounds (libraryRow.reduced (2));
 
     // Position slider
     positionSlider.setBounds (rightPanel.removeFromTop (30).reduced (5));
@@ -144,6 +353,11 @@ void MidiFartSnifferEditor::resized()
     fileNameLabel.setBounds (rightPanel.removeFromTop (25).reduced (2));
     statusLabel.setBounds (rightPanel.removeFromTop (25).reduced (2));
     tempoLabel.setBounds (rightPanel.removeFromTop (25).reduced (2));
+    kitLabel.setBounds (rightPanel.removeFromTop (25).reduced (2));
+    padsLabel.setBounds (rightPanel.removeFromTop (25).reduced (2));
+    layerLabel.setBounds (rightPanel.removeFromTop (25).reduced (2));
+    outputLabel.setBounds (rightPanel.removeFromTop (25).reduced (2));
+    libraryLabel.setBounds (rightPanel.removeFromTop (25).reduced (2));
     
     // Favorites section
     rightPanel.removeFromTop (10); // spacing
@@ -151,18 +365,22 @@ void MidiFartSnifferEditor::resized()
     favoritesList.setBounds (rightPanel.reduced (2));
 }
 
-void MidiFartSnifferEditor::selectionChanged()
+void MidiFartSnifferEditor::fileSelected (const juce::File& file)
 {
-    auto selectedFile = fileBrowser->getSelectedFile (0);
-    if (selectedFile.existsAsFile())
+    if (file.existsAsFile())
     {
-        loadSelectedFile (selectedFile);
+        // Keyboard navigation auditions each file as it is selected when auto-play is on
+        loadSelectedFile (file, audioProcessor.isAutoPlayEnabled());
     }
 }
 
-void MidiFartSnifferEditor::fileClicked (const juce::File& file, const juce::MouseEvent&)
+void MidiFartSnifferEditor::fileClicked (const juce::File& file, const juce::MouseEvent& e)
 {
-    if (file.existsAsFile())
+    if (file.existsAsFile() && e.mods.isPopupMenu())
+    {
+        showFileMenu (file);
+    }
+    else if (file.existsAsFile())
     {
         // Check if clicking the same file that is currently playing
         if (audioProcessor.getIsPlaying() && file == lastClickedFile)
@@ -174,21 +392,24 @@ void MidiFartSnifferEditor::fileClicked (const juce::File& file, const juce::Mou
         }
         else
         {
-            // Load the file
-            loadSelectedFile (file);
+            // Load the file, auto-playing once it is ready if enabled
+            loadSelectedFile (file, audioProcessor.isAutoPlayEnabled());
             lastClickedFile = file;
-            
-            // Auto-play if enabled
-            if (audioProcessor.isAutoPlayEnabled())
-            {
-                audioProcessor.startPlayback();
-                statusLabel.setText ("Playing...", juce::dontSendNotification);
-                updateStatus();
-            }
         }
     }
 }
 
+void MidiFartSnifferEditor::showFileMenu (const juce::File& file)
+{
+    juce::PopupMenu menu;
+    menu.addItem ("Find Similar Grooves", audioProcessor.getLibraryIndexer().getIndex() != nullptr, false, [this, file] {
+        searchPanel.showSimilar (file);
+        browserTabs.setCurrentTabIndex (1);
+    });
+
+    menu.showMenuAsync (juce::PopupMenu::Options().withMousePosition());
+}
+
 void MidiFartSnifferEditor::fileDoubleClicked (const juce::File& file)
 {
     if (file.existsAsFile())
@@ -197,18 +418,57 @@ void MidiFartSnifferEditor::fileDoubleClicked (const juce::File& file)
     }
 }
 
-void MidiFartSnifferEditor::loadSelectedFile (const juce::File& file)
+void MidiFartSnifferEditor::loadSelectedFile (const juce::File& file, bool playWhenLoaded)
 {
-    audioProcessor.loadMidiFile (file);
     fileNameLabel.setText (file.getFileName(), juce::dontSendNotification);
+    statusLabel.setText ("Loading...", juce::dontSendNotification);
+
+    // Parsing happens on the processor's loader thread; only the newest request calls back
+    juce::Component::SafePointer<MidiFartSnifferEditor> safeThis (this);
+    audioProcessor.loadMidiFileAsync (file, [safeThis, playWhenLoaded] (bool loaded)
+    {
+        if (safeThis != nullptr)
+            safeThis->fileLoaded (loaded, playWhenLoaded);
+    });
+}
+
+void MidiFartSnifferEditor::fileLoaded (bool loaded, bool playWhenLoaded)
+{
+    if (! loaded)
+    {
+        statusLabel.setText ("Failed to load file", juce::dontSendNotification);
+        return;
+    }
+
+    updateFileInfo();
+    updateLayerControls();
+
+    if (playWhenLoaded)
+    {
+        audioProcessor.startPlayback();
+        statusLabel.setText ("Playing...", juce::dontSendNotification);
+        updateStatus();
+        return;
+    }
+
     statusLabel.setText ("File loaded. Click Play to start.", juce::dontSendNotification);
     updateStatus();
 }
 
+void MidiFartSnifferEditor::updateFileInfo()
+{
+    const auto& info = audioProcessor.getSongInfo();
+    auto name = audioProcessor.getCurrentFile().getFileName();
+
+    fileNameLabel.setText (name + " (" + juce::String (info.lengthInBars, 1) + " bars, "
+                             + juce::String (info.numNoteOns) + " notes)",
+                           juce::dontSendNotification);
+}
+
 void MidiFartSnifferEditor::updateStatus()
 {
     double tempo = audioProcessor.getCurrentTempo();
-    bool synced = audioProcessor.isSyncedToHost();
+    bool synced = audioProcessor.isSyncedToHost() || audioProcessor.isLockedToHostPosition();
     tempoLabel.setText ("Tempo: " + juce::String (tempo, 1) + " BPM (sync: " + (synced ? "host" : "file") + ")", juce::dontSendNotification);
     statusLabel.setText (audioProcessor.getIsPlaying() ? "Playing" : "Ready", juce::dontSendNotification);
     
@@ -249,6 +509,135 @@ void MidiFartSnifferEditor::toggleFavorite()
     }
 }
 
+void MidiFartSnifferEditor::chooseSampleKit()
+{
+    auto startFolder = audioProcessor.getSampleKitFolder();
+    if (! startFolder.isDirectory())
+        startFolder = juce::File::getSpecialLocation (juce::File::userDocumentsDirectory);
+
+    kitChooser = std::make_unique<juce::FileChooser> ("Choose a sample kit folder", startFolder);
+    kitChooser->launchAsync (juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectDirectories,
+                             [this] (const juce::FileChooser& chooser)
+    {
+        auto folder = chooser.getResult();
+        if (folder == juce::File())
+            return;
+
+        if (! audioProcessor.loadSampleKit (folder))
+            statusLabel.setText ("No samples found in " + folder.getFileName(), juce::dontSendNotification);
+
+        updateKitLabel();
+    });
+}
+
+void MidiFartSnifferEditor::updateKitLabel()
+{
+    auto folder = audioProcessor.getSampleKitFolder();
+    kitLabel.setText (folder == juce::File() ? "Kit: built-in" : "Kit: " + folder.getFileName(),
+                      juce::dontSendNotification);
+}
+
+void MidiFartSnifferEditor::togglePadAssignment()
+{
+    const int padIndex = padBox.getSelectedId() - 1;
+    auto currentFile = audioProcessor.getCurrentFile();
+
+    if (currentFile.existsAsFile() && audioProcessor.getPatternFile (padIndex) == currentFile)
+        audioProcessor.clearPattern (padIndex);
+    else if (! audioProcessor.assignPattern (padIndex, currentFile))
+        statusLabel.setText ("Load a MIDI file to assign it to a pad", juce::dontSendNotification);
+
+    updatePadControls();
+}
+
+void MidiFartSnifferEditor::updatePadControls()
+{
+    const int padIndex = padBox.getSelectedId() - 1;
+    auto padFile = audioProcessor.getPatternFile (padIndex);
+    auto currentFile = audioProcessor.getCurrentFile();
+
+    assignPadButton.setButtonText (currentFile.existsAsFile() && padFile == currentFile ? "Clear Pad" : "Assign to Pad");
+
+    const int numAssigned = audioProcessor.getNumAssignedPatterns();
+    juce::String text = "Pad " + juce::String (padIndex + 1) + ": "
+                          + (padFile == juce::File() ? juce::String ("empty") : padFile.getFileName());
+
+    if (numAssigned > 0)
+        text << " (" << numAssigned << " assigned, " << audioProcessor.getNumPlayingPatterns() << " playing)";
+
+    padsLabel.setText (text, juce::dontSendNotification);
+}
+
+void MidiFartSnifferEditor::updateOutputLabel()
+{
+    const auto coalesced = audioProcessor.getNumCoalescedEvents();
+    const auto dropped = audioProcessor.getNumDroppedEvents();
+
+    juce::String text = "MIDI out: " + juce::String (audioProcessor.getReservedOutputBytes() / 1024) + " KB per source, ";
+
+    if (coalesced == 0 && dropped == 0)
+        text << "nothing thinned";
+    else
+        text << juce::String (coalesced) << " coalesced, " << juce::String (dropped) << " dropped";
+
+    outputLabel.setText (text, juce::dontSendNotification);
+}
+
+void MidiFartSnifferEditor::updateLibraryLabel()
+{
+    auto& indexer = audioProcessor.getLibraryIndexer();
+    const auto root = indexer.getRoot();
+    auto index = indexer.getIndex();
+
+    juce::String text;
+
+    if (root == juce::File())
+        text = "Library: none";
+    else if (indexer.isIndexing())
+        text << "Library: indexing " << juce::String (indexer.getProgress().numDone.load())
+             << " of " << juce::String (indexer.getProgress().numFound.load()) << " files";
+    else if (index != nullptr && index->getRoot() == root)
+        text << "Library: " << juce::String (index->getNumEntries()) << " files in " << root.getFileName()
+             << (indexer.isWatching() ? " (live)" : "");
+    else
+        text << "Library: " << root.getFileName();
+
+    libraryLabel.setText (text, juce::dontSendNotification);
+}
+
+void MidiFartSnifferEditor::toggleLayer()
+{
+    const int slotIndex = layerBox.getSelectedId();
+    auto currentFile = audioProcessor.getCurrentFile();
+
+    if (audioProcessor.getLayerFile (slotIndex) != juce::File()
+        && (! currentFile.existsAsFile() || audioProcessor.getLayerFile (slotIndex) == currentFile))
+        audioProcessor.clearLayer (slotIndex);
+    else if (! audioProcessor.loadLayer (slotIndex, currentFile))
+        statusLabel.setText ("Load a MIDI file to layer it", juce::dontSendNotification);
+
+    updateLayerControls();
+}
+
+void MidiFartSnifferEditor::updateLayerControls()
+{
+    const int slotIndex = layerBox.getSelectedId();
+    auto layerFile = audioProcessor.getLayerFile (slotIndex);
+    auto currentFile = audioProcessor.getCurrentFile();
+
+    const bool clears = layerFile != juce::File() && (! currentFile.existsAsFile() || layerFile == currentFile);
+    layerButton.setButtonText (clears ? "Clear Layer" : "Set Layer");
+
+    layerMuteButton.setToggleState (audioProcessor.isSlotMuted (slotIndex), juce::dontSendNotification);
+    layerLoopButton.setToggleState (audioProcessor.isSlotLooping (slotIndex), juce::dontSendNotification);
+    layerSyncButton.setToggleState (audioProcessor.doesSlotFollowHostTempo (slotIndex), juce::dontSendNotification);
+    layerChannelBox.setSelectedId (audioProcessor.getSlotOutputChannel (slotIndex) + 1, juce::dontSendNotification);
+
+    layerLabel.setText ("Layer " + juce::String (slotIndex) + ": "
+                          + (layerFile == juce::File() ? juce::String ("empty") : layerFile.getFileName()),
+                        juce::dontSendNotification);
+}
+
 // ListBoxModel methods
 int MidiFartSnifferEditor::getNumRows()
 {
@@ -289,14 +678,9 @@ void MidiFartSnifferEditor::listBoxItemClicked (int row, const juce::MouseEvent&
             }
             else
             {
-                // Load and play the favorite file
-                loadSelectedFile (file);
+                // Load the favorite file and always start playback once it is ready
+                loadSelectedFile (file, true);
                 lastClickedFile = file;
-                
-                // Always start playback when clicking a favorite
-                audioProcessor.startPlayback();
-                statusLabel.setText ("Playing...", juce::dontSendNotification);
-                updateStatus();
             }
         }
     }
@@ -2,10 +2,11 @@
 
 #include <juce_gui_basics/juce_gui_basics.h>
 #include <juce_gui_extra/juce_gui_extra.h>
+#include "FolderBrowser.h"
+#include "LibrarySearchPanel.h"
 #include "PluginProcessor.h"
 
 class MidiFartSnifferEditor final : public juce::AudioProcessorEditor,
-                                   private juce::FileBrowserListener,
                                    private juce::Timer,
                                    private juce::ListBoxModel
 {
@@ -21,17 +22,27 @@ public:
 
 private:
     //==============================================================================
-    // FileBrowserListener callbacks
-    void selectionChanged() override;
-    void fileClicked (const juce::File& file, const juce::MouseEvent&) override;
-    void fileDoubleClicked (const juce::File&) override;
-    void browserRootChanged (const juce::File&) override {}
+    // Browser and search callbacks
+    void fileClicked (const juce::File& file, const juce::MouseEvent&);
+    void fileDoubleClicked (const juce::File&);
 
     // Custom methods
-    void loadSelectedFile (const juce::File& file);
+    void fileSelected (const juce::File& file);
+    void loadSelectedFile (const juce::File& file, bool playWhenLoaded = false);
+    void showFileMenu (const juce::File& file);
+    void fileLoaded (bool loaded, bool playWhenLoaded);
     void updateStatus();
+    void updateFileInfo();
     void updateFavoritesList();
     void toggleFavorite();
+    void chooseSampleKit();
+    void updateKitLabel();
+    void togglePadAssignment();
+    void toggleLayer();
+    void updateLayerControls();
+    void updatePadControls();
+    void updateOutputLabel();
+    void updateLibraryLabel();
     
     // ListBoxModel methods
     int getNumRows() override;
@@ -41,15 +52,35 @@ private:
     //==============================================================================
     MidiFartSnifferProcessor& audioProcessor;
 
-    std::unique_ptr<juce::WildcardFileFilter> wildCardFilter;
-    std::unique_ptr<juce::FileBrowserComponent> fileBrowser;
+    FolderBrowser folderBrowser { juce::File::getSpecialLocation (juce::File::userDocumentsDirectory), "mid;midi" };
+    LibrarySearchPanel searchPanel;
+    juce::TabbedComponent browserTabs { juce::TabbedButtonBar::TabsAtTop };
 
     juce::TextButton playButton { "Play" };
     juce::TextButton stopButton { "Stop" };
     juce::ToggleButton loopButton { "Loop" };
     juce::ToggleButton syncButton { "Sync to Host" };
+    juce::ToggleButton lockButton { "Lock to Host" };
+    juce::ToggleButton startOnBarButton { "Start on Bar" };
     juce::ToggleButton autoPlayCheckbox { "Auto-play" };
     juce::TextButton favoriteButton { "★ Favorite" };
+    juce::ToggleButton thinningButton { "Thin MIDI" };
+    juce::TextButton loadKitButton { "Load Kit..." };
+    juce::TextButton clearKitButton { "Built-in Kit" };
+    juce::ToggleButton auditionButton { "Audition" };
+    juce::ToggleButton padLaunchButton { "Pad Launch" };
+    juce::ToggleButton retriggerButton { "Retrigger" };
+    juce::ComboBox quantizeBox;
+    juce::ComboBox padBox;
+    juce::TextButton assignPadButton { "Assign to Pad" };
+    juce::ComboBox layerBox;
+    juce::TextButton layerButton { "Set Layer" };
+    juce::ToggleButton layerMuteButton { "Mute" };
+    juce::ComboBox layerChannelBox;
+    juce::ToggleButton layerLoopButton { "Loop" };
+    juce::ToggleButton layerSyncButton { "Host Tempo" };
+    juce::TextButton libraryButton { "Set as Library" };
+    juce::TextButton rescanButton { "Rescan" };
 
     juce::Slider positionSlider { juce::Slider::LinearHorizontal, juce::Slider::NoTextBox };
 
@@ -57,6 +88,13 @@ private:
     juce::Label statusLabel { {}, "Ready" };
     juce::Label tempoLabel { {}, "Tempo: -- BPM" };
     juce::Label favoritesLabel { {}, "Favorites:" };
+    juce::Label kitLabel { {}, "Kit: built-in" };
+    juce::Label padsLabel { {}, "Pads: none assigned" };
+    juce::Label layerLabel { {}, "Layer 1: empty" };
+    juce::Label outputLabel { {}, "MIDI out: nothing thinned" };
+    juce::Label libraryLabel { {}, "Library: none" };
+
+    std::unique_ptr<juce::FileChooser> kitChooser;
     
     juce::ListBox favoritesList;
     juce::StringArray favoritesArray;
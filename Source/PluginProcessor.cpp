@@ -1,6 +1,27 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
+namespace
+{
+    // What a MidiBuffer stores for each event besides the message: its sample position and size
+    constexpr int bytesPerEventHeader = static_cast<int> (sizeof (juce::int32) + sizeof (juce::uint16));
+
+    // Room one source needs for a song: its busiest stretch as long as a block at
+    // the song's fastest tempo or the host's, whichever is faster, twice over so
+    // a loop wrap or seek inside the block still fits.
+    int getOutputBytesForSong (const CompiledSong& song, double sampleRate, int blockSize, double hostTempo)
+    {
+        if (sampleRate <= 0.0)
+            return 0;
+
+        const double tempo = juce::jmax (song.getInfo().maxTempo, hostTempo);
+        const double blockInTicks = blockSize * (tempo / 60.0) * song.getTicksPerQuarterNote() / sampleRate;
+        const auto load = song.getPeakLoad (blockInTicks);
+
+        return 2 * (load.numBytes + load.numEvents * bytesPerEventHeader);
+    }
+}
+
 MidiFartSnifferProcessor::MidiFartSnifferProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
     : AudioProcessor (BusesProperties()
@@ -13,6 +34,16 @@ MidiFartSnifferProcessor::MidiFartSnifferProcessor()
     )
 #endif
 {
+    formatManager.registerBasicFormats();
+    voiceEngine.setStreamer (&sampleStreamer);
+    kitExchange.publish (SampleKit::createPreviewKit());
+
+    // Layers loop by default; the main file does not
+    for (int i = 1; i < numSlots; ++i)
+    {
+        slotSettings[static_cast<size_t> (i)].looping = true;
+        slots[static_cast<size_t> (i)].setLooping (true);
+    }
 }
 
 MidiFartSnifferProcessor::~MidiFartSnifferProcessor()
@@ -21,6 +52,30 @@ MidiFartSnifferProcessor::~MidiFartSnifferProcessor()
 
 void MidiFartSnifferProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
+    for (auto& slot : slots)
+        slot.prepare (sampleRate);
+
+    // Room for the densest block of what is loaded, so rendering does not have to
+    // grow the buffers; files loaded later reserve more from the message thread
+    {
+        const juce::ScopedLock sl (outputSizingLock);
+        preparedSampleRate = sampleRate;
+        preparedBlockSize = samplesPerBlock;
+        outputBudget = getOutputBytesNeeded();
+        reservedOutputBytes = outputBudget;
+    }
+
+    for (auto& output : slotOutputs)
+        output.ensureSize (static_cast<size_t> (outputBudget));
+
+    patternOutput.ensureSize (static_cast<size_t> (outputBudget));
+    hostInput.ensureSize (static_cast<size_t> (getHostBufferBytes (outputBudget)));
+    spareHostStorage.ensureSize (static_cast<size_t> (getHostBufferBytes (outputBudget)));
+    hostStoragePending = true;
+
+    voiceEngine.prepare (sampleRate);
+    patternLauncher.prepare (sampleRate);
+    launcherBeat = 0.0;
     currentTick = 0;
 }
 
@@ -67,63 +122,403 @@ void MidiFartSnifferProcessor::processBlock (juce::AudioBuffer<float>& buffer, j
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
+    // Every source renders into its own buffer; they are merged at the end
+    for (auto& output : slotOutputs)
+        output.clear();
+
+    patternOutput.clear();
+    hostInput.clear();
+    takeOverOutputStorage();
+
+    // With pad launching on, incoming MIDI triggers the pads and goes no further;
+    // otherwise it is set aside and merged into the output with everything else
+    const bool launching = patternLaunchEnabled;
+
+    if (launching)
+        handlePadInput (midiMessages);
+    else
+        hostInput.swapWith (midiMessages);
+
+    midiMessages.clear();
+
+    // The host's buffer trades storage with hostInput every block. After a resize its
+    // own storage is swapped out for reserved room, with any input still in it, and
+    // parked until the next handover frees it on the message thread.
+    if (hostStoragePending)
+    {
+        auto& hostStorage = launching ? midiMessages : hostInput;
+        spareHostStorage.clear();
+        spareHostStorage.addEvents (hostStorage, 0, -1, 0);
+        hostStorage.swapWith (spareHostStorage);
+        hostStoragePending = false;
+    }
+
+    const bool thin = thinningEnabled;
+    patternLauncher.setOutputBudget (outputBudget, thin);
+
+    for (int i = 0; i < numSlots; ++i)
+    {
+        auto& slot = slots[static_cast<size_t> (i)];
+        slot.setOutputBudget (outputBudget);
+        slot.setThinningEnabled (thin);
+
+        // Controller values held back last block go out first
+        slot.flushHeldControllers (slotOutputs[static_cast<size_t> (i)]);
+    }
+
+    // Pick up newly loaded files. The old songs are retired, not freed, here.
+    for (int i = 0; i < numSlots; ++i)
+    {
+        if (! songExchanges[static_cast<size_t> (i)].pullPending())
+            continue;
+
+        auto& slot = slots[static_cast<size_t> (i)];
+        auto* song = songExchanges[static_cast<size_t> (i)].getActive();
+        slot.setSong (song, slotOutputs[static_cast<size_t> (i)], 0);
+
+        if (i == 0)
+        {
+            lengthInTicks = song != nullptr ? song->getLengthInTicks() : 0;
+            fileTempoAtPosition = song != nullptr ? song->getInitialTempo() : 120.0;
+        }
+        else if (transport.isPlaying)
+        {
+            // A layer added during playback joins in step with the main song
+            slot.seekToQuarterNote (slots[0].getPositionInQuarterNotes());
+        }
+    }
+
+    // Settings from the message thread first, then play/stop/seek in order
+    applySettings();
+    transportCommands.drain ([this] (const TransportCommand& command) { applyTransportCommand (command); });
+
+    if (patternExchange.pullPending())
+        patternLauncher.setBank (patternExchange.getActive(), patternOutput, 0);
+
+    updateHostPosition();
+
     // Playback logic
-    if (isPlaying && ! midiTracks.empty())
+    const bool hasSongs = std::any_of (slots.begin(), slots.end(), [] (const PlaybackSlot& slot) { return ! slot.isEmpty(); });
+
+    if (transport.isPlaying && hasSongs)
     {
-        updateHostTempo();
+        const int numSamples = buffer.getNumSamples();
 
-        double tempo = getCurrentTempo();
-        double sampleRate = getSampleRate();
-        if (sampleRate > 0.0)
+        if (transport.lockToHostPosition && hostPosition.hasPpqPosition)
         {
-            double secondsPerBeat = 60.0 / tempo;
-            double samplesPerBeat = secondsPerBeat * sampleRate;
-            double ticksPerBeat = ticksPerQuarterNote;
-            samplesPerTick = samplesPerBeat / ticksPerBeat;
+            // Follow the host transport; nothing plays while it is stopped
+            if (hostPosition.isPlaying)
+                renderHostLocked (numSamples);
+            else
+                releaseAllSlots();
         }
+        else
+        {
+            bool anySlotPlaying = false;
 
-        int numSamples = buffer.getNumSamples();
-        int64_t ticksToAdvance = static_cast<int64_t> (numSamples / samplesPerTick + 0.5); // round to nearest
+            for (int i = 0; i < numSlots; ++i)
+            {
+                auto& slot = slots[static_cast<size_t> (i)];
+                slot.render (hostTempo, slotOutputs[static_cast<size_t> (i)], 0, numSamples);
+                anySlotPlaying = anySlotPlaying || (! slot.isEmpty() && ! slot.hasFinished());
+            }
+
+            if (! anySlotPlaying)
+                transport.isPlaying = false;
+        }
 
-        int64_t startTick = currentTick;
-        int64_t endTick = currentTick + ticksToAdvance;
+        // The position shown is the main song's
+        const auto& mainSlot = slots[0];
 
-        // Add events from all tracks
-        for (const auto& track : midiTracks)
+        if (const auto* song = mainSlot.getSong())
         {
-            for (int i = 0; i < track.getNumEvents(); ++i)
+            auto tick = static_cast<int64_t> (mainSlot.getPositionInTicks());
+            currentTick = tick;
+
+            if (mainSlot.getTempoSource() == PlaybackSlot::TempoSource::file)
+                fileTempoAtPosition = song->getTempoMap().getTempoAtTick (static_cast<double> (tick));
+        }
+    }
+
+    playingState = transport.isPlaying;
+
+    renderPatterns (buffer.getNumSamples());
+    mergeOutputs (midiMessages);
+    publishOutputCounters();
+
+    // Voice the kit from the notes emitted this block
+    if (kitExchange.pullPending())
+        voiceEngine.setKit (kitExchange.getActive());
+
+    if (auditionEnabled)
+        voiceEngine.renderNextBlock (buffer, midiMessages);
+    else
+        voiceEngine.allNotesOff();
+
+    activeVoices = voiceEngine.getNumActiveVoices();
+}
+
+void MidiFartSnifferProcessor::applySettings()
+{
+    // Each slot only acts on a value that differs from the one it has
+    for (int i = 0; i < numSlots; ++i)
+    {
+        const auto& settings = slotSettings[static_cast<size_t> (i)];
+        auto& slot = slots[static_cast<size_t> (i)];
+        auto& slotOutput = slotOutputs[static_cast<size_t> (i)];
+
+        slot.setLooping (settings.looping);
+        slot.setTempoSource (settings.followsHostTempo ? PlaybackSlot::TempoSource::host : PlaybackSlot::TempoSource::file);
+        slot.setMuted (settings.muted, slotOutput, 0);
+        slot.setOutputChannel (settings.outputChannel, slotOutput, 0);
+    }
+
+    transport.lockToHostPosition = lockToHostSetting;
+    transport.startOnNextBar = startOnNextBarSetting;
+}
+
+void MidiFartSnifferProcessor::applyTransportCommand (const TransportCommand& command)
+{
+    // Anything that moves or stops the playhead ends the notes still sounding
+    releaseAllSlots();
+
+    switch (command.type)
+    {
+        case TransportCommand::Type::play:
+            for (auto& s : slots)
+                s.start();
+
+            hostStartPending = true;
+            transport.isPlaying = true;
+            currentTick = 0;
+            break;
+
+        case TransportCommand::Type::stop:
+            transport.isPlaying = false;
+            patternLauncher.stopAll (patternOutput, 0);
+            voiceEngine.releaseAllVoices();
+            break;
+
+        case TransportCommand::Type::seek:
+        {
+            // The position is in the main song's ticks; the layers go to the same beat
+            const auto* mainSong = slots[0].getSong();
+            const double quarterNote = juce::jmax (0.0, command.value) / (mainSong != nullptr ? mainSong->getTicksPerQuarterNote() : 480.0);
+
+            for (auto& s : slots)
+                s.seekToQuarterNote (quarterNote);
+
+            currentTick = static_cast<int64_t> (slots[0].getPositionInTicks());
+            break;
+        }
+    }
+}
+
+void MidiFartSnifferProcessor::releaseAllSlots()
+{
+    for (int i = 0; i < numSlots; ++i)
+        slots[static_cast<size_t> (i)].releaseActiveNotes (slotOutputs[static_cast<size_t> (i)], 0);
+}
+
+void MidiFartSnifferProcessor::mergeOutputs (juce::MidiBuffer& midiMessages)
+{
+    // Each source is already in time order, so taking the earliest head each
+    // time keeps the output sorted and only ever appends to it. Ties go to the
+    // lower slot, then the patterns, and the host's own MIDI comes last.
+    std::array<juce::MidiBufferIterator, numOutputSources + 1> heads, ends;
+
+    for (int i = 0; i < numSlots; ++i)
+    {
+        heads[static_cast<size_t> (i)] = slotOutputs[static_cast<size_t> (i)].cbegin();
+        ends[static_cast<size_t> (i)] = slotOutputs[static_cast<size_t> (i)].cend();
+    }
+
+    heads[numSlots] = patternOutput.cbegin();
+    ends[numSlots] = patternOutput.cend();
+
+    heads[numOutputSources] = hostInput.cbegin();
+    ends[numOutputSources] = hostInput.cend();
+
+    for (;;)
+    {
+        int next = -1;
+        int nextPosition = 0;
+
+        for (int i = 0; i <= numOutputSources; ++i)
+        {
+            const auto& head = heads[static_cast<size_t> (i)];
+
+            if (head != ends[static_cast<size_t> (i)] && (next < 0 || (*head).samplePosition < nextPosition))
             {
-                auto* event = track.getEventPointer (i);
-                if (event == nullptr)
-                    continue;
+                next = i;
+                nextPosition = (*head).samplePosition;
+            }
+        }
 
-                int64_t eventTick = static_cast<int64_t> (event->message.getTimeStamp());
-                if (eventTick >= startTick && eventTick < endTick)
-                {
-                    int sampleOffset = static_cast<int> ((eventTick - startTick) * samplesPerTick + 0.5);
-                    if (sampleOffset >= 0 && sampleOffset < numSamples)
-                    {
-                        midiMessages.addEvent (event->message, sampleOffset);
-                    }
-                }
-                else if (eventTick >= endTick)
-                {
-                    break;
-                }
+        if (next < 0)
+            break;
+
+        const auto metadata = *heads[static_cast<size_t> (next)];
+        midiMessages.addEvent (metadata.data, metadata.numBytes, metadata.samplePosition);
+        ++heads[static_cast<size_t> (next)];
+    }
+}
+
+void MidiFartSnifferProcessor::takeOverOutputStorage()
+{
+    if (! outputStorageExchange.pullPending())
+        return;
+
+    // prepareToPlay may already have reserved more than a storage published before it
+    auto* storage = outputStorageExchange.getActive();
+    if (storage == nullptr || storage->getBytesPerBuffer() <= outputBudget)
+        return;
+
+    for (int i = 0; i < numSlots; ++i)
+        storage->swapInto (i, slotOutputs[static_cast<size_t> (i)]);
+
+    storage->swapInto (numSlots, patternOutput);
+    storage->swapIntoHostBuffer (0, hostInput);
+    storage->swapIntoHostBuffer (1, spareHostStorage);
+    hostStoragePending = true;
+    outputBudget = storage->getBytesPerBuffer();
+}
+
+void MidiFartSnifferProcessor::publishOutputCounters()
+{
+    int64_t dropped = patternLauncher.getNumDroppedEvents();
+    int64_t coalesced = patternLauncher.getNumCoalescedEvents();
+
+    for (const auto& slot : slots)
+    {
+        dropped += slot.getNumDroppedEvents();
+        coalesced += slot.getNumCoalescedEvents();
+    }
+
+    droppedEvents = dropped;
+    coalescedEvents = coalesced;
+}
+
+void MidiFartSnifferProcessor::handlePadInput (const juce::MidiBuffer& midiMessages)
+{
+    patternLauncher.setQuantization (launchQuantization);
+    patternLauncher.setRetriggerOnRelaunch (retriggerOnRelaunch);
+
+    for (const auto metadata : midiMessages)
+    {
+        const auto* data = metadata.data;
+
+        if (metadata.numBytes == 3 && (data[0] & 0xf0) == 0x90 && data[2] != 0)
+        {
+            const int padIndex = PatternBank::getPadForNote (data[1]);
+            if (padIndex >= 0)
+                patternLauncher.padPressed (padIndex, metadata.samplePosition);
+        }
+    }
+}
+
+void MidiFartSnifferProcessor::renderPatterns (int numSamples)
+{
+    if (! patternLaunchEnabled)
+    {
+        patternLauncher.stopAll (patternOutput, 0);
+        playingPatterns = 0;
+        return;
+    }
+
+    // Patterns play at the tempo the main song would
+    PatternLauncher::Grid grid;
+    grid.tempo = (slots[0].getTempoSource() == PlaybackSlot::TempoSource::host || transport.lockToHostPosition)
+                   ? hostTempo.load() : fileTempoAtPosition.load();
+    grid.barLengthInBeats = hostPosition.barLengthInQuarterNotes;
+
+    // Launch on the host's beats and bars while its transport runs, and on our
+    // own count, carried on from there, while it is stopped
+    if (hostPosition.isPlaying && hostPosition.hasPpqPosition)
+    {
+        launcherBeat = hostPosition.ppqPosition;
+        grid.barStartPosition = hostPosition.ppqOfLastBarStart;
+    }
+    else
+    {
+        grid.barStartPosition = std::floor (launcherBeat / grid.barLengthInBeats) * grid.barLengthInBeats;
+    }
+
+    grid.beatPosition = launcherBeat;
+    patternLauncher.renderBlock (grid, numSamples, patternOutput);
+
+    if (grid.tempo > 0.0 && getSampleRate() > 0.0)
+        launcherBeat += numSamples / ((60.0 / grid.tempo) * getSampleRate());
+
+    playingPatterns = patternLauncher.getNumPlaying();
+}
+
+void MidiFartSnifferProcessor::renderHostLocked (int numSamples)
+{
+    const auto& host = hostPosition;
+
+    const double tempo = hostTempo;
+
+    if (tempo <= 0.0 || getSampleRate() <= 0.0)
+        return;
+
+    const double samplesPerQuarterNote = (60.0 / tempo) * getSampleRate();
+
+    // Tick 0 of the songs goes on a bar line: the current bar, or the next one if
+    // playback was asked to wait for it
+    if (hostStartPending)
+    {
+        const double barStart = host.ppqOfLastBarStart;
+        const bool onBarLine = std::abs (host.ppqPosition - barStart) < 1.0e-6;
+        hostAnchorPpq = (transport.startOnNextBar && ! onBarLine) ? barStart + host.barLengthInQuarterNotes : barStart;
+        hostStartPending = false;
+    }
+
+    const bool hostLoopActive = host.isLooping && host.loopEndPpq > host.loopStartPpq;
+
+    double ppq = host.ppqPosition;
+    int offset = 0;
+
+    while (offset < numSamples)
+    {
+        int length = numSamples - offset;
+        bool reachesLoopEnd = false;
+
+        // Split the block where the host's own loop jumps back
+        if (hostLoopActive && ppq < host.loopEndPpq)
+        {
+            const int samplesToLoopEnd = juce::jmax (1, static_cast<int> (std::ceil ((host.loopEndPpq - ppq) * samplesPerQuarterNote)));
+
+            if (samplesToLoopEnd <= length)
+            {
+                length = samplesToLoopEnd;
+                reachesLoopEnd = true;
             }
         }
 
-        currentTick += ticksToAdvance;
+        double quarterNotesFromAnchor = ppq - hostAnchorPpq;
+        int segmentOffset = offset;
+        int segmentLength = length;
 
-        // Check if end reached
-        int64_t maxTick = getMaxTick();
-        if (currentTick >= maxTick)
+        // Before the anchor bar there is nothing to play yet
+        if (quarterNotesFromAnchor < 0.0)
         {
-            if (shouldLoop)
-                currentTick = 0;
-            else
-                isPlaying = false;
+            const int samplesToAnchor = static_cast<int> (std::ceil (-quarterNotesFromAnchor * samplesPerQuarterNote));
+            segmentOffset += samplesToAnchor;
+            segmentLength -= samplesToAnchor;
+            quarterNotesFromAnchor = 0.0;
         }
+
+        if (segmentLength > 0)
+            for (int i = 0; i < numSlots; ++i)
+                slots[static_cast<size_t> (i)].renderLocked (quarterNotesFromAnchor, tempo, slotOutputs[static_cast<size_t> (i)],
+                                                             segmentOffset, segmentLength);
+
+        offset += length;
+        ppq += length / samplesPerQuarterNote;
+
+        if (reachesLoopEnd)
+            ppq = host.loopStartPpq + (ppq - host.loopEndPpq);
     }
 }
 
@@ -137,7 +532,44 @@ void MidiFartSnifferProcessor::getStateInformation (juce::MemoryBlock& destData)
     // Create XML to store state
     std::unique_ptr<juce::XmlElement> xml (new juce::XmlElement ("MidiFartSnifferState"));
     
-    xml->setAttribute ("autoPlay", autoPlayEnabled);
+    xml->setAttribute ("autoPlay", autoPlayEnabled.load());
+    xml->setAttribute ("lockToHost", lockToHostSetting.load());
+    xml->setAttribute ("startOnNextBar", startOnNextBarSetting.load());
+    xml->setAttribute ("sampleKit", kitFolder.getFullPathName());
+    xml->setAttribute ("audition", auditionEnabled.load());
+    xml->setAttribute ("patternLaunch", patternLaunchEnabled.load());
+    xml->setAttribute ("launchQuantization", launchQuantization == PatternLauncher::Quantization::beat ? "beat" : "bar");
+    xml->setAttribute ("retrigger", retriggerOnRelaunch.load());
+    xml->setAttribute ("thinning", thinningEnabled.load());
+    xml->setAttribute ("libraryFolder", libraryIndexer.getRoot().getFullPathName());
+
+    auto* layersElement = xml->createNewChildElement ("Layers");
+    for (int i = 1; i < numSlots; ++i)
+    {
+        const auto& settings = slotSettings[static_cast<size_t> (i)];
+        if (settings.file == juce::File())
+            continue;
+
+        auto* layerElement = layersElement->createNewChildElement ("Layer");
+        layerElement->setAttribute ("slot", i);
+        layerElement->setAttribute ("path", settings.file.getFullPathName());
+        layerElement->setAttribute ("loop", settings.looping.load());
+        layerElement->setAttribute ("hostTempo", settings.followsHostTempo.load());
+        layerElement->setAttribute ("muted", settings.muted.load());
+        layerElement->setAttribute ("channel", settings.outputChannel.load());
+    }
+
+    auto* patternsElement = xml->createNewChildElement ("Patterns");
+    for (int i = 0; i < PatternBank::numPads; ++i)
+    {
+        const auto& pad = patternBank->getPad (i);
+        if (pad.pattern == nullptr)
+            continue;
+
+        auto* padElement = patternsElement->createNewChildElement ("Pad");
+        padElement->setAttribute ("index", i);
+        padElement->setAttribute ("path", pad.file.getFullPathName());
+    }
     
     // Save favorites
     auto* favoritesElement = xml->createNewChildElement ("Favorites");
@@ -159,6 +591,65 @@ void MidiFartSnifferProcessor::setStateInformation (const void* data, int sizeIn
         if (xmlState->hasTagName ("MidiFartSnifferState"))
         {
             autoPlayEnabled = xmlState->getBoolAttribute ("autoPlay", false);
+            setLockToHostPosition (xmlState->getBoolAttribute ("lockToHost", false));
+            setStartOnNextBar (xmlState->getBoolAttribute ("startOnNextBar", false));
+
+            auditionEnabled = xmlState->getBoolAttribute ("audition", true);
+
+            auto kitPath = xmlState->getStringAttribute ("sampleKit");
+            if (juce::File::isAbsolutePath (kitPath))
+                loadSampleKit (juce::File (kitPath));
+            else
+                unloadSampleKit();
+
+            patternLaunchEnabled = xmlState->getBoolAttribute ("patternLaunch", false);
+            launchQuantization = xmlState->getStringAttribute ("launchQuantization") == "beat" ? PatternLauncher::Quantization::beat
+                                                                                                  : PatternLauncher::Quantization::bar;
+            retriggerOnRelaunch = xmlState->getBoolAttribute ("retrigger", false);
+            thinningEnabled = xmlState->getBoolAttribute ("thinning", false);
+
+            auto libraryPath = xmlState->getStringAttribute ("libraryFolder");
+            setLibraryFolder (juce::File::isAbsolutePath (libraryPath) ? juce::File (libraryPath) : juce::File());
+
+            for (int i = 1; i < numSlots; ++i)
+                clearLayer (i);
+
+            if (auto* layersElement = xmlState->getChildByName ("Layers"))
+            {
+                for (auto* layerElement : layersElement->getChildWithTagNameIterator ("Layer"))
+                {
+                    const int slotIndex = layerElement->getIntAttribute ("slot", -1);
+                    const auto path = layerElement->getStringAttribute ("path");
+
+                    if (! juce::File::isAbsolutePath (path) || ! loadLayer (slotIndex, juce::File (path)))
+                        continue;
+
+                    setSlotLooping (slotIndex, layerElement->getBoolAttribute ("loop", true));
+                    setSlotFollowsHostTempo (slotIndex, layerElement->getBoolAttribute ("hostTempo", true));
+                    setSlotMuted (slotIndex, layerElement->getBoolAttribute ("muted", false));
+                    setSlotOutputChannel (slotIndex, layerElement->getIntAttribute ("channel", 0));
+                }
+            }
+
+            // Compile every pattern now so launching never has to
+            PatternBank::Ptr bank (new PatternBank());
+            if (auto* patternsElement = xmlState->getChildByName ("Patterns"))
+            {
+                for (auto* padElement : patternsElement->getChildWithTagNameIterator ("Pad"))
+                {
+                    const int padIndex = padElement->getIntAttribute ("index", -1);
+                    const auto path = padElement->getStringAttribute ("path");
+
+                    if (! juce::isPositiveAndBelow (padIndex, PatternBank::numPads) || ! juce::File::isAbsolutePath (path))
+                        continue;
+
+                    const juce::File file (path);
+                    if (auto pattern = fileLoader.getOrLoad (file))
+                        bank = bank->withPattern (padIndex, file, std::move (pattern));
+                }
+            }
+
+            setPatternBank (std::move (bank));
             
             // Restore favorites
             favoriteFiles.clear();
@@ -177,8 +668,12 @@ void MidiFartSnifferProcessor::setStateInformation (const void* data, int sizeIn
     }
 }
 
-void MidiFartSnifferProcessor::updateHostTempo()
+void MidiFartSnifferProcessor::updateHostPosition()
 {
+    hostPosition.hasPpqPosition = false;
+    hostPosition.isPlaying = false;
+    hostPosition.isLooping = false;
+
     if (auto* playHead = getPlayHead())
     {
         auto pos = playHead->getPosition();
@@ -190,88 +685,332 @@ void MidiFartSnifferProcessor::updateHostTempo()
             {
                 hostTempo = *bpm;
             }
+
+            hostPosition.isPlaying = pos->getIsPlaying();
+
+            auto ppq = pos->getPpqPosition();
+            if (ppq.hasValue())
+            {
+                hostPosition.hasPpqPosition = true;
+                hostPosition.ppqPosition = *ppq;
+
+                auto timeSig = pos->getTimeSignature();
+                if (timeSig.hasValue() && timeSig->denominator > 0)
+                    hostPosition.barLengthInQuarterNotes = timeSig->numerator * 4.0 / timeSig->denominator;
+
+                auto barStart = pos->getPpqPositionOfLastBarStart();
+                if (barStart.hasValue())
+                    hostPosition.ppqOfLastBarStart = *barStart;
+                else
+                    hostPosition.ppqOfLastBarStart = std::floor (*ppq / hostPosition.barLengthInQuarterNotes)
+                                                       * hostPosition.barLengthInQuarterNotes;
+            }
+
+            auto loop = pos->getLoopPoints();
+            if (loop.hasValue() && pos->getIsLooping())
+            {
+                hostPosition.isLooping = true;
+                hostPosition.loopStartPpq = loop->ppqStart;
+                hostPosition.loopEndPpq = loop->ppqEnd;
+            }
         }
     }
 }
 
 double MidiFartSnifferProcessor::getCurrentTempo() const
 {
-    return syncToHost ? hostTempo : fileTempo;
+    return (isSyncedToHost() || lockToHostSetting) ? hostTempo.load() : fileTempoAtPosition.load();
 }
 
 void MidiFartSnifferProcessor::setSyncToHost (bool shouldSync)
 {
-    syncToHost = shouldSync;
+    setSlotFollowsHostTempo (0, shouldSync);
+}
+
+void MidiFartSnifferProcessor::setLockToHostPosition (bool shouldLock)
+{
+    lockToHostSetting = shouldLock;
+}
+
+void MidiFartSnifferProcessor::setStartOnNextBar (bool shouldWait)
+{
+    startOnNextBarSetting = shouldWait;
 }
 
 void MidiFartSnifferProcessor::loadMidiFile (const juce::File& file)
 {
-    currentFile = file;  // Store current file
-    currentMidiFile = std::make_unique<juce::MidiFile>();
-    
-    juce::FileInputStream fileStream (file);
-    if (! fileStream.openedOk() || ! currentMidiFile->readFrom (fileStream))
+    applyLoadedSong (file, fileLoader.getOrLoad (file));
+}
+
+void MidiFartSnifferProcessor::loadMidiFileAsync (const juce::File& file, std::function<void (bool)> onLoaded)
+{
+    fileLoader.loadAsync (file, [this, onLoaded] (const juce::File& loadedFile, CompiledSong::Ptr song)
     {
-        currentMidiFile.reset();
-        DBG ("Failed to load MIDI file: " + file.getFullPathName());
+        bool loaded = applyLoadedSong (loadedFile, std::move (song));
+
+        if (onLoaded != nullptr)
+            onLoaded (loaded);
+    });
+}
+
+bool MidiFartSnifferProcessor::applyLoadedSong (const juce::File& file, CompiledSong::Ptr song)
+{
+    currentFile = file;  // Store current file
+
+    if (song == nullptr)
+        return false;
+
+    songInfo = song->getInfo();
+    fileTempo = songInfo.initialTempo;
+    int numTracks = songInfo.numTracks;
+
+    // The song is fully built here; the audio thread swaps it in at its next block
+    setSlotSong (0, std::move (song));
+
+    DBG ("Loaded MIDI file with " + juce::String (numTracks) + " tracks, tempo " + juce::String (fileTempo));
+    return true;
+}
+
+bool MidiFartSnifferProcessor::assignPattern (int padIndex, const juce::File& file)
+{
+    if (! juce::isPositiveAndBelow (padIndex, PatternBank::numPads))
+        return false;
+
+    auto pattern = fileLoader.getOrLoad (file);
+    if (pattern == nullptr)
+        return false;
+
+    setPatternBank (patternBank->withPattern (padIndex, file, std::move (pattern)));
+    return true;
+}
+
+void MidiFartSnifferProcessor::clearPattern (int padIndex)
+{
+    if (! juce::isPositiveAndBelow (padIndex, PatternBank::numPads))
         return;
-    }
 
-    // Get tempo from MIDI file - scan for tempo events
-    fileTempo = 120.0; // Default tempo
-    short timeFormat = currentMidiFile->getTimeFormat();
-    if (timeFormat > 0)
-        ticksPerQuarterNote = static_cast<double> (timeFormat);
-    else
-        ticksPerQuarterNote = 480.0; // Default PPQN
-    
-    // Try to find tempo from MIDI events
-    for (int trackIndex = 0; trackIndex < currentMidiFile->getNumTracks(); ++trackIndex)
+    setPatternBank (patternBank->withPattern (padIndex, {}, nullptr));
+}
+
+juce::File MidiFartSnifferProcessor::getPatternFile (int padIndex) const
+{
+    return juce::isPositiveAndBelow (padIndex, PatternBank::numPads) ? patternBank->getPad (padIndex).file : juce::File();
+}
+
+void MidiFartSnifferProcessor::setSlotSong (int slotIndex, CompiledSong::Ptr song)
+{
     {
-        const juce::MidiMessageSequence* track = currentMidiFile->getTrack (trackIndex);
-        for (int i = 0; i < track->getNumEvents(); ++i)
-        {
-            const juce::MidiMessage& msg = track->getEventPointer (i)->message;
-            if (msg.isTempoMetaEvent())
-            {
-                fileTempo = msg.getTempoSecondsPerQuarterNote() > 0.0 
-                    ? 60.0 / msg.getTempoSecondsPerQuarterNote() 
-                    : 120.0;
-                break; // Use first tempo found
-            }
-        }
-        if (fileTempo != 120.0) break;
+        const juce::ScopedLock sl (outputSizingLock);
+        slotSongs[static_cast<size_t> (slotIndex)] = song;
     }
 
-    int numTracks = currentMidiFile->getNumTracks();
-    midiTracks.resize (numTracks);
-    for (int i = 0; i < numTracks; ++i)
+    songExchanges[static_cast<size_t> (slotIndex)].publish (std::move (song));
+    updateOutputReservation();
+}
+
+void MidiFartSnifferProcessor::setPatternBank (PatternBank::Ptr bank)
+{
     {
-        midiTracks[i] = *currentMidiFile->getTrack (i);
+        const juce::ScopedLock sl (outputSizingLock);
+        patternBank = bank;
     }
 
-    DBG ("Loaded MIDI file with " + juce::String (numTracks) + " tracks, tempo " + juce::String (fileTempo));
+    patternExchange.publish (std::move (bank));
+    updateOutputReservation();
+}
+
+void MidiFartSnifferProcessor::updateOutputReservation()
+{
+    const juce::ScopedLock sl (outputSizingLock);
+    const int numBytes = getOutputBytesNeeded();
+
+    // The buffers never shrink, so only a denser file needs new storage
+    if (numBytes <= reservedOutputBytes)
+        return;
+
+    reservedOutputBytes = numBytes;
+    outputStorageExchange.publish (new MidiOutputStorage (numOutputSources, numBytes, getHostBufferBytes (numBytes)));
+}
+
+int MidiFartSnifferProcessor::getOutputBytesNeeded() const
+{
+    // Called with outputSizingLock held
+    int numBytes = minOutputBufferBytes;
+
+    for (const auto& song : slotSongs)
+        if (song != nullptr)
+            numBytes = juce::jmax (numBytes, getOutputBytesForSong (*song, preparedSampleRate, preparedBlockSize, hostTempo));
+
+    // The pads share one buffer, so their needs add up
+    int patternBytes = 0;
+
+    for (int i = 0; i < PatternBank::numPads; ++i)
+        if (const auto* pattern = patternBank->getPad (i).pattern.get())
+            patternBytes += getOutputBytesForSong (*pattern, preparedSampleRate, preparedBlockSize, hostTempo);
+
+    return juce::jmax (numBytes, patternBytes);
+}
+
+bool MidiFartSnifferProcessor::loadSampleKit (const juce::File& folder)
+{
+    auto kit = SampleKit::loadFromFolder (folder, formatManager, samplePreloadFrames);
+    if (kit == nullptr)
+        return false;
+
+    kitFolder = folder;
+    DBG ("Loaded sample kit with " + juce::String (kit->getNumSamples()) + " samples on "
+           + juce::String (kit->getNumMappedNotes()) + " notes, "
+           + juce::String (static_cast<juce::int64> (kit->getMemoryUsage() / 1024)) + " KB resident");
+
+    // The streamer gets the kit first so its tails are ready when voices start
+    sampleStreamer.setKit (kit);
+    kitExchange.publish (std::move (kit));
+    return true;
+}
+
+void MidiFartSnifferProcessor::unloadSampleKit()
+{
+    kitFolder = juce::File();
+
+    auto kit = SampleKit::createPreviewKit();
+    sampleStreamer.setKit (kit);
+    kitExchange.publish (std::move (kit));
+}
+
+SampleKit::Ptr MidiFartSnifferProcessor::loadOfflineKit()
+{
+    SampleKit::Ptr kit;
+    if (kitFolder != juce::File())
+        kit = OfflineRenderer::loadKit (kitFolder, formatManager);
+
+    if (kit == nullptr)
+        kit = SampleKit::createPreviewKit();
+
+    return kit;
+}
+
+OfflineRenderer::Report MidiFartSnifferProcessor::renderOffline (const juce::File& midiFile, const juce::File& destination,
+                                                                const OfflineRenderer::Options& options, const SampleKit* kit)
+{
+    OfflineRenderer::Report report;
+    auto song = fileLoader.getOrLoad (midiFile);
+
+    if (song == nullptr)
+        report.result = juce::Result::fail ("Could not load " + midiFile.getFullPathName());
+    else if (! destination.hasFileExtension ("wav"))
+        report = OfflineRenderer::renderToMidi (*song, destination, options);
+    else if (kit != nullptr)
+        report = OfflineRenderer::renderToAudio (*song, *kit, destination, options);
+    else
+        report.result = juce::Result::fail ("No kit to render with");
+
+    return report;
 }
 
 void MidiFartSnifferProcessor::startPlayback()
 {
-    isPlaying = true;
-    currentTick = 0;
+    transportCommands.push ({ TransportCommand::Type::play });
 }
 
 void MidiFartSnifferProcessor::stopPlayback()
 {
-    isPlaying = false;
+    transportCommands.push ({ TransportCommand::Type::stop });
+}
+
+void MidiFartSnifferProcessor::seek (double positionInTicks)
+{
+    transportCommands.push ({ TransportCommand::Type::seek, positionInTicks });
 }
 
 void MidiFartSnifferProcessor::setLooping (bool loop)
 {
-    shouldLoop = loop;
+    setSlotLooping (0, loop);
+}
+
+bool MidiFartSnifferProcessor::loadLayer (int slotIndex, const juce::File& file)
+{
+    if (! juce::isPositiveAndBelow (slotIndex - 1, numSlots - 1))
+        return false;
+
+    auto song = fileLoader.getOrLoad (file);
+    if (song == nullptr)
+        return false;
+
+    slotSettings[static_cast<size_t> (slotIndex)].file = file;
+    setSlotSong (slotIndex, std::move (song));
+    return true;
+}
+
+void MidiFartSnifferProcessor::clearLayer (int slotIndex)
+{
+    if (! juce::isPositiveAndBelow (slotIndex - 1, numSlots - 1))
+        return;
+
+    slotSettings[static_cast<size_t> (slotIndex)].file = juce::File();
+    setSlotSong (slotIndex, nullptr);
+}
+
+juce::File MidiFartSnifferProcessor::getLayerFile (int slotIndex) const
+{
+    return juce::isPositiveAndBelow (slotIndex - 1, numSlots - 1) ? slotSettings[static_cast<size_t> (slotIndex)].file : juce::File();
+}
+
+void MidiFartSnifferProcessor::setSlotLooping (int slotIndex, bool loop)
+{
+    if (! juce::isPositiveAndBelow (slotIndex, numSlots))
+        return;
+
+    slotSettings[static_cast<size_t> (slotIndex)].looping = loop;
+}
+
+bool MidiFartSnifferProcessor::isSlotLooping (int slotIndex) const
+{
+    return juce::isPositiveAndBelow (slotIndex, numSlots) && slotSettings[static_cast<size_t> (slotIndex)].looping;
+}
+
+void MidiFartSnifferProcessor::setSlotFollowsHostTempo (int slotIndex, bool followHost)
+{
+    if (! juce::isPositiveAndBelow (slotIndex, numSlots))
+        return;
+
+    slotSettings[static_cast<size_t> (slotIndex)].followsHostTempo = followHost;
+}
+
+bool MidiFartSnifferProcessor::doesSlotFollowHostTempo (int slotIndex) const
+{
+    return juce::isPositiveAndBelow (slotIndex, numSlots) && slotSettings[static_cast<size_t> (slotIndex)].followsHostTempo;
+}
+
+void MidiFartSnifferProcessor::setSlotMuted (int slotIndex, bool mute)
+{
+    if (! juce::isPositiveAndBelow (slotIndex, numSlots))
+        return;
+
+    slotSettings[static_cast<size_t> (slotIndex)].muted = mute;
+}
+
+bool MidiFartSnifferProcessor::isSlotMuted (int slotIndex) const
+{
+    return juce::isPositiveAndBelow (slotIndex, numSlots) && slotSettings[static_cast<size_t> (slotIndex)].muted;
+}
+
+void MidiFartSnifferProcessor::setSlotOutputChannel (int slotIndex, int channel)
+{
+    if (! juce::isPositiveAndBelow (slotIndex, numSlots))
+        return;
+
+    channel = juce::jlimit (0, 16, channel);
+    slotSettings[static_cast<size_t> (slotIndex)].outputChannel = channel;
+}
+
+int MidiFartSnifferProcessor::getSlotOutputChannel (int slotIndex) const
+{
+    return juce::isPositiveAndBelow (slotIndex, numSlots) ? slotSettings[static_cast<size_t> (slotIndex)].outputChannel.load() : 0;
 }
 
 bool MidiFartSnifferProcessor::getIsPlaying() const
 {
-    return isPlaying;
+    return playingState;
 }
 
 double MidiFartSnifferProcessor::getFileTempo() const
@@ -281,20 +1020,7 @@ double MidiFartSnifferProcessor::getFileTempo() const
 
 int64_t MidiFartSnifferProcessor::getMaxTick() const
 {
-    int64_t maxTick = 0;
-    for (const auto& track : midiTracks)
-    {
-        if (track.getNumEvents() > 0)
-        {
-            auto lastEvent = track.getEventPointer (track.getNumEvents() - 1);
-            if (lastEvent != nullptr)
-            {
-                int64_t endTime = static_cast<int64_t> (lastEvent->message.getTimeStamp());
-                maxTick = std::max (maxTick, endTime);
-            }
-        }
-    }
-    return maxTick;
+    return lengthInTicks;
 }
 
 double MidiFartSnifferProcessor::getPlaybackPosition() const
@@ -305,6 +1031,35 @@ double MidiFartSnifferProcessor::getPlaybackPosition() const
     return 0.0;
 }
 
+double MidiFartSnifferProcessor::getSongLengthInSamples() const
+{
+    double sampleRate = getSampleRate();
+
+    if (isSyncedToHost() || lockToHostSetting)
+    {
+        double tempo = hostTempo;
+        return tempo > 0.0 ? songInfo.lengthInQuarterNotes * (60.0 / tempo) * sampleRate : 0.0;
+    }
+
+    return songInfo.lengthInSeconds * sampleRate;
+}
+
+MidiFartSnifferProcessor::PlaybackSnapshot MidiFartSnifferProcessor::getPlaybackSnapshot() const
+{
+    PlaybackSnapshot snapshot;
+    snapshot.isPlaying = playingState;
+    snapshot.tick = currentTick;
+    snapshot.lengthInTicks = lengthInTicks;
+    snapshot.position = snapshot.lengthInTicks > 0 ? static_cast<double> (snapshot.tick) / static_cast<double> (snapshot.lengthInTicks)
+                                                   : 0.0;
+    snapshot.tempo = getCurrentTempo();
+
+    const double ticksPerBar = songInfo.ticksPerQuarterNote * 4.0 * songInfo.timeSigNumerator
+                                 / juce::jmax (1, songInfo.timeSigDenominator);
+    snapshot.bar = ticksPerBar > 0.0 ? static_cast<double> (snapshot.tick) / ticksPerBar : 0.0;
+    return snapshot;
+}
+
 void MidiFartSnifferProcessor::addToFavorites (const juce::File& file)
 {
     juce::String filePath = file.getFullPathName();
@@ -2,6 +2,17 @@
 
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <juce_audio_devices/juce_audio_devices.h>
+#include "LibraryIndexer.h"
+#include "MidiFileLoader.h"
+#include "MidiOutputStorage.h"
+#include "MidiPlaybackEngine.h"
+#include "OfflineRenderer.h"
+#include "PatternBank.h"
+#include "PatternLauncher.h"
+#include "PlaybackSlot.h"
+#include "RealtimeExchange.h"
+#include "SampleVoiceEngine.h"
+#include "TransportCommandQueue.h"
 
 class MidiFartSnifferEditor;
 
@@ -25,7 +36,7 @@ public:
 
     const juce::String getName() const override { return JucePlugin_Name; }
 
-    bool acceptsMidi() const override { return false; }
+    bool acceptsMidi() const override { return true; }
     bool producesMidi() const override { return true; }
     bool isMidiEffect() const override { return false; }
     double getTailLengthSeconds() const override { return 0.0; }
@@ -41,17 +52,131 @@ public:
 
     // Custom methods
     void setSyncToHost (bool shouldSync);
-    bool isSyncedToHost() const { return syncToHost; }
+    bool isSyncedToHost() const { return doesSlotFollowHostTempo (0); }
+
+    // Host-locked playback: the song position follows the host's PPQ position,
+    // with tick 0 on a bar line, and plays only while the host transport runs
+    void setLockToHostPosition (bool shouldLock);
+    bool isLockedToHostPosition() const { return lockToHostSetting; }
+    void setStartOnNextBar (bool shouldWait);
+    bool isStartingOnNextBar() const { return startOnNextBarSetting; }
     double getCurrentTempo() const;
     void loadMidiFile (const juce::File& file);
+    void loadMidiFileAsync (const juce::File& file, std::function<void (bool)> onLoaded);
+
+    // Built-in sample playback. The kit is decoded on the calling thread and
+    // swapped in by the audio thread at its next block. Without a loaded kit the
+    // notes are auditioned on a small synthesized one.
+    bool loadSampleKit (const juce::File& folder);
+    void unloadSampleKit();
+    juce::File getSampleKitFolder() const { return kitFolder; }
+    int getNumActiveVoices() const { return activeVoices; }
+
+    // Frames of each memory-mapped sample decoded into memory when a kit is
+    // loaded; the rest is streamed from disk. Applies to the next kit loaded.
+    void setSamplePreloadFrames (int numFrames) { samplePreloadFrames = juce::jmax (1, numFrames); }
+    int getSamplePreloadFrames() const { return samplePreloadFrames; }
+
+    // Times a voice needed streamed frames that had not been read from disk yet
+    int getStreamingUnderruns() const { return sampleStreamer.getNumUnderruns(); }
+
+    // Whether the kit is heard on the audio output; MIDI goes out either way
+    void setAuditionEnabled (bool shouldAudition) { auditionEnabled = shouldAudition; }
+    bool isAuditionEnabled() const { return auditionEnabled; }
+
+    // Layers: slots 1 and up play other files alongside the main one, sharing its
+    // transport. Every slot, the main one included, has its own loop, mute, MIDI
+    // channel and tempo source. Layer files are compiled on the calling thread.
+    static constexpr int numSlots = 4;
+
+    bool loadLayer (int slotIndex, const juce::File& file);
+    void clearLayer (int slotIndex);
+    juce::File getLayerFile (int slotIndex) const;
+
+    void setSlotLooping (int slotIndex, bool loop);
+    bool isSlotLooping (int slotIndex) const;
+    void setSlotFollowsHostTempo (int slotIndex, bool followHost);
+    bool doesSlotFollowHostTempo (int slotIndex) const;
+    void setSlotMuted (int slotIndex, bool mute);
+    bool isSlotMuted (int slotIndex) const;
+    void setSlotOutputChannel (int slotIndex, int channel);   // 1-16, or 0 for the file's own channels
+    int getSlotOutputChannel (int slotIndex) const;
+
+    // Pattern launching: while enabled, incoming note-ons on the pads (notes 36-51)
+    // launch, stop or retrigger the pattern assigned to each pad on the next beat
+    // or bar. Patterns are compiled when assigned, never when launched.
+    bool assignPattern (int padIndex, const juce::File& file);
+    void clearPattern (int padIndex);
+    juce::File getPatternFile (int padIndex) const;
+    int getNumAssignedPatterns() const { return patternBank->getNumAssigned(); }
+    int getNumPlayingPatterns() const { return playingPatterns; }
+
+    void setPatternLaunchEnabled (bool shouldLaunch) { patternLaunchEnabled = shouldLaunch; }
+    bool isPatternLaunchEnabled() const { return patternLaunchEnabled; }
+    void setLaunchQuantization (PatternLauncher::Quantization newQuantization) { launchQuantization = newQuantization; }
+    PatternLauncher::Quantization getLaunchQuantization() const { return launchQuantization; }
+    void setRetriggerOnRelaunch (bool shouldRetrigger) { retriggerOnRelaunch = shouldRetrigger; }
+    bool isRetriggeringOnRelaunch() const { return retriggerOnRelaunch; }
+
+    // Offline rendering: plays a MIDI file through the engine as fast as the CPU
+    // allows, on the calling thread and without touching live playback. A .wav
+    // destination is rendered through the kit given, which may be null for any
+    // other destination; those get a MIDI file re-timed to the options' tempo and
+    // resolution. loadOfflineKit() decodes the loaded kit, or returns the built-in
+    // one, with every sample whole; it is slow, so load it once for a whole batch.
+    SampleKit::Ptr loadOfflineKit();
+    OfflineRenderer::Report renderOffline (const juce::File& midiFile, const juce::File& destination,
+                                           const OfflineRenderer::Options& options, const SampleKit* kit);
+
+    // MIDI output room. Each source (a slot, or the pads together) gets a buffer
+    // with room reserved for the densest block of the loaded files, so rendering
+    // does not allocate. With thinning on, a block that would still overflow it
+    // coalesces its controller and pitch-bend messages and drops the rest of what
+    // does not fit; the counters are running totals.
+    void setThinningEnabled (bool shouldThin) { thinningEnabled = shouldThin; }
+    bool isThinningEnabled() const { return thinningEnabled; }
+    int64_t getNumDroppedEvents() const { return droppedEvents; }
+    int64_t getNumCoalescedEvents() const { return coalescedEvents; }
+    int getReservedOutputBytes() const { return reservedOutputBytes; }   // per source
+
+    // Parsed-song cache shared by synchronous, async and prefetch loads
+    void setSongCacheBudget (size_t numBytes) { songCache.setByteBudget (numBytes); }
+    SongCache::Stats getSongCacheStats() const { return songCache.getStats(); }
+
+    // Library index: metadata of every MIDI file under the library folder, kept up
+    // to date in the background and saved between sessions
+    void setLibraryFolder (const juce::File& folder) { libraryIndexer.setRoot (folder); }
+    juce::File getLibraryFolder() const { return libraryIndexer.getRoot(); }
+    LibraryIndexer& getLibraryIndexer() { return libraryIndexer; }
+
+    // Transport controls. These are called on the message thread and queued for
+    // the audio thread; the state getters below read what it last published.
     void startPlayback();
     void stopPlayback();
+    void seek (double positionInTicks);
     void setLooping (bool loop);
     bool getIsPlaying() const;
     double getFileTempo() const;
     int64_t getCurrentTick() const { return currentTick; }
     int64_t getMaxTick() const;
     double getPlaybackPosition() const;
+
+    // Metadata of the loaded song, computed once when it was compiled
+    const CompiledSong::Info& getSongInfo() const { return songInfo; }
+    double getSongLengthInSamples() const;   // at the tempo currently in use
+
+    // Everything the editor shows about playback, read from atomics in one call
+    struct PlaybackSnapshot
+    {
+        bool isPlaying = false;
+        int64_t tick = 0;
+        int64_t lengthInTicks = 0;
+        double position = 0.0;   // 0..1 through the song
+        double bar = 0.0;        // zero-based, fractional
+        double tempo = 120.0;
+    };
+
+    PlaybackSnapshot getPlaybackSnapshot() const;
     
     // Auto-play
     void setAutoPlay (bool autoPlay) { autoPlayEnabled = autoPlay; }
@@ -68,22 +193,112 @@ public:
 
 private:
     // MIDI file playback state
-    std::unique_ptr<juce::MidiFile> currentMidiFile;
-    std::vector<juce::MidiMessageSequence> midiTracks;
-    int64_t currentTick = 0;
-    bool isPlaying = false;
-    bool shouldLoop = false;
+    SongCache songCache;
+    MidiFileLoader fileLoader { songCache };
+    LibraryIndexer libraryIndexer { juce::File::getSpecialLocation (juce::File::userApplicationDataDirectory)
+                                        .getChildFile (JucePlugin_Name).getChildFile ("Library") };
+    std::array<RealtimeExchange<CompiledSong>, numSlots> songExchanges;
+    std::array<PlaybackSlot, numSlots> slots;
+    std::array<juce::MidiBuffer, numSlots> slotOutputs;   // merged into the host's buffer each block
+    std::atomic<int64_t> lengthInTicks { 0 };
     double fileTempo = 120.0;
-    double hostTempo = 120.0;
-    bool syncToHost = true;
+    CompiledSong::Info songInfo;   // of the most recently loaded song, message thread only
+    std::atomic<double> fileTempoAtPosition { 120.0 };   // follows the tempo map during playback
+    std::atomic<double> hostTempo { 120.0 };
+
+    // Transport state owned by the audio thread. The message thread changes it
+    // only by pushing play, stop and seek onto transportCommands and by writing
+    // the settings below, which the audio thread applies at every block.
+    struct TransportState
+    {
+        bool isPlaying = false;
+        bool lockToHostPosition = false;
+        bool startOnNextBar = false;
+    };
+
+    TransportState transport;
+    TransportCommandQueue transportCommands;
+
+    // Settings as last requested on the message thread. The audio thread copies
+    // them into the slots and the transport at the start of every block, so only
+    // the latest value of each matters, even if the host stops calling processBlock
+    // for a while. The editor and the saved state read them too.
+    struct SlotSettings
+    {
+        juce::File file;   // layers only, message thread only
+        std::atomic<bool> looping { false };
+        std::atomic<bool> followsHostTempo { true };
+        std::atomic<bool> muted { false };
+        std::atomic<int> outputChannel { 0 };
+    };
 
-    double ticksPerQuarterNote = 480.0;
-    double samplesPerTick = 0.0;
+    std::array<SlotSettings, numSlots> slotSettings;
+    std::atomic<bool> lockToHostSetting { false };
+    std::atomic<bool> startOnNextBarSetting { false };
 
-    std::unique_ptr<juce::MidiOutput> midiOutput;
+    // Published by the audio thread at the end of every block
+    std::atomic<bool> playingState { false };
+    std::atomic<int64_t> currentTick { 0 };
+
+    // Latest transport state reported by the host's play head
+    struct HostPosition
+    {
+        bool isPlaying = false;
+        bool hasPpqPosition = false;
+        double ppqPosition = 0.0;
+        double ppqOfLastBarStart = 0.0;
+        double barLengthInQuarterNotes = 4.0;
+        bool isLooping = false;
+        double loopStartPpq = 0.0;
+        double loopEndPpq = 0.0;
+    };
+
+    HostPosition hostPosition;
+    double hostAnchorPpq = 0.0;   // host PPQ at which song tick 0 plays
+    bool hostStartPending = false;
+
+    // Sample playback
+    juce::AudioFormatManager formatManager;
+    RealtimeExchange<SampleKit> kitExchange;
+    SampleStreamer sampleStreamer;
+    SampleVoiceEngine voiceEngine;
+    juce::File kitFolder;   // message thread only
+    int samplePreloadFrames = SampleKit::defaultPreloadFrames;
+    std::atomic<bool> auditionEnabled { true };
+    std::atomic<int> activeVoices { 0 };
+
+    // Pattern launching
+    PatternBank::Ptr patternBank { new PatternBank() };   // written on the message thread only
+    RealtimeExchange<PatternBank> patternExchange;
+    PatternLauncher patternLauncher;
+    juce::MidiBuffer patternOutput;
+    juce::MidiBuffer hostInput;   // incoming MIDI passed through while pad launching is off
+    juce::MidiBuffer spareHostStorage;   // reserved room for the host's buffer, then the storage it replaced
+    bool hostStoragePending = false;     // audio thread: spareHostStorage holds room the host has not been given
+    double launcherBeat = 0.0;   // free-running grid used while the host transport is stopped
+    std::atomic<bool> patternLaunchEnabled { false };
+    std::atomic<PatternLauncher::Quantization> launchQuantization { PatternLauncher::Quantization::bar };
+    std::atomic<bool> retriggerOnRelaunch { false };
+    std::atomic<int> playingPatterns { 0 };
+
+    // Output buffer sizing. The message thread reserves more room when a denser
+    // file is loaded and hands it over through outputStorageExchange;
+    // prepareToPlay sizes the buffers directly.
+    static constexpr int numOutputSources = numSlots + 1;   // the slots, then the pads
+    static constexpr int minOutputBufferBytes = 4096;
+    RealtimeExchange<MidiOutputStorage> outputStorageExchange;
+    int outputBudget = minOutputBufferBytes;   // audio thread: room in each source's buffer
+    juce::CriticalSection outputSizingLock;    // guards the next three and patternBank against prepareToPlay
+    std::array<CompiledSong::Ptr, numSlots> slotSongs;
+    double preparedSampleRate = 44100.0;
+    int preparedBlockSize = 512;
+    std::atomic<int> reservedOutputBytes { minOutputBufferBytes };
+    std::atomic<bool> thinningEnabled { false };
+    std::atomic<int64_t> droppedEvents { 0 };
+    std::atomic<int64_t> coalescedEvents { 0 };
     
     // Auto-play state
-    bool autoPlayEnabled = false;
+    std::atomic<bool> autoPlayEnabled { false };
     
     // Favorites
     juce::StringArray favoriteFiles;
@@ -91,7 +306,24 @@ private:
     // Current file
     juce::File currentFile;
 
-    void updateHostTempo();
+    void applySettings();
+    void applyTransportCommand (const TransportCommand& command);
+    void updateHostPosition();
+    void releaseAllSlots();
+    void renderHostLocked (int numSamples);
+    void handlePadInput (const juce::MidiBuffer& midiMessages);
+    void renderPatterns (int numSamples);
+    void mergeOutputs (juce::MidiBuffer& midiMessages);
+    void takeOverOutputStorage();
+    void publishOutputCounters();
+    void setSlotSong (int slotIndex, CompiledSong::Ptr song);
+    void setPatternBank (PatternBank::Ptr bank);
+    void updateOutputReservation();
+    int getOutputBytesNeeded() const;
+
+    // Room for the merged output of every source plus the host's own MIDI
+    static int getHostBufferBytes (int bytesPerSource) noexcept { return (numOutputSources + 1) * bytesPerSource; }
+    bool applyLoadedSong (const juce::File& file, CompiledSong::Ptr song);
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiFartSnifferProcessor)
 };
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <juce_events/juce_events.h>
+
+// Hands immutable, reference-counted objects (compiled songs, sample kits) from
+// the message thread to the audio thread without locks.
+//
+// The message thread publishes a fully built object with a single atomic pointer
+// swap. At the start of each block the audio thread takes the pending object, if
+// any, and pushes the one it was using onto a retire queue. Retired objects are
+// released on the message thread by a timer, so the audio thread never frees
+// memory and never sees a half-built object.
+//
+// Publishing is meant for the message thread, but hosts may restore state (and
+// so load songs and kits) from other threads, so publish() and collectGarbage()
+// are safe to call from any thread except the audio thread. The retire queue has
+// one reader at a time; a collection that finds another under way leaves the
+// objects for it or for the next timer tick.
+template <typename ObjectType>
+class RealtimeExchange final : private juce::Timer
+{
+public:
+    using Ptr = juce::ReferenceCountedObjectPtr<ObjectType>;
+
+    RealtimeExchange()
+    {
+        startTimer (250);
+    }
+
+    ~RealtimeExchange() override
+    {
+        stopTimer();
+
+        // The audio callback has stopped by the time the processor is destroyed.
+        collectGarbage();
+
+        if (auto* pending = pendingObject.exchange (nullptr))
+            pending->decReferenceCount();
+
+        if (activeObject != nullptr)
+            activeObject->decReferenceCount();
+    }
+
+    // Any thread but the audio thread: makes the object the next one the audio thread will pick up.
+    // A previously published object that was never picked up is released.
+    // Publishing nullptr makes the audio thread drop its active object.
+    void publish (Ptr object)
+    {
+        auto* newObject = object.get();
+        if (newObject != nullptr)
+            newObject->incReferenceCount();   // owned by the exchange until the audio thread retires it
+
+        clearPending = (newObject == nullptr);
+
+        // Only the audio thread takes from pendingObject, and it does so with an
+        // exchange, so an object we swap back out here was never seen by it.
+        if (auto* superseded = pendingObject.exchange (newObject))
+            superseded->decReferenceCount();
+
+        collectGarbage();
+    }
+
+    // Audio thread: switches to the most recently published object, if there is
+    // one. Returns true if the active object changed.
+    bool pullPending() noexcept
+    {
+        if (pendingObject.load (std::memory_order_relaxed) == nullptr && ! clearPending.load (std::memory_order_relaxed))
+            return false;
+
+        // Leave the object pending until there is room to retire the current one.
+        if (activeObject != nullptr && retireFifo.getFreeSpace() == 0)
+            return false;
+
+        auto* newObject = pendingObject.exchange (nullptr, std::memory_order_acq_rel);
+
+        if (newObject == nullptr && ! clearPending.exchange (false))
+            return false;
+
+        if (activeObject != nullptr)
+        {
+            int start1, size1, start2, size2;
+            retireFifo.prepareToWrite (1, start1, size1, start2, size2);
+            retiredObjects[static_cast<size_t> (size1 > 0 ? start1 : start2)] = activeObject;
+            retireFifo.finishedWrite (1);
+        }
+
+        activeObject = newObject;
+        return true;
+    }
+
+    // Audio thread: the object currently in use, or nullptr.
+    ObjectType* getActive() const noexcept { return activeObject; }
+
+    // Any thread but the audio thread: releases objects the audio thread has finished with.
+    void collectGarbage()
+    {
+        const juce::SpinLock::ScopedTryLockType lock (collectLock);
+        if (! lock.isLocked())
+            return;
+
+        int start1, size1, start2, size2;
+        retireFifo.prepareToRead (retireFifo.getNumReady(), start1, size1, start2, size2);
+
+        for (int i = 0; i < size1; ++i)
+            std::exchange (retiredObjects[static_cast<size_t> (start1 + i)], nullptr)->decReferenceCount();
+
+        for (int i = 0; i < size2; ++i)
+            std::exchange (retiredObjects[static_cast<size_t> (start2 + i)], nullptr)->decReferenceCount();
+
+        retireFifo.finishedRead (size1 + size2);
+    }
+
+private:
+    void timerCallback() override { collectGarbage(); }
+
+    static constexpr int retireQueueSize = 32;
+
+    std::atomic<ObjectType*> pendingObject { nullptr };
+    std::atomic<bool> clearPending { false };
+    ObjectType* activeObject = nullptr;
+
+    juce::SpinLock collectLock;   // held by the one thread reading the retire queue
+    juce::AbstractFifo retireFifo { retireQueueSize };
+    std::array<ObjectType*, retireQueueSize> retiredObjects {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RealtimeExchange)
+};
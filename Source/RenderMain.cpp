@@ -0,0 +1,149 @@
+#include <iostream>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include "BatchRenderer.h"
+#include "MidiFileLoader.h"
+
+// Command-line front end to OfflineRenderer, for bouncing files without a host:
+//
+//     midifart-render <input.mid> <output.mid|output.wav> [--tempo=BPM] [--ppq=N]
+//                     [--channel=1-16] [--rate=Hz] [--bits=16|24|32] [--kit=folder]
+//                     [--tail=seconds] [--block=samples]
+//
+//     midifart-render <input folder> <output folder> [--wav] [--threads=N] [--quiet]
+//                     [same options as above]
+//
+// A .wav output is played through the kit folder given, or the built-in kit. With
+// a folder, every MIDI file under it is rendered into the same place under the
+// output folder, as .mid or with --wav as .wav, spread over every core.
+
+namespace
+{
+    double getDoubleOption (const juce::ArgumentList& args, const juce::String& option, double defaultValue)
+    {
+        auto value = args.getValueForOption (option);
+        return value.isNotEmpty() ? value.getDoubleValue() : defaultValue;
+    }
+
+    int getIntOption (const juce::ArgumentList& args, const juce::String& option, int defaultValue)
+    {
+        auto value = args.getValueForOption (option);
+        return value.isNotEmpty() ? value.getIntValue() : defaultValue;
+    }
+
+    OfflineRenderer::Options getRenderOptions (const juce::ArgumentList& args)
+    {
+        OfflineRenderer::Options options;
+        options.tempo = getDoubleOption (args, "--tempo", options.tempo);
+        options.ticksPerQuarterNote = getIntOption (args, "--ppq", options.ticksPerQuarterNote);
+        options.outputChannel = getIntOption (args, "--channel", options.outputChannel);
+        options.sampleRate = getDoubleOption (args, "--rate", options.sampleRate);
+        options.bitsPerSample = getIntOption (args, "--bits", options.bitsPerSample);
+        options.tailSeconds = getDoubleOption (args, "--tail", options.tailSeconds);
+        options.blockSize = getIntOption (args, "--block", options.blockSize);
+        return options;
+    }
+
+    SampleKit::Ptr getKit (const juce::ArgumentList& args)
+    {
+        juce::AudioFormatManager formatManager;
+        formatManager.registerBasicFormats();
+
+        SampleKit::Ptr kit;
+        if (args.containsOption ("--kit"))
+            kit = OfflineRenderer::loadKit (args.getExistingFolderForOption ("--kit"), formatManager);
+        else
+            kit = SampleKit::createPreviewKit();
+
+        if (kit == nullptr)
+            juce::ConsoleApplication::fail ("No samples found in " + args.getValueForOption ("--kit"));
+
+        return kit;
+    }
+
+    int renderFolder (const juce::ArgumentList& args, const juce::File& input, const juce::File& output)
+    {
+        BatchRenderer::Options options;
+        options.render = getRenderOptions (args);
+        options.format = args.containsOption ("--wav") ? BatchRenderer::Format::audio : BatchRenderer::Format::midi;
+        options.numThreads = getIntOption (args, "--threads", options.numThreads);
+
+        BatchRenderer batch (options, options.format == BatchRenderer::Format::audio ? getKit (args) : nullptr);
+        const auto summary = batch.run (input, output);
+
+        // Printed after the run, in sorted order, so the log is the same every time
+        if (! args.containsOption ("--quiet"))
+        {
+            for (const auto& result : batch.getResults())
+            {
+                std::cout << result.source.getRelativePathFrom (input) << ": ";
+
+                if (result.report.result.failed())
+                    std::cout << "FAILED (" << result.report.result.getErrorMessage() << ")";
+                else
+                    std::cout << result.report.numEvents << " events, "
+                              << juce::String (result.report.songSeconds, 2) << " s, load "
+                              << juce::String (result.loadSeconds * 1000.0, 1) << " ms, render "
+                              << juce::String (result.report.renderSeconds * 1000.0, 1) << " ms";
+
+                std::cout << std::endl;
+            }
+        }
+
+        const double speedup = summary.wallSeconds > 0.0 ? summary.busySeconds / summary.wallSeconds : 0.0;
+
+        std::cout << summary.numFiles - summary.numFailed << " of " << summary.numFiles << " files, "
+                  << juce::String (summary.songSeconds, 1) << " s of music in "
+                  << juce::String (summary.wallSeconds, 2) << " s ("
+                  << juce::String (speedup, 1) << "x over one thread)" << std::endl;
+
+        return summary.numFailed > 0 ? 1 : 0;
+    }
+
+    int render (const juce::ArgumentList& args)
+    {
+        args.checkMinNumArguments (2);
+
+        const auto input = args[0].resolveAsFile();
+        const auto output = args[1].resolveAsFile();
+
+        if (input.isDirectory())
+            return renderFolder (args, input, output);
+
+        if (! input.existsAsFile())
+            juce::ConsoleApplication::fail ("Could not find " + input.getFullPathName());
+
+        const auto options = getRenderOptions (args);
+
+        auto song = MidiFileLoader::loadFile (input);
+        if (song == nullptr)
+            juce::ConsoleApplication::fail ("Could not read " + input.getFullPathName());
+
+        OfflineRenderer::Report report;
+
+        if (output.hasFileExtension ("wav"))
+        {
+            report = OfflineRenderer::renderToAudio (*song, *getKit (args), output, options);
+        }
+        else
+        {
+            report = OfflineRenderer::renderToMidi (*song, output, options);
+        }
+
+        if (report.result.failed())
+            juce::ConsoleApplication::fail (report.result.getErrorMessage());
+
+        std::cout << input.getFileName() << " -> " << output.getFileName() << ": "
+                  << report.numEvents << " events, "
+                  << juce::String (report.songSeconds, 2) << " s rendered in "
+                  << juce::String (report.renderSeconds * 1000.0, 1) << " ms ("
+                  << juce::String (report.getSpeedFactor(), 0) << "x real time)" << std::endl;
+
+        return 0;
+    }
+}
+
+int main (int argc, char* argv[])
+{
+    juce::ArgumentList args (argc, argv);
+    return juce::ConsoleApplication::invokeCatchingFailures ([&args] { return render (args); });
+}
@@ -0,0 +1,105 @@
+#include "RhythmFingerprint.h"
+#include "FingerprintKernels.h"
+
+int RhythmFingerprint::getVoiceForNote (int noteNumber) noexcept
+{
+    switch (noteNumber)
+    {
+        case 35: case 36:                               return 0;   // kick
+        case 37: case 38: case 39: case 40:             return 1;   // rim, snare, clap
+        case 42: case 44:                               return 2;   // closed and pedal hat
+        case 46:                                        return 3;   // open hat
+        case 41: case 43: case 45: case 47: case 48: case 50:
+                                                        return 4;   // toms
+        case 49: case 52: case 55: case 57:             return 5;   // crash, china, splash
+        case 51: case 53: case 59:                      return 6;   // ride
+        default:                                        return 7;
+    }
+}
+
+RhythmFingerprint RhythmFingerprint::compute (const CompiledSong& song)
+{
+    RhythmFingerprint fingerprint;
+
+    const auto& info = song.getInfo();
+    const double ticksPerStep = info.ticksPerQuarterNote * 4.0 * info.timeSigNumerator
+                                  / (juce::jmax (1, info.timeSigDenominator) * stepsPerBar);
+
+    if (ticksPerStep <= 0.0)
+        return fingerprint;
+
+    // Onsets are counted per grid cell over all the passes through the song
+    std::array<int, numVoices * numSteps> counts {};
+
+    for (int i = 0; i < song.getNumEvents(); ++i)
+    {
+        juce::uint8 bytes[3];
+        if (song.getShortMessage (i, bytes) != 3 || (bytes[0] & 0xf0) != 0x90 || bytes[2] == 0)
+            continue;
+
+        const auto step = static_cast<int64_t> (std::floor (static_cast<double> (song.getTicks()[static_cast<size_t> (i)]) / ticksPerStep + 0.5));
+        const auto voice = getVoiceForNote (bytes[1] & 0x7f);
+        ++counts[static_cast<size_t> (voice * numSteps + static_cast<int> (step % numSteps))];
+    }
+
+    const auto numPasses = static_cast<int> (static_cast<double> (info.lengthInTicks) / (ticksPerStep * numSteps)) + 1;
+    const int threshold = juce::jmax (1, numPasses / 4);
+
+    for (int voice = 0; voice < numVoices; ++voice)
+        for (int step = 0; step < numSteps; ++step)
+            if (counts[static_cast<size_t> (voice * numSteps + step)] >= threshold)
+                fingerprint.words[static_cast<size_t> (voice / 2)] |= juce::uint64 (1) << ((voice % 2) * numSteps + step);
+
+    return fingerprint;
+}
+
+//==============================================================================
+void FingerprintSet::reserve (int numFingerprints)
+{
+    fingerprints.reserve (static_cast<size_t> (numFingerprints));
+    ids.reserve (static_cast<size_t> (numFingerprints));
+}
+
+void FingerprintSet::add (const RhythmFingerprint& fingerprint, int id)
+{
+    fingerprints.push_back (fingerprint);
+    ids.push_back (id);
+}
+
+std::vector<FingerprintSet::Match> FingerprintSet::findNearest (const RhythmFingerprint& query, int numResults, int excludedId,
+                                                                const FingerprintKernels* kernels) const
+{
+    constexpr int maxDistance = RhythmFingerprint::numVoices * RhythmFingerprint::numSteps;
+
+    const auto& kernelsToUse = kernels != nullptr ? *kernels : FingerprintKernels::get();
+    std::vector<juce::uint16> distances (fingerprints.size());
+    kernelsToUse.hammingDistances (fingerprints.data(), size(), query, distances.data());
+
+    // The distance of the furthest result to keep, from a histogram of all of them
+    std::array<int, maxDistance + 1> histogram {};
+    for (size_t i = 0; i < distances.size(); ++i)
+        if (ids[i] != excludedId)
+            ++histogram[distances[i]];
+
+    int cutoff = 0;
+    for (int found = 0; cutoff < maxDistance; ++cutoff)
+    {
+        found += histogram[static_cast<size_t> (cutoff)];
+        if (found >= numResults)
+            break;
+    }
+
+    std::vector<Match> matches;
+    matches.reserve (static_cast<size_t> (juce::jmax (0, numResults)));
+
+    for (size_t i = 0; i < distances.size(); ++i)
+        if (distances[i] <= cutoff && ids[i] != excludedId)
+            matches.push_back ({ ids[i], distances[i] });
+
+    std::stable_sort (matches.begin(), matches.end(), [] (const Match& a, const Match& b) { return a.distance < b.distance; });
+
+    if (matches.size() > static_cast<size_t> (juce::jmax (0, numResults)))
+        matches.resize (static_cast<size_t> (juce::jmax (0, numResults)));
+
+    return matches;
+}
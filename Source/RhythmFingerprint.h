@@ -0,0 +1,73 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "CompiledSong.h"
+
+struct FingerprintKernels;
+
+// A groove's rhythm as a grid of onsets: two bars of sixteenth-note steps for
+// each of eight drum voices, 256 bits in all.
+//
+// The whole song is folded onto the two-bar grid, and a step is set when the
+// voice plays on it in at least a quarter of the passes, so a fill or a one-off
+// crash does not change the fingerprint much. Notes outside the drum voices
+// below count as "other", which keeps the rhythm of melodic files comparable too.
+// Two fingerprints are compared by the number of bits that differ.
+struct RhythmFingerprint
+{
+    static constexpr int numVoices = 8;       // kick, snare, closed hat, open hat, toms, crash, ride, other
+    static constexpr int numSteps = 32;       // sixteenths over two bars
+    static constexpr int stepsPerBar = 16;
+    static constexpr int numWords = numVoices * numSteps / 64;
+
+    // Voice v uses bits (v % 2) * 32 + step of words[v / 2].
+    std::array<juce::uint64, numWords> words {};
+
+    static RhythmFingerprint compute (const CompiledSong& song);
+
+    // The voice a General MIDI drum note belongs to.
+    static int getVoiceForNote (int noteNumber) noexcept;
+
+    bool hasOnset (int voice, int step) const noexcept
+    {
+        return ((words[static_cast<size_t> (voice / 2)] >> ((voice % 2) * numSteps + step)) & 1) != 0;
+    }
+
+    bool isEmpty() const noexcept
+    {
+        return std::all_of (words.begin(), words.end(), [] (juce::uint64 w) { return w == 0; });
+    }
+};
+
+// Fingerprints stored back to back for brute-force nearest-neighbour search.
+//
+// Every query measures the distance to every fingerprint with the fastest
+// FingerprintKernels the CPU runs. Distances only go up to 256, so the nearest
+// are then picked with a histogram of distances instead of a sort.
+class FingerprintSet final
+{
+public:
+    struct Match
+    {
+        int id = 0;
+        int distance = 0;
+    };
+
+    FingerprintSet() = default;
+
+    void reserve (int numFingerprints);
+    void add (const RhythmFingerprint& fingerprint, int id);
+    int size() const noexcept { return static_cast<int> (fingerprints.size()); }
+
+    // The numResults fingerprints closest to the query, nearest first, ties in the
+    // order they were added. Fingerprints with the given id are left out. Uses the
+    // fastest kernels unless others are given.
+    std::vector<Match> findNearest (const RhythmFingerprint& query, int numResults, int excludedId = -1,
+                                    const FingerprintKernels* kernels = nullptr) const;
+
+private:
+    std::vector<RhythmFingerprint> fingerprints;
+    std::vector<int> ids;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FingerprintSet)
+};
@@ -0,0 +1,270 @@
+#include "SampleKit.h"
+
+SampleKit::Ptr SampleKit::loadFromFolder (const juce::File& folder, juce::AudioFormatManager& formatManager, int preloadFrames)
+{
+    if (! folder.isDirectory())
+        return nullptr;
+
+    struct Entry
+    {
+        int noteNumber;
+        int maxVelocity;
+        std::unique_ptr<juce::AudioFormatReader> reader;
+        int length;
+        int residentLength;
+        bool isMapped;
+    };
+
+    preloadFrames = juce::jmax (1, preloadFrames);
+
+    // Open every note-named file first so the pool can be sized in one go
+    std::vector<Entry> entries;
+    size_t poolSize = 0;
+
+    for (const auto& file : folder.findChildFiles (juce::File::findFiles, false, formatManager.getWildcardForAllFormats()))
+    {
+        int noteNumber = 0, maxVelocity = 127;
+        if (! parseFileName (file, noteNumber, maxVelocity))
+            continue;
+
+        std::unique_ptr<juce::AudioFormatReader> reader;
+        bool isMapped = false;
+
+        if (auto* format = formatManager.findFormatForFileExtension (file.getFileExtension()))
+        {
+            std::unique_ptr<juce::MemoryMappedAudioFormatReader> mappedReader (format->createMemoryMappedReader (file));
+
+            if (mappedReader != nullptr && mappedReader->mapEntireFile())
+            {
+                reader = std::move (mappedReader);
+                isMapped = true;
+            }
+        }
+
+        if (reader == nullptr)
+            reader.reset (formatManager.createReaderFor (file));
+
+        if (reader == nullptr || reader->lengthInSamples <= 1 || reader->numChannels == 0 || reader->sampleRate <= 0.0)
+            continue;
+
+        // Mapped files stream their tail; anything else has to fit in memory
+        const auto maxLength = isMapped ? static_cast<juce::int64> (std::numeric_limits<int>::max())
+                                        : static_cast<juce::int64> (maxSampleLengthSeconds * reader->sampleRate);
+        const auto length = static_cast<int> (juce::jmin (reader->lengthInSamples, maxLength));
+        const auto residentLength = isMapped ? juce::jmin (length, preloadFrames) : length;
+        const auto numChannels = juce::jmin (2, static_cast<int> (reader->numChannels));
+
+        poolSize += static_cast<size_t> (residentLength) * static_cast<size_t> (numChannels);
+        entries.push_back ({ noteNumber, maxVelocity, std::move (reader), length, residentLength, isMapped });
+    }
+
+    if (entries.empty())
+        return nullptr;
+
+    Ptr kit (new SampleKit());
+    kit->folder = folder;
+    kit->pool.reserve (poolSize);
+    kit->samples.reserve (entries.size());
+
+    juce::AudioBuffer<float> decodeBuffer;
+
+    for (auto& entry : entries)
+    {
+        auto& reader = *entry.reader;
+
+        Sample sample;
+        sample.offset = kit->pool.size();
+        sample.numChannels = juce::jmin (2, static_cast<int> (reader.numChannels));
+        sample.length = entry.length;
+        sample.residentLength = entry.residentLength;
+        sample.sampleRate = reader.sampleRate;
+
+        decodeBuffer.setSize (sample.numChannels, sample.residentLength, false, false, true);
+        reader.read (&decodeBuffer, 0, sample.residentLength, 0, true, sample.numChannels > 1);
+
+        for (int ch = 0; ch < sample.numChannels; ++ch)
+        {
+            const auto* data = decodeBuffer.getReadPointer (ch);
+            kit->pool.insert (kit->pool.end(), data, data + sample.residentLength);
+        }
+
+        // Only a streamed sample needs its reader after loading
+        if (sample.isStreamed())
+        {
+            sample.readerIndex = static_cast<int> (kit->readers.size());
+            kit->readers.push_back (std::move (entry.reader));
+        }
+
+        kit->layers[static_cast<size_t> (entry.noteNumber)].push_back ({ entry.maxVelocity, static_cast<int> (kit->samples.size()) });
+        kit->samples.push_back (sample);
+    }
+
+    kit->sortLayers();
+    return kit;
+}
+
+bool SampleKit::readFromDisk (const Sample& sample, float* const* destChannels, juce::int64 startFrame, int numFrames) const
+{
+    if (! juce::isPositiveAndBelow (sample.readerIndex, static_cast<int> (readers.size())))
+        return false;
+
+    return readers[static_cast<size_t> (sample.readerIndex)]->read (destChannels, sample.numChannels, startFrame, numFrames);
+}
+
+bool SampleKit::containsSample (const Sample* sample) const noexcept
+{
+    return ! samples.empty() && std::less_equal<const Sample*>() (samples.data(), sample)
+        && std::less<const Sample*>() (sample, samples.data() + samples.size());
+}
+
+SampleKit::Ptr SampleKit::createPreviewKit()
+{
+    constexpr double rate = 48000.0;
+    constexpr double twoPi = juce::MathConstants<double>::twoPi;
+
+    juce::Random random (0x5eed);   // the same noise every time
+    auto noise = [&random] { return random.nextFloat() * 2.0f - 1.0f; };
+
+    auto render = [] (double seconds, auto&& generator)
+    {
+        std::vector<float> data (static_cast<size_t> (seconds * rate));
+        for (size_t i = 0; i < data.size(); ++i)
+            data[i] = generator (static_cast<double> (i) / rate);
+        return data;
+    };
+
+    Ptr kit (new SampleKit());
+
+    // Kick: a sine falling from 150 Hz to 50 Hz
+    double kickPhase = 0.0;
+    kit->addMonoSample (render (0.25, [&kickPhase] (double t)
+    {
+        kickPhase += twoPi * (50.0 + 100.0 * std::exp (-t * 30.0)) / rate;
+        return static_cast<float> (std::sin (kickPhase) * std::exp (-t * 14.0));
+    }), rate, { 35, 36 });
+
+    // Snare: a short tone under a noise burst
+    kit->addMonoSample (render (0.18, [&noise] (double t)
+    {
+        const double tone = 0.4 * std::sin (twoPi * 185.0 * t) * std::exp (-t * 30.0);
+        return static_cast<float> (tone + 0.6 * noise() * std::exp (-t * 22.0));
+    }), rate, { 37, 38, 39, 40 });
+
+    // Hats and cymbals: differentiated noise, short when closed and long when open
+    auto metal = [&noise, &render] (double seconds, double decay)
+    {
+        float previous = 0.0f;
+        return render (seconds, [&noise, &previous, decay] (double t)
+        {
+            const float white = noise();
+            const float high = 0.5f * (white - previous);
+            previous = white;
+            return static_cast<float> (high * std::exp (-t * decay));
+        });
+    };
+
+    kit->addMonoSample (metal (0.06, 70.0), rate, { 42, 44 });
+    kit->addMonoSample (metal (0.40, 9.0), rate, { 46, 49, 51, 52, 53, 55, 57, 59 });
+
+    // Every other note: a short blip
+    std::vector<int> otherNotes;
+    for (int note = 0; note < 128; ++note)
+        if (kit->layers[static_cast<size_t> (note)].empty())
+            otherNotes.push_back (note);
+
+    auto click = render (0.03, [] (double t)
+    {
+        return static_cast<float> (0.5 * std::sin (twoPi * 1200.0 * t) * std::exp (-t * 160.0));
+    });
+
+    kit->addMonoSample (click, rate, {});
+    for (auto note : otherNotes)
+        kit->layers[static_cast<size_t> (note)].push_back ({ 127, kit->getNumSamples() - 1 });
+
+    kit->sortLayers();
+    return kit;
+}
+
+void SampleKit::addMonoSample (const std::vector<float>& data, double sampleRate, std::initializer_list<int> noteNumbers)
+{
+    Sample sample;
+    sample.offset = pool.size();
+    sample.length = static_cast<int> (data.size());
+    sample.residentLength = sample.length;
+    sample.numChannels = 1;
+    sample.sampleRate = sampleRate;
+
+    pool.insert (pool.end(), data.begin(), data.end());
+
+    for (auto note : noteNumbers)
+        layers[static_cast<size_t> (note)].push_back ({ 127, static_cast<int> (samples.size()) });
+
+    samples.push_back (sample);
+}
+
+void SampleKit::sortLayers()
+{
+    for (auto& noteLayers : layers)
+        std::sort (noteLayers.begin(), noteLayers.end(),
+                   [] (const Layer& a, const Layer& b) { return a.maxVelocity < b.maxVelocity; });
+}
+
+bool SampleKit::parseFileName (const juce::File& file, int& noteNumber, int& maxVelocity)
+{
+    auto name = file.getFileNameWithoutExtension();
+    auto notePart = name.upToFirstOccurrenceOf ("_", false, false);
+    auto velocityPart = name.fromFirstOccurrenceOf ("_", false, false);
+
+    if (notePart.isEmpty() || ! notePart.containsOnly ("0123456789"))
+        return false;
+
+    noteNumber = notePart.getIntValue();
+    if (noteNumber > 127)
+        return false;
+
+    maxVelocity = 127;
+
+    if (velocityPart.isNotEmpty())
+    {
+        if (! velocityPart.containsOnly ("0123456789"))
+            return false;
+
+        maxVelocity = juce::jlimit (1, 127, velocityPart.getIntValue());
+    }
+
+    return true;
+}
+
+const SampleKit::Sample* SampleKit::findSample (int noteNumber, int velocity) const noexcept
+{
+    if (! juce::isPositiveAndBelow (noteNumber, 128))
+        return nullptr;
+
+    const auto& noteLayers = layers[static_cast<size_t> (noteNumber)];
+    if (noteLayers.empty())
+        return nullptr;
+
+    for (const auto& layer : noteLayers)
+        if (velocity <= layer.maxVelocity)
+            return &samples[static_cast<size_t> (layer.sampleIndex)];
+
+    return &samples[static_cast<size_t> (noteLayers.back().sampleIndex)];
+}
+
+int SampleKit::getNumMappedNotes() const noexcept
+{
+    int numNotes = 0;
+
+    for (const auto& noteLayers : layers)
+        if (! noteLayers.empty())
+            ++numNotes;
+
+    return numNotes;
+}
+
+size_t SampleKit::getMemoryUsage() const noexcept
+{
+    return sizeof (*this)
+         + pool.capacity() * sizeof (float)
+         + samples.capacity() * sizeof (Sample);
+}
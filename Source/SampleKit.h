@@ -0,0 +1,100 @@
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+
+// A drum kit: one-shot samples mapped to MIDI notes.
+//
+// A kit is loaded from a folder of audio files named after the note they play:
+//
+//     <note>.wav              plays note <note> at every velocity
+//     <note>_<maxVel>.wav     a velocity layer used up to and including <maxVel>
+//
+// where <note> is a MIDI note number (36 for a GM kick) and any format the
+// AudioFormatManager knows can be used. A note can have any number of layers;
+// a velocity above the highest layer's bound plays that top layer.
+//
+// WAV and AIFF files are memory-mapped. Only the first preloadFrames of each one
+// (the attack) is decoded into a resident PCM pool; the rest stays on disk and is
+// read by a SampleStreamer while a voice plays it. Files in other formats are
+// decoded whole. Loading a kit therefore touches a bounded amount of audio
+// however large the library is.
+//
+// Kits are immutable once loaded and reference counted, so they can be handed
+// to the audio thread through a RealtimeExchange.
+class SampleKit final : public juce::ReferenceCountedObject
+{
+public:
+    using Ptr = juce::ReferenceCountedObjectPtr<SampleKit>;
+
+    // One sample. The channels of its resident part are stored one after another
+    // in the pool; frames from residentLength on have to be streamed.
+    struct Sample
+    {
+        size_t offset = 0;
+        int length = 0;
+        int residentLength = 0;
+        int numChannels = 0;
+        double sampleRate = 44100.0;
+        int readerIndex = -1;   // into readers, or -1 if the whole sample is resident
+
+        bool isStreamed() const noexcept { return residentLength < length; }
+    };
+
+    static constexpr int defaultPreloadFrames = 8192;
+
+    // Returns nullptr if the folder holds no usable samples.
+    static Ptr loadFromFolder (const juce::File& folder, juce::AudioFormatManager& formatManager,
+                               int preloadFrames = defaultPreloadFrames);
+
+    // A small synthesized kit (kick, snare, hats and a click on every other
+    // note) so grooves can be auditioned before any kit has been loaded.
+    static Ptr createPreviewKit();
+
+    // The sample for a note at a velocity (1-127), or nullptr if the note is unmapped.
+    const Sample* findSample (int noteNumber, int velocity) const noexcept;
+
+    // The resident frames of one channel.
+    const float* getChannelData (const Sample& sample, int channel) const noexcept
+    {
+        return pool.data() + sample.offset + static_cast<size_t> (channel) * static_cast<size_t> (sample.residentLength);
+    }
+
+    // Streaming thread: reads frames of a streamed sample from its file.
+    bool readFromDisk (const Sample& sample, float* const* destChannels, juce::int64 startFrame, int numFrames) const;
+
+    // True if the pointer refers to one of this kit's samples. Never dereferences it.
+    bool containsSample (const Sample* sample) const noexcept;
+
+    int getNumSamples() const noexcept { return static_cast<int> (samples.size()); }
+    int getNumMappedNotes() const noexcept;
+    const juce::File& getFolder() const noexcept { return folder; }
+
+    // Approximate heap footprint of the resident audio.
+    size_t getMemoryUsage() const noexcept;
+
+    // Longest file in a format that cannot be memory-mapped that will be decoded into the pool.
+    static constexpr double maxSampleLengthSeconds = 30.0;
+
+private:
+    SampleKit() = default;
+
+    struct Layer
+    {
+        int maxVelocity = 127;
+        int sampleIndex = 0;
+    };
+
+    static bool parseFileName (const juce::File& file, int& noteNumber, int& maxVelocity);
+
+    // Copies a mono sample into the pool and maps it to the given notes.
+    void addMonoSample (const std::vector<float>& data, double sampleRate, std::initializer_list<int> noteNumbers);
+    void sortLayers();
+
+    std::vector<float> pool;
+    std::vector<Sample> samples;
+    std::vector<std::unique_ptr<juce::AudioFormatReader>> readers;   // memory-mapped
+    std::array<std::vector<Layer>, 128> layers;   // per note, sorted by maxVelocity
+    juce::File folder;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SampleKit)
+};
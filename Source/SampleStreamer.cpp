@@ -0,0 +1,174 @@
+#include "SampleStreamer.h"
+
+SampleStreamer::SampleStreamer()
+    : juce::Thread ("Sample streamer")
+{
+    for (auto& stream : streams)
+        stream.ring.resize (2 * static_cast<size_t> (ringFrames));
+
+    startThread (juce::Thread::Priority::high);
+}
+
+SampleStreamer::~SampleStreamer()
+{
+    signalThreadShouldExit();
+    notify();
+    stopThread (2000);
+}
+
+void SampleStreamer::setKit (SampleKit::Ptr newKit)
+{
+    {
+        const juce::ScopedLock sl (kitLock);
+        kit = std::move (newKit);
+    }
+
+    requestFill();
+    notify();
+}
+
+void SampleStreamer::startStream (int streamIndex, const SampleKit::Sample& sample) noexcept
+{
+    auto& stream = streams[static_cast<size_t> (streamIndex)];
+
+    stream.readFrame.store (0, std::memory_order_relaxed);
+    stream.sample.store (&sample, std::memory_order_relaxed);
+    stream.state.store (pack (++stream.generation, 0), std::memory_order_release);
+
+    requestFill();
+}
+
+void SampleStreamer::stopStream (int streamIndex) noexcept
+{
+    auto& stream = streams[static_cast<size_t> (streamIndex)];
+
+    stream.sample.store (nullptr, std::memory_order_relaxed);
+    stream.state.store (pack (++stream.generation, 0), std::memory_order_release);
+}
+
+bool SampleStreamer::read (int streamIndex, juce::int64 startFrame, int numFrames,
+                           float* const* destChannels, int numChannels) noexcept
+{
+    auto& stream = streams[static_cast<size_t> (streamIndex)];
+    const auto* sample = stream.sample.load (std::memory_order_relaxed);
+
+    if (sample == nullptr || numFrames <= 0)
+        return true;
+
+    // Frames are counted from the end of the resident part
+    const juce::int64 tailStart = juce::jmax<juce::int64> (0, startFrame - sample->residentLength);
+    stream.readFrame.store (tailStart, std::memory_order_relaxed);
+
+    const auto state = stream.state.load (std::memory_order_acquire);
+    const auto written = (state >> generationShift) == (stream.generation & generationMask)
+                           ? static_cast<juce::int64> (state & framesMask)
+                           : 0;
+
+    // Wake the disk thread once the ring has drained enough for it to top it up
+    const auto tailLength = static_cast<juce::int64> (sample->length - sample->residentLength);
+
+    if (written < tailLength && tailStart + ringFrames - written >= juce::jmin<juce::int64> (framesPerRead, tailLength - written))
+        requestFill();
+
+    const int available = static_cast<int> (juce::jlimit<juce::int64> (0, numFrames, written - tailStart));
+    const int sourceChannels = juce::jmin (numChannels, sample->numChannels);
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        const auto* ring = stream.getRingChannel (juce::jmin (ch, sourceChannels - 1));
+        auto* dest = destChannels[ch];
+
+        const int ringStart = static_cast<int> (tailStart % ringFrames);
+        const int firstPart = juce::jmin (available, ringFrames - ringStart);
+
+        std::copy (ring + ringStart, ring + ringStart + firstPart, dest);
+        std::copy (ring, ring + (available - firstPart), dest + firstPart);
+        std::fill (dest + available, dest + numFrames, 0.0f);
+    }
+
+    if (available == numFrames)
+        return true;
+
+    underruns.fetch_add (1, std::memory_order_relaxed);
+    return false;
+}
+
+void SampleStreamer::requestFill() noexcept
+{
+    fillRequested.store (true, std::memory_order_release);
+}
+
+void SampleStreamer::run()
+{
+    while (! threadShouldExit())
+    {
+        // Cleared before the pass, so a request made during it is seen on the next one
+        if (! fillRequested.exchange (false, std::memory_order_acq_rel))
+        {
+            wait (idleWaitMs);
+            continue;
+        }
+
+        // Hold the kit by reference rather than the lock, so a new kit never
+        // waits for a disk read
+        SampleKit::Ptr currentKit;
+
+        {
+            const juce::ScopedLock sl (kitLock);
+            currentKit = kit;
+        }
+
+        bool didWork = false;
+
+        if (currentKit != nullptr)
+            for (auto& stream : streams)
+                didWork = fillStream (stream, *currentKit) || didWork;
+
+        currentKit = nullptr;
+
+        // A ring that was topped up may take more straight away
+        if (didWork)
+            requestFill();
+    }
+}
+
+bool SampleStreamer::fillStream (Stream& stream, const SampleKit& currentKit)
+{
+    const auto state = stream.state.load (std::memory_order_acquire);
+    const auto* sample = stream.sample.load (std::memory_order_relaxed);
+
+    // A sample from a kit that has been replaced may already be gone, so it is
+    // only looked at once it is known to belong to the current one
+    if (sample == nullptr || ! currentKit.containsSample (sample))
+        return false;
+
+    const auto written = static_cast<juce::int64> (state & framesMask);
+    const auto tailLength = static_cast<juce::int64> (sample->length - sample->residentLength);
+    const auto space = stream.readFrame.load (std::memory_order_relaxed) + ringFrames - written;
+
+    if (written >= tailLength || space <= 0)
+        return false;
+
+    // Wait for a worthwhile amount of space unless this finishes the sample
+    const auto remaining = tailLength - written;
+    if (space < framesPerRead && space < remaining)
+        return false;
+
+    const int numFrames = static_cast<int> (juce::jmin<juce::int64> (framesPerRead, space, remaining));
+    const int ringStart = static_cast<int> (written % ringFrames);
+    const int firstPart = juce::jmin (numFrames, ringFrames - ringStart);
+
+    float* firstChannels[2] = { stream.getRingChannel (0) + ringStart, stream.getRingChannel (1) + ringStart };
+    float* secondChannels[2] = { stream.getRingChannel (0), stream.getRingChannel (1) };
+
+    const auto fileFrame = static_cast<juce::int64> (sample->residentLength) + written;
+    currentKit.readFromDisk (*sample, firstChannels, fileFrame, firstPart);
+
+    if (numFrames > firstPart)
+        currentKit.readFromDisk (*sample, secondChannels, fileFrame + firstPart, numFrames - firstPart);
+
+    // Publish only if the voice has not moved on to another sample meanwhile
+    auto expected = state;
+    stream.state.compare_exchange_strong (expected, state + static_cast<uint64_t> (numFrames), std::memory_order_release);
+    return true;
+}
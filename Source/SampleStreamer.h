@@ -0,0 +1,88 @@
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include "SampleKit.h"
+
+// Streams the tails of long samples from disk into per-voice ring buffers.
+//
+// Each voice of the SampleVoiceEngine owns one stream. When a voice starts a
+// sample that is not fully resident, the audio thread points the voice's stream
+// at it; a background thread then keeps the ring filled with the frames that
+// follow the resident attack, a ring's length ahead of where the voice is
+// reading. The audio thread never waits: if the frames it needs have not
+// arrived, it plays silence for them and counts an underrun. When a stream
+// starts or a ring drains far enough to be worth topping up, the audio thread
+// only raises an atomic flag, since signalling the thread would take a lock; the
+// thread checks the flag every couple of milliseconds while it has nothing to do.
+//
+// Starting and stopping streams is lock-free. Each stream publishes a generation
+// number together with its fill level in one atomic word, so data the disk
+// thread wrote for a sample the voice has since abandoned is never read.
+class SampleStreamer final : private juce::Thread
+{
+public:
+    static constexpr int maxStreams = 128;
+    static constexpr int ringFrames = 8192;
+
+    SampleStreamer();
+    ~SampleStreamer() override;
+
+    // Message thread: the kit whose samples may be streamed. Streams of samples
+    // from any other kit stop being filled.
+    void setKit (SampleKit::Ptr newKit);
+
+    // Audio thread: starts filling the stream with the tail of the sample.
+    void startStream (int streamIndex, const SampleKit::Sample& sample) noexcept;
+
+    // Audio thread: stops filling the stream.
+    void stopStream (int streamIndex) noexcept;
+
+    // Audio thread: copies frames [startFrame, startFrame + numFrames) of the
+    // stream's sample, all at or after its resident part, into the destination
+    // channels and frees the ring space before startFrame. Frames that have not
+    // been streamed yet are zeroed; returns false and counts an underrun then.
+    bool read (int streamIndex, juce::int64 startFrame, int numFrames, float* const* destChannels, int numChannels) noexcept;
+
+    int getNumUnderruns() const noexcept { return underruns; }
+    void resetUnderruns() noexcept { underruns = 0; }
+
+private:
+    struct Stream
+    {
+        // Generation in the top bits, frames of the tail written in the rest
+        std::atomic<uint64_t> state { 0 };
+        std::atomic<const SampleKit::Sample*> sample { nullptr };
+        std::atomic<juce::int64> readFrame { 0 };   // first tail frame still needed
+        uint64_t generation = 0;                     // audio thread's copy
+
+        std::vector<float> ring;   // two channels of ringFrames, one after the other
+
+        float* getRingChannel (int channel) noexcept { return ring.data() + static_cast<size_t> (channel) * ringFrames; }
+    };
+
+    static constexpr int generationShift = 40;
+    static constexpr uint64_t framesMask = (uint64_t { 1 } << generationShift) - 1;
+    static constexpr uint64_t generationMask = ~uint64_t { 0 } >> generationShift;
+    static constexpr int framesPerRead = 4096;
+    static constexpr int idleWaitMs = 2;   // well within the resident attack of any sample
+
+    static uint64_t pack (uint64_t generation, juce::int64 framesWritten) noexcept
+    {
+        return (generation << generationShift) | (static_cast<uint64_t> (framesWritten) & framesMask);
+    }
+
+    void run() override;
+    void requestFill() noexcept;
+    bool fillStream (Stream& stream, const SampleKit& currentKit);
+
+    std::array<Stream, maxStreams> streams;
+
+    juce::CriticalSection kitLock;   // message and streaming threads only
+    SampleKit::Ptr kit;
+
+    std::atomic<bool> fillRequested { false };
+
+    std::atomic<int> underruns { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SampleStreamer)
+};
@@ -0,0 +1,270 @@
+#include "SampleVoiceEngine.h"
+
+static_assert (SampleVoiceEngine::maxVoices <= SampleStreamer::maxStreams, "every voice needs its own stream");
+
+SampleVoiceEngine::SampleVoiceEngine()
+{
+    channelPan.fill (0.5f);
+}
+
+void SampleVoiceEngine::prepare (double newSampleRate)
+{
+    sampleRate = newSampleRate > 0.0 ? newSampleRate : 44100.0;
+    channelPan.fill (0.5f);
+    allNotesOff();
+}
+
+void SampleVoiceEngine::setKit (const SampleKit* newKit)
+{
+    allNotesOff();
+    kit = newKit;
+}
+
+void SampleVoiceEngine::releaseAllVoices() noexcept
+{
+    const auto step = static_cast<float> (1.0 / (releaseSeconds * sampleRate));
+
+    for (auto& voice : voices)
+        if (voice.isActive())
+            voice.fadeStep = juce::jmax (voice.fadeStep, step);
+}
+
+void SampleVoiceEngine::allNotesOff() noexcept
+{
+    for (int i = 0; i < maxVoices; ++i)
+        if (voices[static_cast<size_t> (i)].isActive())
+            stopVoice (i);
+}
+
+void SampleVoiceEngine::stopVoice (int voiceIndex) noexcept
+{
+    auto& voice = voices[static_cast<size_t> (voiceIndex)];
+
+    if (voice.isStreaming && streamer != nullptr)
+        streamer->stopStream (voiceIndex);
+
+    voice.sample = nullptr;
+    voice.isStreaming = false;
+}
+
+int SampleVoiceEngine::getNumActiveVoices() const noexcept
+{
+    int numActive = 0;
+
+    for (const auto& voice : voices)
+        if (voice.isActive())
+            ++numActive;
+
+    return numActive;
+}
+
+void SampleVoiceEngine::renderNextBlock (juce::AudioBuffer<float>& output, const juce::MidiBuffer& midi)
+{
+    if (kit == nullptr || output.getNumChannels() == 0)
+        return;
+
+    const int numSamples = output.getNumSamples();
+    int rendered = 0;
+
+    // Render up to each note-on so it starts on its exact sample
+    for (const auto metadata : midi)
+    {
+        const auto* data = metadata.data;
+        if (metadata.numBytes < 3)
+            continue;
+
+        const int status = data[0] & 0xf0;
+        const int channel = data[0] & 0x0f;
+
+        if (status == 0xb0 && data[1] == 10)
+        {
+            channelPan[static_cast<size_t> (channel)] = static_cast<float> (data[2]) / 127.0f;
+            continue;
+        }
+
+        if (status != 0x90 || data[2] == 0)
+            continue;
+
+        const int position = juce::jlimit (rendered, numSamples, metadata.samplePosition);
+        renderVoices (output, rendered, position - rendered);
+        rendered = position;
+
+        noteOn (channel + 1, data[1], data[2]);
+    }
+
+    renderVoices (output, rendered, numSamples - rendered);
+}
+
+void SampleVoiceEngine::noteOn (int midiChannel, int noteNumber, int velocity)
+{
+    if (kit == nullptr)
+        return;
+
+    const auto* sample = kit->findSample (noteNumber, velocity);
+    if (sample == nullptr || sample->length < 2)
+        return;
+
+    // Take a free voice, or steal the one that started longest ago
+    int target = 0;
+
+    for (int i = 0; i < maxVoices; ++i)
+    {
+        const auto& voice = voices[static_cast<size_t> (i)];
+
+        if (! voice.isActive())
+        {
+            target = i;
+            break;
+        }
+
+        if (voice.startOrder < voices[static_cast<size_t> (target)].startOrder)
+            target = i;
+    }
+
+    if (voices[static_cast<size_t> (target)].isActive())
+        stopVoice (target);
+
+    // Balanced pan law: unity at the centre, one side fades as the other stays full
+    const float gain = static_cast<float> (velocity) / 127.0f;
+    const float pan = channelPan[static_cast<size_t> (juce::jlimit (1, 16, midiChannel) - 1)];
+
+    auto& voice = voices[static_cast<size_t> (target)];
+    voice.sample = sample;
+    voice.position = 0.0;
+    voice.increment = sample->sampleRate / sampleRate;
+    voice.gainLeft = gain * juce::jmin (1.0f, 2.0f * (1.0f - pan));
+    voice.gainRight = gain * juce::jmin (1.0f, 2.0f * pan);
+    voice.fade = 1.0f;
+    voice.fadeStep = 0.0f;
+    voice.startOrder = nextStartOrder++;
+    voice.isStreaming = sample->isStreamed() && streamer != nullptr;
+
+    if (voice.isStreaming)
+        streamer->startStream (target, *sample);
+}
+
+void SampleVoiceEngine::renderVoices (juce::AudioBuffer<float>& output, int startSample, int numSamples)
+{
+    if (numSamples <= 0)
+        return;
+
+    for (int i = 0; i < maxVoices; ++i)
+        if (voices[static_cast<size_t> (i)].isActive())
+            renderVoice (i, output, startSample, numSamples);
+}
+
+void SampleVoiceEngine::renderVoice (int voiceIndex, juce::AudioBuffer<float>& output, int startSample, int numSamples)
+{
+    auto& voice = voices[static_cast<size_t> (voiceIndex)];
+    const auto& sample = *voice.sample;
+    const int numOutputs = juce::jmin (2, output.getNumChannels());
+    const int numSourceChannels = juce::jmin (2, sample.numChannels);
+
+    // Without a stream only the resident part can be played. The last frame is
+    // only ever used as an interpolation partner.
+    const int playableLength = voice.isStreaming ? sample.length : sample.residentLength;
+    const double lastIndex = static_cast<double> (playableLength - 1);
+    const bool atOutputRate = voice.increment == 1.0;
+    const int maxWindowedLength = juce::jmax (1, static_cast<int> ((windowSize - 4) / voice.increment));
+
+    // A mono output gets the average of the panned pair, i.e. the unpanned gain
+    const float gains[2] = { numOutputs > 1 ? voice.gainLeft : 0.5f * (voice.gainLeft + voice.gainRight),
+                             voice.gainRight };
+
+    int done = 0;
+
+    while (done < numSamples)
+    {
+        const auto samplesLeft = static_cast<int> (std::ceil ((lastIndex - voice.position) / voice.increment));
+        int length = juce::jmin (numSamples - done, chunkSize, samplesLeft);
+
+        if (voice.fadeStep > 0.0f)
+            length = juce::jmin (length, static_cast<int> (std::ceil (voice.fade / voice.fadeStep)));
+
+        if (voice.isStreaming)
+            length = juce::jmin (length, maxWindowedLength);
+
+        if (length <= 0)
+        {
+            stopVoice (voiceIndex);
+            return;
+        }
+
+        // The frames this chunk reads, including the interpolation neighbours
+        const auto firstFrame = juce::jmax<juce::int64> (0, static_cast<juce::int64> (voice.position) - 1);
+        const auto lastFrame = juce::jmin<juce::int64> (playableLength - 1,
+                                                        static_cast<juce::int64> (voice.position + voice.increment * (length - 1)) + 2);
+
+        const float* frames[2] {};
+        juce::int64 framesStart = 0;
+        int framesLength = sample.residentLength;
+
+        if (lastFrame < sample.residentLength)
+        {
+            for (int ch = 0; ch < numSourceChannels; ++ch)
+                frames[ch] = kit->getChannelData (sample, ch);
+        }
+        else
+        {
+            // Gather the resident frames and the streamed ones into one window
+            framesStart = firstFrame;
+            framesLength = static_cast<int> (lastFrame - firstFrame + 1);
+
+            const int numResident = static_cast<int> (juce::jlimit<juce::int64> (0, framesLength, sample.residentLength - firstFrame));
+            float* windowChannels[2] = { window.getWritePointer (0, numResident), window.getWritePointer (1, numResident) };
+
+            for (int ch = 0; ch < numSourceChannels; ++ch)
+            {
+                if (numResident > 0)
+                {
+                    const auto* resident = kit->getChannelData (sample, ch) + firstFrame;
+                    std::copy (resident, resident + numResident, window.getWritePointer (ch));
+                }
+
+                frames[ch] = window.getReadPointer (ch);
+            }
+
+            streamer->read (voiceIndex, firstFrame + numResident, framesLength - numResident, windowChannels, numSourceChannels);
+        }
+
+        const float endFade = juce::jmax (0.0f, voice.fade - voice.fadeStep * static_cast<float> (length));
+        const double readPosition = voice.position - static_cast<double> (framesStart);
+        double nextPosition = voice.position + voice.increment * length;
+        const float* sources[2] {};
+
+        for (int ch = 0; ch < numSourceChannels; ++ch)
+        {
+            if (atOutputRate && readPosition == std::floor (readPosition))
+            {
+                sources[ch] = frames[ch] + static_cast<int> (readPosition);
+            }
+            else
+            {
+                auto* resampled = scratch.getWritePointer (ch);
+                const double endPosition = interpolation == Interpolation::cubic
+                                             ? kernels->resampleCubic (resampled, frames[ch], framesLength, readPosition, voice.increment, length)
+                                             : kernels->resampleLinear (resampled, frames[ch], framesLength, readPosition, voice.increment, length);
+                nextPosition = endPosition + static_cast<double> (framesStart);
+                sources[ch] = resampled;
+            }
+        }
+
+        // Mono samples feed both outputs
+        if (numSourceChannels < 2)
+            sources[1] = sources[0];
+
+        for (int ch = 0; ch < numOutputs; ++ch)
+            kernels->addWithGainRamp (output.getWritePointer (ch, startSample + done), sources[ch], length,
+                                      gains[ch] * voice.fade, gains[ch] * endFade);
+
+        voice.position = nextPosition;
+        voice.fade = endFade;
+        done += length;
+
+        if (voice.fadeStep > 0.0f && voice.fade <= 0.0f)
+        {
+            stopVoice (voiceIndex);
+            return;
+        }
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "MixKernels.h"
+#include "SampleKit.h"
+#include "SampleStreamer.h"
+
+// Plays the samples of a SampleKit from the note-ons in a MidiBuffer.
+//
+// Voices are one-shots: a note-on starts the sample for that note and velocity,
+// which then plays to its end regardless of note-offs. The voice pool is a fixed
+// array, so rendering never allocates; when every voice is busy the one that has
+// been playing longest is stolen. Each voice is panned by the CC 10 value of its
+// MIDI channel when it starts.
+//
+// Mixing goes through MixKernels in chunks of up to chunkSize samples. A voice
+// whose sample is at the output rate is summed straight from the kit; any other
+// is first resampled into a scratch buffer. Once a voice plays past the resident
+// attack of a streamed sample, its frames come from the voice's stream in the
+// SampleStreamer, gathered into a window buffer first.
+//
+// The engine does not own the kit; the processor keeps it alive through its
+// RealtimeExchange for as long as it is active.
+class SampleVoiceEngine final
+{
+public:
+    static constexpr int maxVoices = 128;
+    static constexpr int chunkSize = 256;
+
+    enum class Interpolation
+    {
+        linear,
+        cubic
+    };
+
+    SampleVoiceEngine();
+
+    void prepare (double newSampleRate);
+
+    // Set before playback starts; without a streamer, streamed samples stop at
+    // the end of their resident part.
+    void setStreamer (SampleStreamer* newStreamer) noexcept { streamer = newStreamer; }
+
+    // Audio thread: switches kit. Voices of the old kit are cut off.
+    void setKit (const SampleKit* newKit);
+    const SampleKit* getKit() const noexcept { return kit; }
+
+    // Picks the interpolation used for samples that are not at the output rate.
+    void setInterpolation (Interpolation newInterpolation) noexcept { interpolation = newInterpolation; }
+
+    // Selects the mixing kernels, e.g. to compare scalar and SIMD throughput.
+    void setInstructionSet (MixKernels::InstructionSet instructionSet) noexcept { kernels = &MixKernels::get (instructionSet); }
+    const MixKernels& getKernels() const noexcept { return *kernels; }
+
+    // Adds the voices started by the note-ons in the buffer, and those already
+    // sounding, into the first two channels of the audio buffer.
+    void renderNextBlock (juce::AudioBuffer<float>& output, const juce::MidiBuffer& midi);
+
+    // Starts a voice directly, as if a note-on had arrived on the given channel.
+    void noteOn (int midiChannel, int noteNumber, int velocity);
+
+    // Fades every voice out over a few milliseconds.
+    void releaseAllVoices() noexcept;
+
+    // Silences every voice immediately.
+    void allNotesOff() noexcept;
+
+    int getNumActiveVoices() const noexcept;
+
+private:
+    struct Voice
+    {
+        const SampleKit::Sample* sample = nullptr;
+        double position = 0.0;
+        double increment = 1.0;
+        float gainLeft = 0.0f;
+        float gainRight = 0.0f;
+        float fade = 1.0f;
+        float fadeStep = 0.0f;   // per sample while releasing
+        uint64_t startOrder = 0;
+        bool isStreaming = false;
+
+        bool isActive() const noexcept { return sample != nullptr; }
+    };
+
+    void renderVoices (juce::AudioBuffer<float>& output, int startSample, int numSamples);
+    void renderVoice (int voiceIndex, juce::AudioBuffer<float>& output, int startSample, int numSamples);
+    void stopVoice (int voiceIndex) noexcept;
+
+    static constexpr double releaseSeconds = 0.005;
+    static constexpr int windowSize = chunkSize * 8;
+
+    std::array<Voice, maxVoices> voices;
+    std::array<float, 16> channelPan;   // 0 = left, 1 = right
+    juce::AudioBuffer<float> scratch { 2, chunkSize };
+    juce::AudioBuffer<float> window { 2, windowSize };
+
+    const SampleKit* kit = nullptr;
+    SampleStreamer* streamer = nullptr;
+    const MixKernels* kernels = &MixKernels::get();
+    Interpolation interpolation = Interpolation::cubic;
+    double sampleRate = 44100.0;
+    uint64_t nextStartOrder = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SampleVoiceEngine)
+};
@@ -0,0 +1,124 @@
+#include "SongCache.h"
+
+SongCache::SongCache (size_t byteBudgetToUse)
+    : byteBudget (byteBudgetToUse)
+{
+}
+
+bool SongCache::isCurrent (const Entry& entry, const juce::File& file)
+{
+    return file.getSize() == entry.fileSize
+        && file.getLastModificationTime().toMilliseconds() == entry.modificationTime;
+}
+
+CompiledSong::Ptr SongCache::find (const juce::File& file)
+{
+    const juce::ScopedLock sl (lock);
+
+    auto found = index.find (file.getFullPathName());
+    if (found == index.end())
+    {
+        ++misses;
+        return nullptr;
+    }
+
+    auto it = found->second;
+    if (! isCurrent (*it, file))
+    {
+        erase (it);
+        ++misses;
+        return nullptr;
+    }
+
+    entries.splice (entries.begin(), entries, it);
+    ++hits;
+    return it->song;
+}
+
+bool SongCache::contains (const juce::File& file) const
+{
+    const juce::ScopedLock sl (lock);
+
+    auto found = index.find (file.getFullPathName());
+    return found != index.end() && isCurrent (*found->second, file);
+}
+
+void SongCache::insert (const juce::File& file, CompiledSong::Ptr song)
+{
+    if (song == nullptr)
+        return;
+
+    Entry entry;
+    entry.path = file.getFullPathName();
+    entry.fileSize = file.getSize();
+    entry.modificationTime = file.getLastModificationTime().toMilliseconds();
+    entry.memoryUsage = song->getMemoryUsage();
+    entry.song = std::move (song);
+
+    const juce::ScopedLock sl (lock);
+
+    auto found = index.find (entry.path);
+    if (found != index.end())
+        erase (found->second);
+
+    bytesUsed += entry.memoryUsage;
+    entries.push_front (std::move (entry));
+    index[entries.front().path] = entries.begin();
+
+    evictToBudget();
+}
+
+void SongCache::remove (const juce::File& file)
+{
+    const juce::ScopedLock sl (lock);
+
+    auto found = index.find (file.getFullPathName());
+    if (found != index.end())
+        erase (found->second);
+}
+
+void SongCache::clear()
+{
+    const juce::ScopedLock sl (lock);
+    entries.clear();
+    index.clear();
+    bytesUsed = 0;
+}
+
+void SongCache::setByteBudget (size_t newBudget)
+{
+    const juce::ScopedLock sl (lock);
+    byteBudget = newBudget;
+    evictToBudget();
+}
+
+SongCache::Stats SongCache::getStats() const
+{
+    const juce::ScopedLock sl (lock);
+
+    Stats stats;
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.evictions = evictions;
+    stats.numEntries = static_cast<int> (entries.size());
+    stats.bytesUsed = bytesUsed;
+    stats.byteBudget = byteBudget;
+    return stats;
+}
+
+void SongCache::erase (EntryList::iterator it)
+{
+    bytesUsed -= it->memoryUsage;
+    index.erase (it->path);
+    entries.erase (it);
+}
+
+void SongCache::evictToBudget()
+{
+    // Always keep the newest entry, even if it alone is over budget
+    while (bytesUsed > byteBudget && entries.size() > 1)
+    {
+        erase (std::prev (entries.end()));
+        ++evictions;
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "CompiledSong.h"
+
+// A bounded, least-recently-used cache of compiled songs.
+//
+// Entries are keyed by full path and remember the file's size and modification
+// time when it was compiled; a lookup that finds either changed on disk drops
+// the entry and reports a miss. Once the total memory of cached songs exceeds
+// the byte budget, the least recently used entries are evicted. All methods are
+// thread safe.
+class SongCache final
+{
+public:
+    struct Stats
+    {
+        int64_t hits = 0;
+        int64_t misses = 0;
+        int64_t evictions = 0;
+        int numEntries = 0;
+        size_t bytesUsed = 0;
+        size_t byteBudget = 0;
+    };
+
+    explicit SongCache (size_t byteBudgetToUse = 32 * 1024 * 1024);
+
+    // Returns the cached song if it is still current, counting a hit or a miss.
+    CompiledSong::Ptr find (const juce::File& file);
+
+    // True if a current entry exists. Does not affect the counters or LRU order.
+    bool contains (const juce::File& file) const;
+
+    void insert (const juce::File& file, CompiledSong::Ptr song);
+    void remove (const juce::File& file);
+    void clear();
+
+    void setByteBudget (size_t newBudget);
+    Stats getStats() const;
+
+private:
+    struct Entry
+    {
+        juce::String path;
+        int64_t fileSize = 0;
+        juce::int64 modificationTime = 0;
+        size_t memoryUsage = 0;
+        CompiledSong::Ptr song;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    static bool isCurrent (const Entry& entry, const juce::File& file);
+    void erase (EntryList::iterator it);
+    void evictToBudget();
+
+    juce::CriticalSection lock;
+    EntryList entries;   // most recently used first
+    std::map<juce::String, EntryList::iterator> index;
+
+    size_t byteBudget;
+    size_t bytesUsed = 0;
+    int64_t hits = 0, misses = 0, evictions = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SongCache)
+};
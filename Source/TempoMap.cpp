@@ -0,0 +1,87 @@
+#include "TempoMap.h"
+
+namespace
+{
+    constexpr double defaultSecondsPerQuarterNote = 0.5;  // 120 BPM
+}
+
+TempoMap::TempoMap()
+{
+    build ({}, ticksPerQuarterNote);
+}
+
+void TempoMap::build (const std::vector<std::pair<int64_t, double>>& tempoChanges, double newTicksPerQuarterNote)
+{
+    ticksPerQuarterNote = newTicksPerQuarterNote > 0.0 ? newTicksPerQuarterNote : 480.0;
+
+    segments.clear();
+    segments.reserve (tempoChanges.size() + 1);
+    segments.push_back ({ 0, 0.0, defaultSecondsPerQuarterNote / ticksPerQuarterNote });
+
+    for (const auto& change : tempoChanges)
+    {
+        if (change.second <= 0.0)
+            continue;
+
+        const double secondsPerTick = change.second / ticksPerQuarterNote;
+        auto& last = segments.back();
+
+        // A change on the same tick as the previous one replaces it
+        if (change.first <= last.startTick)
+        {
+            last.secondsPerTick = secondsPerTick;
+            continue;
+        }
+
+        const double startSeconds = last.startSeconds
+                                  + static_cast<double> (change.first - last.startTick) * last.secondsPerTick;
+        segments.push_back ({ change.first, startSeconds, secondsPerTick });
+    }
+}
+
+int TempoMap::findSegmentForTick (double tick) const noexcept
+{
+    auto it = std::upper_bound (segments.begin() + 1, segments.end(), tick,
+                                [] (double t, const Segment& s) { return t < static_cast<double> (s.startTick); });
+    return static_cast<int> (std::distance (segments.begin(), it)) - 1;
+}
+
+int TempoMap::findSegmentForSeconds (double seconds) const noexcept
+{
+    auto it = std::upper_bound (segments.begin() + 1, segments.end(), seconds,
+                                [] (double t, const Segment& s) { return t < s.startSeconds; });
+    return static_cast<int> (std::distance (segments.begin(), it)) - 1;
+}
+
+double TempoMap::tickToSeconds (double tick) const noexcept
+{
+    const auto& s = segments[static_cast<size_t> (findSegmentForTick (tick))];
+    return s.startSeconds + (tick - static_cast<double> (s.startTick)) * s.secondsPerTick;
+}
+
+double TempoMap::secondsToTick (double seconds) const noexcept
+{
+    const auto& s = segments[static_cast<size_t> (findSegmentForSeconds (seconds))];
+    return static_cast<double> (s.startTick) + (seconds - s.startSeconds) / s.secondsPerTick;
+}
+
+double TempoMap::getTempoAtTick (double tick) const noexcept
+{
+    const auto& s = segments[static_cast<size_t> (findSegmentForTick (tick))];
+    return 60.0 / (s.secondsPerTick * ticksPerQuarterNote);
+}
+
+double TempoMap::tickToSeconds (double tick, int& segmentHint) const noexcept
+{
+    const auto numSegments = getNumSegments();
+
+    if (! juce::isPositiveAndBelow (segmentHint, numSegments)
+         || tick < static_cast<double> (segments[static_cast<size_t> (segmentHint)].startTick))
+        segmentHint = findSegmentForTick (tick);
+
+    while (segmentHint + 1 < numSegments && static_cast<double> (segments[static_cast<size_t> (segmentHint + 1)].startTick) <= tick)
+        ++segmentHint;
+
+    const auto& s = segments[static_cast<size_t> (segmentHint)];
+    return s.startSeconds + (tick - static_cast<double> (s.startTick)) * s.secondsPerTick;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+// Converts between MIDI ticks and time for a file with any number of tempo changes.
+//
+// The tempo events are turned into constant-tempo segments when the song is
+// compiled, each storing the time at which it starts, so a conversion is a binary
+// search for the segment followed by one multiply-add. Times are kept in seconds
+// so the map does not depend on the sample rate; multiply by the sample rate to
+// get a sample position.
+class TempoMap final
+{
+public:
+    struct Segment
+    {
+        int64_t startTick = 0;
+        double startSeconds = 0.0;
+        double secondsPerTick = 0.0;
+    };
+
+    // A single 120 BPM segment at 480 PPQN.
+    TempoMap();
+
+    // Builds the segments from (tick, seconds per quarter note) tempo changes, which
+    // must be sorted by tick. The tempo before the first change is 120 BPM.
+    void build (const std::vector<std::pair<int64_t, double>>& tempoChanges, double ticksPerQuarterNote);
+
+    int getNumSegments() const noexcept { return static_cast<int> (segments.size()); }
+    const Segment& getSegment (int index) const noexcept { return segments[static_cast<size_t> (index)]; }
+
+    double tickToSeconds (double tick) const noexcept;
+    double secondsToTick (double seconds) const noexcept;
+
+    // Tempo in BPM in effect at the given tick.
+    double getTempoAtTick (double tick) const noexcept;
+
+    // The same conversion for ticks that mostly increase, such as the events of
+    // one audio block. The hint holds the segment of the previous tick and is
+    // walked forward from there, so a run of ticks costs amortised O(1). Any hint,
+    // including -1, gives the same result; a tick before the hinted segment falls
+    // back to a binary search.
+    double tickToSeconds (double tick, int& segmentHint) const noexcept;
+
+private:
+    int findSegmentForTick (double tick) const noexcept;
+    int findSegmentForSeconds (double seconds) const noexcept;
+
+    std::vector<Segment> segments;
+    double ticksPerQuarterNote = 480.0;
+};
@@ -0,0 +1,198 @@
+#include <iostream>
+#include <thread>
+#include "Benchmarks.h"
+#include "TransportCommandQueue.h"
+
+// Checks the transport command queue between the message and audio threads.
+//
+// First the queue is filled with nothing draining it, as when a host stops
+// calling processBlock: once it is full, pushes must be folded into the
+// overflow, and a drain must then return every queued command in order followed
+// by the overflow, ending in the same playing state and position as every
+// command pushed. After that, pushes must be queued again.
+//
+// Then a producer thread pushes play, stop and seek at random as fast as it can
+// while a consumer drains the queue once per block, the way processBlock does.
+// The consumer keeps to the block rate, and now and then stalls for a few blocks
+// so the queue overflows under load. Both sides play the commands on a model of
+// the transport, and the two must agree at the end.
+//
+// midifart-host commands checks the same through the processor's own setters.
+
+namespace
+{
+    int getIntOption (const juce::ArgumentList& args, const juce::String& option, int defaultValue)
+    {
+        auto value = args.getValueForOption (option);
+        return value.isNotEmpty() ? value.getIntValue() : defaultValue;
+    }
+
+    TransportCommand makeCommand (juce::Random& random, int number) noexcept
+    {
+        return { static_cast<TransportCommand::Type> (random.nextInt (3)), static_cast<double> (number) };
+    }
+
+    // What the processor does with each command, reduced to the state it leaves
+    struct TransportModel
+    {
+        void apply (const TransportCommand& command) noexcept
+        {
+            switch (command.type)
+            {
+                case TransportCommand::Type::play: isPlaying = true; position = 0.0; break;
+                case TransportCommand::Type::stop: isPlaying = false; break;
+                case TransportCommand::Type::seek: position = command.value; break;
+            }
+        }
+
+        bool operator== (const TransportModel& other) const noexcept { return isPlaying == other.isPlaying && position == other.position; }
+        bool operator!= (const TransportModel& other) const noexcept { return ! operator== (other); }
+
+        bool isPlaying = false;
+        double position = 0.0;
+    };
+
+    class BlockConsumer final : public juce::Thread
+    {
+    public:
+        BlockConsumer (TransportCommandQueue& queueToDrain, int blockMicroseconds)
+            : juce::Thread ("Command consumer"), queue (queueToDrain), blockTime (blockMicroseconds)
+        {
+        }
+
+        void run() override
+        {
+            juce::Random random (0xb10c);
+            auto due = juce::Time::getHighResolutionTicks();
+            const auto ticksPerBlock = juce::Time::secondsToHighResolutionTicks (blockTime * 1.0e-6);
+
+            while (! threadShouldExit())
+            {
+                queue.drain ([this] (const TransportCommand& command) { model.apply (command); ++numReceived; });
+                ++numBlocks;
+
+                // A stalled callback now and then lets the producer overflow the queue
+                due += random.nextInt (500) == 0 ? ticksPerBlock * 20 : ticksPerBlock;
+
+                while (juce::Time::getHighResolutionTicks() < due)
+                    std::this_thread::yield();
+            }
+        }
+
+        // Read these once the thread has stopped
+        TransportModel model;
+        int numReceived = 0;
+
+        std::atomic<int> numBlocks { 0 };
+
+    private:
+        TransportCommandQueue& queue;
+        const int blockTime;
+    };
+}
+
+int Benchmarks::checkCommandQueue (const juce::ArgumentList& args)
+{
+    const int numCommands = juce::jmax (1, getIntOption (args, "--commands", 200000));
+    const int blockMicroseconds = juce::jmax (1, getIntOption (args, "--block-us", 1333));
+
+    int numFailures = 0;
+
+    // A full queue
+    {
+        TransportCommandQueue queue;
+        juce::Random random (0xf011);
+        TransportModel expected;
+        std::vector<TransportCommand> queued;
+
+        for (;;)
+        {
+            const auto command = makeCommand (random, static_cast<int> (queued.size()));
+            expected.apply (command);
+
+            if (! queue.push (command))
+                break;
+
+            queued.push_back (command);
+        }
+
+        int numFolded = 1;
+
+        for (int i = 0; i < 1000; ++i)
+        {
+            const auto command = makeCommand (random, static_cast<int> (queued.size()) + 1 + i);
+            expected.apply (command);
+            numFolded += queue.push (command) ? 0 : 1;
+        }
+
+        std::vector<TransportCommand> drained;
+        TransportModel model;
+        queue.drain ([&drained, &model] (const TransportCommand& command) { drained.push_back (command); model.apply (command); });
+
+        const bool inOrder = drained.size() >= queued.size()
+                              && std::equal (queued.begin(), queued.end(), drained.begin(), [] (const TransportCommand& a, const TransportCommand& b)
+                                             { return a.type == b.type && a.value == b.value; });
+
+        const bool pushesAgain = ! queue.isOverflowing() && queue.push ({ TransportCommand::Type::stop });
+
+        std::cout << "Full queue: " << queued.size() << " commands fit, " << numFolded << " of 1001 more folded into the overflow, "
+                  << drained.size() << " drained, " << (inOrder ? "queued ones in order" : "queued ones out of order") << ", "
+                  << (model == expected ? "same end state" : "different end state") << ", "
+                  << (pushesAgain ? "queues again after draining" : "still overflowing after draining") << std::endl;
+
+        if (queued.empty() || numFolded != 1001 || ! inOrder || model != expected || ! pushesAgain)
+            ++numFailures;
+    }
+
+    // Pushing and draining at once
+    {
+        TransportCommandQueue queue;
+        BlockConsumer consumer (queue, blockMicroseconds);
+        consumer.startThread (juce::Thread::Priority::highest);
+
+        juce::Random random (0x5eed);
+        TransportModel expected;
+        int numFolded = 0;
+        const double startTime = juce::Time::getMillisecondCounterHiRes();
+
+        for (int i = 0; i < numCommands; ++i)
+        {
+            const auto command = makeCommand (random, i);
+            expected.apply (command);
+            numFolded += queue.push (command) ? 0 : 1;
+
+            // Bursts, so both the queue and the overflow see traffic
+            if (i % 64 == 63)
+                std::this_thread::yield();
+        }
+
+        // Everything pushed is applied within a block or a stall; wait a good deal longer before calling it lost
+        const auto giveUpTime = juce::Time::getMillisecondCounter() + 10000;
+
+        while (queue.isOverflowing() && juce::Time::getMillisecondCounter() < giveUpTime)
+            juce::Thread::sleep (1);
+
+        // Two more blocks drain whatever was queued before the overflow was applied
+        const int blocksSeen = consumer.numBlocks;
+
+        while (consumer.numBlocks < blocksSeen + 2 && juce::Time::getMillisecondCounter() < giveUpTime)
+            juce::Thread::sleep (1);
+
+        consumer.stopThread (1000);
+
+        const double seconds = (juce::Time::getMillisecondCounterHiRes() - startTime) * 0.001;
+        const bool same = consumer.model == expected;
+
+        std::cout << "Concurrent: " << numCommands << " pushed over " << consumer.numBlocks.load() << " blocks in "
+                  << juce::String (seconds, 2) << " s, " << numFolded << " folded into the overflow, "
+                  << consumer.numReceived << " applied, " << (same ? "same end state" : "different end state") << std::endl;
+
+        if (! same)
+            ++numFailures;
+    }
+
+    if (numFailures > 0)
+        juce::ConsoleApplication::fail ("The command queue lost or reordered commands");
+
+    return 0;
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+// A transport change requested by the message thread.
+struct TransportCommand
+{
+    enum class Type
+    {
+        play,
+        stop,
+        seek    // value is the tick to jump to
+    };
+
+    Type type = Type::stop;
+    double value = 0.0;
+};
+
+// A fixed-size, lock-free single-producer/single-consumer queue of transport
+// commands. The message thread pushes, and the audio thread drains the queue at
+// the start of each block and applies the commands in order, so it owns all
+// transport state outright.
+//
+// A push never fails. If the audio thread has stopped draining (a suspended
+// track, an offline bounce) and the queue fills up, later commands are folded
+// into an overflow that keeps only what decides the outcome: whether there was
+// a play, which rewinds, whether a stop came after it, and the last seek unless
+// a play came after that. The audio thread applies the overflow after the queued
+// commands, and pushes keep going to the overflow until it has, so the order is
+// never broken. Playing the drained commands ends in the same playing state and
+// position as playing every pushed one.
+class TransportCommandQueue final
+{
+public:
+    TransportCommandQueue() = default;
+
+    // Producer side. Returns true if the command was queued as it is, false if it
+    // was folded into the overflow; either way it takes effect.
+    bool push (TransportCommand command) noexcept
+    {
+        if (! isOverflowing() && fifo.getFreeSpace() > 0)
+        {
+            int start1, size1, start2, size2;
+            fifo.prepareToWrite (1, start1, size1, start2, size2);
+            commands[static_cast<size_t> (size1 > 0 ? start1 : start2)] = command;
+            fifo.finishedWrite (1);
+            return true;
+        }
+
+        if (command.type == TransportCommand::Type::seek)
+        {
+            // The tick goes first; a consumer that sees the new generation with an
+            // older tick, or the reverse, applies the newer tick next time round
+            overflowSeekTick.store (command.value, std::memory_order_relaxed);
+            overflowSeek.store (++seekGeneration, std::memory_order_release);
+        }
+        else
+        {
+            // A play rewinds, so it supersedes every seek requested before it. It is
+            // recorded apart from the last play or stop, as a later stop does not undo it.
+            const bool isPlay = command.type == TransportCommand::Type::play;
+
+            if (isPlay)
+                overflowPlay.store ((static_cast<uint64_t> (++playGeneration) << 32) | seekGeneration, std::memory_order_release);
+
+            overflowRun.store ((static_cast<uint64_t> (++runGeneration) << 1) | (isPlay ? 1u : 0u), std::memory_order_release);
+        }
+
+        return false;
+    }
+
+    // Consumer side: calls apply for every queued command, oldest first, then for
+    // what the overflow holds: a play, a stop, then a seek.
+    template <typename ApplyFunction>
+    void drain (ApplyFunction&& apply) noexcept
+    {
+        // The overflow is read first: everything queued before what it holds is then
+        // in the fifo, and nothing can be queued after it until it has been applied.
+        // Read in the reverse of the order they are written, so whatever is seen of
+        // a later request, the requests before it are seen too.
+        const auto seek = overflowSeek.load (std::memory_order_acquire);
+        const auto seekTick = overflowSeekTick.load (std::memory_order_relaxed);
+        const auto run = overflowRun.load (std::memory_order_acquire);
+        const auto play = overflowPlay.load (std::memory_order_acquire);
+
+        int start1, size1, start2, size2;
+        fifo.prepareToRead (fifo.getNumReady(), start1, size1, start2, size2);
+
+        for (int i = 0; i < size1; ++i)
+            apply (commands[static_cast<size_t> (start1 + i)]);
+
+        for (int i = 0; i < size2; ++i)
+            apply (commands[static_cast<size_t> (start2 + i)]);
+
+        fifo.finishedRead (size1 + size2);
+
+        if (static_cast<uint32_t> (play >> 32) != appliedPlay)
+        {
+            apply (TransportCommand { TransportCommand::Type::play, 0.0 });
+            appliedPlay = static_cast<uint32_t> (play >> 32);
+            seekFloor = juce::jmax (seekFloor, static_cast<uint32_t> (play));
+        }
+
+        if (static_cast<uint32_t> (run >> 1) != appliedRun.load (std::memory_order_relaxed))
+        {
+            if ((run & 1) == 0)
+                apply (TransportCommand { TransportCommand::Type::stop, 0.0 });
+
+            appliedRun.store (static_cast<uint32_t> (run >> 1), std::memory_order_release);
+        }
+
+        if (seek != appliedSeek.load (std::memory_order_relaxed))
+        {
+            if (seek > seekFloor)
+                apply (TransportCommand { TransportCommand::Type::seek, seekTick });
+
+            appliedSeek.store (seek, std::memory_order_release);
+        }
+    }
+
+    // Producer side: true while commands folded into the overflow have not all
+    // been applied yet.
+    bool isOverflowing() const noexcept
+    {
+        return appliedRun.load (std::memory_order_acquire) != runGeneration
+            || appliedSeek.load (std::memory_order_acquire) != seekGeneration;
+    }
+
+private:
+    static constexpr int capacity = 256;
+
+    juce::AbstractFifo fifo { capacity };
+    std::array<TransportCommand, capacity> commands {};
+
+    // Overflow, written by the producer. Each request bumps a generation:
+    // overflowPlay holds the last play's and the seek generation it supersedes,
+    // overflowRun the last play or stop's and whether it was a play.
+    std::atomic<uint64_t> overflowPlay { 0 };
+    std::atomic<uint64_t> overflowRun { 0 };
+    std::atomic<uint32_t> overflowSeek { 0 };
+    std::atomic<double> overflowSeekTick { 0.0 };
+    uint32_t playGeneration = 0;   // producer only
+    uint32_t runGeneration = 0;    // producer only
+    uint32_t seekGeneration = 0;   // producer only
+
+    // What of the overflow has been applied, written by the consumer
+    std::atomic<uint32_t> appliedRun { 0 };
+    std::atomic<uint32_t> appliedSeek { 0 };
+    uint32_t appliedPlay = 0;   // consumer only
+    uint32_t seekFloor = 0;     // consumer only: seeks up to this one were superseded by a play
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TransportCommandQueue)
+};
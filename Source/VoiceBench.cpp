@@ -0,0 +1,140 @@
+#include <iostream>
+#include "Benchmarks.h"
+#include "SampleVoiceEngine.h"
+
+// Times the sample voice engine with every voice busy, for each instruction set
+// the CPU supports.
+//
+// The engine plays the built-in kit, which is at 48 kHz, once at 48 kHz so the
+// voices are only mixed and once at 44.1 kHz so every voice is also resampled
+// with the cubic interpolation used live. Before each block, voices that have
+// ended are restarted so the given number stay busy; only renderNextBlock is
+// timed. Voices per core is how many voices one core could keep up with in real
+// time at that rate, from the time each one costs.
+//
+// Given --kit=folder, it first loads that kit twice: with the default preload,
+// as the plugin does, and with every sample decoded whole, as offline renders
+// do. It reports how long each load took and how much audio each keeps in
+// memory, which is what streaming the tails saves.
+
+namespace
+{
+    double getDoubleOption (const juce::ArgumentList& args, const juce::String& option, double defaultValue)
+    {
+        auto value = args.getValueForOption (option);
+        return value.isNotEmpty() ? value.getDoubleValue() : defaultValue;
+    }
+
+    int getIntOption (const juce::ArgumentList& args, const juce::String& option, int defaultValue)
+    {
+        auto value = args.getValueForOption (option);
+        return value.isNotEmpty() ? value.getIntValue() : defaultValue;
+    }
+
+    struct VoiceTiming
+    {
+        double secondsPerBlock = 0.0;
+        double meanVoices = 0.0;
+    };
+
+    VoiceTiming timeVoices (SampleVoiceEngine& engine, double sampleRate, int blockSize, int numBlocks, int numVoices)
+    {
+        juce::AudioBuffer<float> buffer (2, blockSize);
+        juce::MidiBuffer noMidi;
+
+        engine.prepare (sampleRate);
+
+        double totalSeconds = 0.0;
+        int64_t totalVoices = 0;
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            // Spread the notes over the kit so the voices do not all end together
+            for (int i = 0; i < numVoices && engine.getNumActiveVoices() < numVoices; ++i)
+                engine.noteOn (1, 36 + (block + i) % 16, 100);
+
+            totalVoices += engine.getNumActiveVoices();
+            buffer.clear();
+
+            const auto before = juce::Time::getHighResolutionTicks();
+            engine.renderNextBlock (buffer, noMidi);
+            const auto after = juce::Time::getHighResolutionTicks();
+
+            totalSeconds += juce::Time::highResolutionTicksToSeconds (after - before);
+        }
+
+        return { totalSeconds / numBlocks, static_cast<double> (totalVoices) / numBlocks };
+    }
+
+    void timeKitLoads (const juce::File& folder)
+    {
+        juce::AudioFormatManager formatManager;
+        formatManager.registerBasicFormats();
+
+        std::cout << "Kit " << folder.getFileName() << ", load time / resident audio" << std::endl;
+
+        for (const int preloadFrames : { SampleKit::defaultPreloadFrames, std::numeric_limits<int>::max() })
+        {
+            const double startTime = juce::Time::getMillisecondCounterHiRes();
+            const auto kit = SampleKit::loadFromFolder (folder, formatManager, preloadFrames);
+            const double elapsed = juce::Time::getMillisecondCounterHiRes() - startTime;
+
+            if (kit == nullptr)
+                juce::ConsoleApplication::fail ("No samples found in " + folder.getFullPathName());
+
+            std::cout << (preloadFrames == SampleKit::defaultPreloadFrames ? "  streamed tails " : "  decoded whole  ")
+                      << juce::String (elapsed, 1).paddedLeft (' ', 9) << " ms /"
+                      << juce::String (static_cast<double> (kit->getMemoryUsage()) / (1024.0 * 1024.0), 1).paddedLeft (' ', 8)
+                      << " MB, " << kit->getNumSamples() << " samples" << std::endl;
+        }
+    }
+}
+
+int Benchmarks::runVoices (const juce::ArgumentList& args)
+{
+    const int numVoices = juce::jlimit (1, SampleVoiceEngine::maxVoices, getIntOption (args, "--voices", SampleVoiceEngine::maxVoices));
+    const int blockSize = juce::jmax (1, getIntOption (args, "--block", 256));
+    const double seconds = juce::jmax (0.1, getDoubleOption (args, "--seconds", 20.0));
+
+    if (args.containsOption ("--kit"))
+        timeKitLoads (args.getExistingFolderForOption ("--kit"));
+
+    const auto kit = SampleKit::createPreviewKit();
+
+    auto engine = std::make_unique<SampleVoiceEngine>();
+    engine->setKit (kit.get());
+    engine->setInterpolation (SampleVoiceEngine::Interpolation::cubic);
+
+    std::cout << numVoices << " voices in blocks of " << blockSize << ", " << juce::String (seconds, 1)
+              << " s of audio each, mean time per block / voices per core" << std::endl;
+
+    const auto best = MixKernels::getBestAvailable();
+
+    for (const double sampleRate : { 48000.0, 44100.0 })
+    {
+        const int numBlocks = juce::jmax (1, static_cast<int> (seconds * sampleRate / blockSize));
+        const double deadline = blockSize / sampleRate;
+
+        std::cout << (sampleRate == 48000.0 ? "  mixed at 48 kHz    " : "  resampled to 44.1k ");
+
+        for (auto set : { MixKernels::InstructionSet::scalar,
+                          MixKernels::InstructionSet::sse2,
+                          MixKernels::InstructionSet::avx2 })
+        {
+            if (set > best)
+                continue;
+
+            engine->setInstructionSet (set);
+            const auto timing = timeVoices (*engine, sampleRate, blockSize, numBlocks, numVoices);
+            const double voicesPerCore = timing.secondsPerBlock > 0.0 ? timing.meanVoices * deadline / timing.secondsPerBlock : 0.0;
+
+            std::cout << "  " << juce::String (engine->getKernels().name).paddedRight (' ', 6)
+                      << juce::String (timing.secondsPerBlock * 1.0e6, 1).paddedLeft (' ', 7) << " us /"
+                      << juce::String (juce::roundToInt (voicesPerCore)).paddedLeft (' ', 6);
+        }
+
+        std::cout << std::endl;
+    }
+
+    return 0;
+}